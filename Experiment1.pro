@@ -13,10 +13,27 @@ TEMPLATE = lib
 
 DEFINES += EXPERIMENTCEEXP_LIBRARY
 
+# allow the compiler to vectorize the loops marked with omp simd (no OpenMP runtime needed)
+QMAKE_CXXFLAGS += -fopenmp-simd
+
 SOURCES += \
     kilobot.cpp \
     complexityExperiment.cpp \
-    complexityEnvironment.cpp
+    complexityEnvironment.cpp \
+    arenaSet.cpp \
+    kilobotRegistry.cpp \
+    experimentConfig.cpp \
+    areaMask.cpp \
+    objectPool.cpp \
+    workStealingPool.cpp \
+    tickProfiler.cpp \
+    snapshotWriter.cpp \
+    replayLog.cpp \
+    latencyPredictor.cpp \
+    trackingHandoff.cpp \
+    runStatistics.cpp \
+    meanFieldModel.cpp \
+    kilobot_c_code/resource_codec.c
 
 HEADERS +=\
     kilobot.h \
@@ -25,8 +42,25 @@ HEADERS +=\
     global.h \
     resources.h \
     area.h \
+    areaMask.h \
+    objectPool.h \
     complexityExperiment.h \
-    complexityEnvironment.h
+    complexityEnvironment.h \
+    arenaSet.h \
+    kilobotRegistry.h \
+    poseFilter.h \
+    experimentConfig.h \
+    workStealingPool.h \
+    tickProfiler.h \
+    snapshotWriter.h \
+    replayLog.h \
+    latencyPredictor.h \
+    trackingHandoff.h \
+    spscRing.h \
+    runStatistics.h \
+    meanFieldModel.h \
+    resourceColours.h \
+    kilobot_c_code/resource_codec.h
 
 unix {
     target.path = /usr/lib
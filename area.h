@@ -1,7 +1,11 @@
 /**
  * Custom definition of an area
  * With the term area we refer to the single area (e.g. the single coloured circle)
- * Areas disasppears when the population reaches 0
+ * The population never goes below 0.001 (see doStep): an area only disappears when it is removed
+ * (see Resource::remove), e.g. when depleted below the area_depletion of the configuration. A
+ * removed area keeps its slot in the resource, inactive, until it is respawned.
+ * An area is a circle, or a patch of a mask image (see areaMask.h): then position and radius are
+ * the centroid and a circle that contains the patch.
  *
  * @author Dario Albani
  * @email dario.albani@istc.cnr.it
@@ -15,7 +19,13 @@
 
 #include <QPointF>
 #include <QColor>
+#include <QDataStream>
+#include <QString>
 #include <iostream>
+
+#include "resourceColours.h"
+#include "areaMask.h"
+
 class Area {
 public:
     uint type; // resource type
@@ -25,40 +35,116 @@ public:
     double radius; /* Radius of the circle to plot */
     double population; /* Population in the current area */
     QColor color; /* Color used to represent the area */
-    uint kilobots_in_area; /* keep counts of how many kbs are in the area*/
+    uint kilobots_in_area; /* kbs over the area with its colour, updated when they enter or exit or are lost by the tracking (see the environment) */
     std::string exploitation_type; /* determine the exploitation on the area by different kbs */
     double lambda; /* epxloitation coefficient */
     double eta; /* area growth */
+    quint32 last_step; /* resource step at which the population was last updated (see catchUp) */
+    bool regrowing; /* in the areas of the resource that can change without kilobots (see Resource::getPopulation) */
+    bool active; /* false once removed: not inside, not stepped, not drawn */
+    double removed_time; /* environment time of the removal, for the respawn */
+    const AreaMask* mask; /* mask of the patch, NULL for a circle */
+    uint16_t label; /* label of the patch in the mask, 0 for a circle */
 
     /* constructor */
-    Area() : type(0), id(0), position(QPointF(0,0)), radius(0), exploitation_type("quadratic") {}
+    Area() : type(0), id(0), position(QPointF(0,0)), radius(0), exploitation_type("quadratic"), last_step(0),
+        regrowing(false), active(true), removed_time(0), mask(NULL), label(0) {}
 
     Area(uint type, uint id, QPointF position, double radius, std::string exploitation_type) :
         type(type), id(id), position(position), radius(radius), exploitation_type(exploitation_type) {
         this->kilobots_in_area = 0;
+        this->last_step = 0;
+        this->regrowing = false;
+        this->active = true;
+        this->removed_time = 0;
+        this->mask = NULL;
+        this->label = 0;
         this->population = 1;
         this->lambda = 0.005;
         this->eta = 0.008424878;
 
-        if(type == 0)
-            this->color = Qt::red;
-        else if(type == 1)
-            this->color = Qt::green;
-        else
-            this->color = Qt::blue;
+        this->color = resourceColour(type);
     }
 
     /* destructor */
     ~Area(){}
 
-    /* check if the point is inside the area */
+    /* write the whole state of the area in a snapshot, with the population at resource step step */
+    void save(QDataStream& out, quint32 step) const {
+        out << (quint32)type << (quint32)id << position << radius << populationAt(step) << color
+            << (quint32)kilobots_in_area << QString::fromStdString(exploitation_type) << lambda << eta
+            << active << removed_time << (quint16)label;
+    }
+
+    /* read the state written by save, check in.status() for errors (the mask of a patch is set by the caller) */
+    void load(QDataStream& in) {
+        quint32 type, id, kilobots_in_area;
+        quint16 label;
+        QString exploitation_type;
+        in >> type >> id >> position >> radius >> population >> color
+           >> kilobots_in_area >> exploitation_type >> lambda >> eta >> active >> removed_time >> label;
+        this->label = label;
+        this->mask = NULL;
+        this->type = type;
+        this->id = id;
+        this->kilobots_in_area = kilobots_in_area;
+        this->exploitation_type = exploitation_type.toStdString();
+        this->last_step = 0;
+        this->regrowing = false;
+    }
+
+    /* check if the point is inside the area, never for a removed area */
     bool isInside(QPointF point) {
-       return pow(point.x()-position.x(),2)+pow(point.y()-position.y(),2) <= pow(radius,2);
+       if(mask) {
+           return active && mask->labelAt(point) == label;
+       }
+       return active && pow(point.x()-position.x(),2)+pow(point.y()-position.y(),2) <= pow(radius,2);
+    }
+
+    /*
+     * one step without kilobots over the area, i.e. doStep with kilobots_in_area = 0
+     * (there is no closed form for the discrete logistic map, the step is applied as is)
+     */
+    static double grow(double population, double eta) {
+        population = population + population*eta*(1-population);
+        if(population <= 0.001) {
+            population = 0.001;
+        }
+        return population;
+    }
+
+    /*
+     * population at resource step step, assuming no kilobots over the area since last_step
+     * the area is not modified, hence it can be read from several threads; the steps missed are
+     * applied one by one, use catchUp to keep them
+     */
+    double populationAt(quint32 step) const {
+        double population = this->population;
+        for(quint32 s=last_step; s<step; s++) {
+            double next = grow(population, eta);
+            // fixed point (full area): the following steps would not change it either
+            if(next == population) {
+                break;
+            }
+            population = next;
+        }
+        return population;
+    }
+
+    /* apply the steps without kilobots missed since last_step, the next reads start from step */
+    void catchUp(quint32 step) {
+        this->population = populationAt(step);
+        this->last_step = step;
+    }
+
+    /* without kilobots and at the fixed point of grow: the next steps do not change the population */
+    bool settled() const {
+        return kilobots_in_area == 0 && grow(population, eta) == population;
     }
 
     /*
    * do one simulation step during which:
-   * - the population is decreased according to the number of agents
+   * - the population is decreased according to the number of agents (kilobots_in_area is kept)
    *
    * @return exploitation
    */
@@ -84,8 +170,7 @@ public:
             this->population = 0.001;
         }
 
-        // reset kbs in the area
-        this->kilobots_in_area = 0;
+        this->last_step++;
 
         //std::cout << "utility is " << population;
         //std::cout << "exploitation is " << exploitation << " growth is " << growth << std::endl;
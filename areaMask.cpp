@@ -0,0 +1,161 @@
+#ifndef AREAMASK_CPP
+#define AREAMASK_CPP
+
+#include "areaMask.h"
+
+#include <algorithm>
+
+AreaMask::AreaMask() : width(0), height(0) {
+}
+
+void AreaMask::clear() {
+    file.clear();
+    top_left = QPointF(0,0);
+    width = 0;
+    height = 0;
+    labels.clear();
+    distances.clear();
+    regions.clear();
+}
+
+bool AreaMask::load(const QString& filename, QPointF origin, QString* error) {
+    QImage image(filename);
+    if(image.isNull()) {
+        clear();
+        *error = "cannot read the area mask " + filename;
+        return false;
+    }
+    label(image, origin);
+    this->file = filename;
+    return true;
+}
+
+void AreaMask::label(const QImage& image, QPointF origin) {
+    clear();
+    this->top_left = origin;
+    this->width = image.width();
+    this->height = image.height();
+    const int pixels = width*height;
+
+    // resource of each pixel, -1 for empty space
+    QImage rgb = image.convertToFormat(QImage::Format_RGB32);
+    QRgb colours[MAX_RESOURCES];
+    for(int r=0; r<MAX_RESOURCES; r++) {
+        colours[r] = resourceColour(r).rgb() & 0xFFFFFF;
+    }
+    std::vector<int8_t> types(pixels, -1);
+    for(int y=0; y<height; y++) {
+        const QRgb* line = (const QRgb*)rgb.constScanLine(y);
+        for(int x=0; x<width; x++) {
+            for(int r=0; r<MAX_RESOURCES; r++) {
+                if((line[x] & 0xFFFFFF) == colours[r]) {
+                    types[y*width+x] = r;
+                    break;
+                }
+            }
+        }
+    }
+
+    // 8-connected patches of one resource, flood filled
+    labels.assign(pixels, 0);
+    std::vector<int> stack;
+    for(int start=0; start<pixels; start++) {
+        if(types[start] < 0 || labels[start] != 0 || regions.size() == 0xFFFF) {
+            continue;
+        }
+        region patch;
+        patch.type = types[start];
+        patch.pixels = 0;
+        patch.bounding_radius = 0;
+        uint16_t patch_label = regions.size()+1;
+        double x_sum = 0, y_sum = 0;
+        labels[start] = patch_label;
+        stack.push_back(start);
+        while(!stack.empty()) {
+            int p = stack.back();
+            stack.pop_back();
+            int px = p%width, py = p/width;
+            patch.pixels++;
+            x_sum += px+0.5;
+            y_sum += py+0.5;
+            for(int ny=std::max(py-1, 0); ny<=std::min(py+1, height-1); ny++) {
+                for(int nx=std::max(px-1, 0); nx<=std::min(px+1, width-1); nx++) {
+                    int n = ny*width+nx;
+                    if(labels[n] == 0 && types[n] == patch.type) {
+                        labels[n] = patch_label;
+                        stack.push_back(n);
+                    }
+                }
+            }
+        }
+        patch.centroid = QPointF(x_sum/patch.pixels, y_sum/patch.pixels);
+        regions.push_back(patch);
+    }
+
+    // bounding radius, up to the farthest corner of the pixels of the patch
+    for(int p=0; p<pixels; p++) {
+        if(labels[p] != 0) {
+            region& patch = regions[labels[p]-1];
+            double dx = fabs(p%width+0.5-patch.centroid.x())+0.5;
+            double dy = fabs(p/width+0.5-patch.centroid.y())+0.5;
+            patch.bounding_radius = std::max(patch.bounding_radius, sqrt(dx*dx+dy*dy));
+        }
+    }
+    for(region& patch : regions) {
+        patch.centroid += origin;
+    }
+
+    // chessboard distance transform from the border pixels (a neighbour with another label, the
+    // outside of the image is empty space), one forward and one backward pass
+    const uint16_t far = 0xFFFF;
+    distances.assign(pixels, far);
+    for(int y=0; y<height; y++) {
+        for(int x=0; x<width; x++) {
+            uint16_t l = labels[y*width+x];
+            bool border = false;
+            for(int ny=y-1; ny<=y+1 && !border; ny++) {
+                for(int nx=x-1; nx<=x+1 && !border; nx++) {
+                    bool outside = nx < 0 || ny < 0 || nx >= width || ny >= height;
+                    border = (outside ? 0 : labels[ny*width+nx]) != l;
+                }
+            }
+            if(border) {
+                distances[y*width+x] = 0;
+            }
+        }
+    }
+    for(int y=0; y<height; y++) {
+        for(int x=0; x<width; x++) {
+            uint16_t& d = distances[y*width+x];
+            if(y > 0) {
+                for(int nx=std::max(x-1, 0); nx<=std::min(x+1, width-1); nx++)
+                    d = std::min<int>(d, distances[(y-1)*width+nx]+1);
+            }
+            if(x > 0)
+                d = std::min<int>(d, distances[y*width+x-1]+1);
+        }
+    }
+    for(int y=height-1; y>=0; y--) {
+        for(int x=width-1; x>=0; x--) {
+            uint16_t& d = distances[y*width+x];
+            if(y < height-1) {
+                for(int nx=std::max(x-1, 0); nx<=std::min(x+1, width-1); nx++)
+                    d = std::min<int>(d, distances[(y+1)*width+nx]+1);
+            }
+            if(x < width-1)
+                d = std::min<int>(d, distances[y*width+x+1]+1);
+        }
+    }
+}
+
+void AreaMask::swap(AreaMask& other) {
+    std::swap(file, other.file);
+    std::swap(top_left, other.top_left);
+    std::swap(width, other.width);
+    std::swap(height, other.height);
+    labels.swap(other.labels);
+    distances.swap(other.distances);
+    regions.swap(other.regions);
+}
+
+#endif // AREAMASK_CPP
@@ -0,0 +1,103 @@
+/**
+ * Areas of arbitrary shape, read from a mask image.
+ *
+ * The mask is an image placed on the tracking image with its top left corner at origin, one mask
+ * pixel per tracking pixel. A pixel painted with the colour of a resource (see resourceColour)
+ * belongs to an area of that resource, any other colour is empty space: every 8-connected patch of
+ * one colour is an area, so irregular patches and corridors are painted as they are. Only exact
+ * colours count (no antialiasing), the patches after the first 65535 are empty space.
+ *
+ * The image is labelled once at load: a label raster gives the area under a point with one
+ * lookup (0 for empty space), whatever the shape of the areas. A second raster holds for each
+ * pixel its chessboard distance from the nearest pixel at the border of a patch, which never
+ * exceeds the euclidean distance of any point of the pixel from a different label: the
+ * environment uses it as the safe radius of the kbs over the mask (see classifyKilobot).
+ */
+
+#ifndef AREAMASK_H
+#define AREAMASK_H
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include <QPointF>
+#include <QString>
+#include <QImage>
+
+#include "resourceColours.h"
+
+class AreaMask {
+public:
+    struct region {
+        uint8_t type;           /* resource of the patch */
+        uint32_t pixels;        /* size of the patch */
+        QPointF centroid;       /* tracking coordinates */
+        double bounding_radius; /* the patch is inside the circle centroid, bounding_radius */
+    };
+
+    AreaMask();
+
+    /* forget the mask, no area under any point */
+    void clear();
+    /* label the image file, false (mask cleared) with the reason in error if it cannot be read */
+    bool load(const QString& filename, QPointF origin, QString* error);
+    /* label the image */
+    void label(const QImage& image, QPointF origin);
+
+    bool isEmpty() const {return regions.empty();}
+    const QString& filename() const {return this->file;}
+    const QPointF& origin() const {return this->top_left;}
+
+    /* patches, the one of label l at l-1 */
+    uint regionsCount() const {return regions.size();}
+    const region& regionOf(uint16_t label) const {return regions[label-1];}
+    /* true if a patch is painted with the colour of the resource */
+    bool paints(uint8_t type) const {
+        for(const region& patch : regions) {
+            if(patch.type == type)
+                return true;
+        }
+        return false;
+    }
+
+    /* label of the area under the point, 0 if empty space or outside the mask */
+    uint16_t labelAt(QPointF point) const {
+        int x = (int)floor(point.x()-top_left.x());
+        int y = (int)floor(point.y()-top_left.y());
+        if(x < 0 || y < 0 || x >= width || y >= height) {
+            return 0;
+        }
+        return labels[y*width+x];
+    }
+
+    /* pixels from the point to the nearest point with a different label (lower bound), outside the
+     * mask the distance to the mask (all the patches are inside it) */
+    double boundaryDistance(QPointF point) const {
+        double px = point.x()-top_left.x(), py = point.y()-top_left.y();
+        int x = (int)floor(px);
+        int y = (int)floor(py);
+        if(x < 0 || y < 0 || x >= width || y >= height) {
+            double dx = std::max(std::max(-px, px-width), 0.0);
+            double dy = std::max(std::max(-py, py-height), 0.0);
+            return sqrt(dx*dx+dy*dy);
+        }
+        return distances[y*width+x];
+    }
+
+    void swap(AreaMask& other);
+
+private:
+    QString file;
+    QPointF top_left;
+    int width, height;
+    std::vector<uint16_t> labels;       /* label of each pixel, row by row */
+    std::vector<uint16_t> distances;    /* chessboard distance of each pixel from the nearest border pixel */
+    std::vector<region> regions;
+
+    AreaMask(const AreaMask&);
+    AreaMask& operator=(const AreaMask&);
+};
+
+#endif // AREAMASK_H
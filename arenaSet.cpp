@@ -0,0 +1,201 @@
+#ifndef ARENASET_CPP
+#define ARENASET_CPP
+
+#include "arenaSet.h"
+
+#include <limits>
+
+#include <math.h>
+
+ArenaSet::ArenaSet(mykilobotenvironment* primary, QObject *parent) : KilobotEnvironment(parent) {
+    this->pool = NULL;
+    arena_state first;
+    first.environment = primary;
+    arenas.push_back(first);
+}
+
+ArenaSet::~ArenaSet() {
+    clear();
+    delete this->pool;
+}
+
+void ArenaSet::clear() {
+    for(uint i=1; i<arenas.size(); i++) {
+        delete arenas[i].environment;
+    }
+    arenas.resize(1);
+    arenas[0].inbox.clear();
+    arenas[0].outbox.clear();
+    // the primary emits its messages again
+    arenas[0].environment->outbox = NULL;
+    route.clear();
+}
+
+mykilobotenvironment* ArenaSet::addArena(const ExperimentConfig& config, uint resources) {
+    arena_state added;
+    added.environment = new mykilobotenvironment();
+    added.environment->configure(config);
+    added.environment->resourcesCount = resources;
+    added.environment->reset();
+    arenas.push_back(added);
+    return added.environment;
+}
+
+void ArenaSet::save(QDataStream& out) const {
+    out << (quint32)(arenas.size()-1);
+    for(uint i=1; i<arenas.size(); i++) {
+        out << arenas[i].environment->saveState();
+    }
+}
+
+bool ArenaSet::restore(QDataStream& in) {
+    quint32 count;
+    in >> count;
+    if(in.status() != QDataStream::Ok || count != arenas.size()-1) {
+        return false;
+    }
+
+    // restore in new environments, the current ones are replaced only if all the states are valid
+    std::vector<mykilobotenvironment*> restored;
+    bool valid = true;
+    for(uint i=0; i<count && valid; i++) {
+        QByteArray state;
+        in >> state;
+        restored.push_back(new mykilobotenvironment());
+        valid = in.status() == QDataStream::Ok && restored.back()->restoreState(state);
+    }
+    if(!valid) {
+        for(mykilobotenvironment* environment : restored) {
+            delete environment;
+        }
+        return false;
+    }
+    for(uint i=1; i<arenas.size(); i++) {
+        delete arenas[i].environment;
+        arenas[i].environment = restored[i-1];
+        arenas[i].inbox.clear();
+        arenas[i].outbox.clear();
+    }
+
+    // every kb stays in the arena whose registry holds it
+    route.clear();
+    for(uint i=0; i<arenas.size(); i++) {
+        const KilobotRegistry& registry = arenas[i].environment->kilobots;
+        for(uint k=0; k<registry.size(); k++) {
+            kilobot_id id = registry.ids()[k];
+            if(id >= route.size()) {
+                route.resize(id+1, -1);
+            }
+            route[id] = i;
+        }
+    }
+    return true;
+}
+
+uint ArenaSet::routeOf(Kilobot& kilobot) {
+    kilobot_id id = kilobot.getID();
+    if(id < route.size() && route[id] >= 0) {
+        return route[id];
+    }
+    if(id >= route.size()) {
+        route.resize(id+1, -1);
+    }
+
+    // the arena that contains the kb, the one with the nearest boundary otherwise
+    QPointF position = kilobot.getPosition();
+    uint nearest = 0;
+    double nearest_distance = std::numeric_limits<double>::max();
+    for(uint i=0; i<arenas.size(); i++) {
+        const ExperimentConfig& config = arenas[i].environment->configuration();
+        double distance = sqrt(pow(position.x()-config.arena_center_x,2)+pow(position.y()-config.arena_center_y,2))-config.arena_size;
+        if(distance < nearest_distance) {
+            nearest = i;
+            nearest_distance = distance;
+        }
+        if(distance <= 0) {
+            break;
+        }
+    }
+    route[id] = nearest;
+    return nearest;
+}
+
+uint ArenaSet::kilobots() const {
+    uint kilobots = 0;
+    for(const arena_state& a : arenas) {
+        kilobots += a.environment->kilobots.size();
+    }
+    return kilobots;
+}
+
+QVector<uint8_t> ArenaSet::tallyQuorum() {
+    QVector<uint8_t> totals = arenas[0].environment->tallyQuorum();
+    for(uint i=1; i<arenas.size(); i++) {
+        QVector<uint8_t> arena_totals = arenas[i].environment->tallyQuorum();
+        for(int r=0; r<totals.size() && r<arena_totals.size(); r++) {
+            totals[r] += arena_totals[r];
+        }
+    }
+    return totals;
+}
+
+void ArenaSet::updateVirtualSensor(Kilobot kilobot) {
+    if(arenas.size() == 1) {
+        arenas[0].environment->updateVirtualSensor(kilobot);
+        return;
+    }
+    arenas[routeOf(kilobot)].inbox.push_back(kilobot);
+}
+
+void ArenaSet::update() {
+    mykilobotenvironment* primary = arenas[0].environment;
+    if(arenas.size() == 1) {
+        primary->update();
+        return;
+    }
+
+    // the further arenas follow the phase and the timers of the primary one
+    for(uint i=1; i<arenas.size(); i++) {
+        mykilobotenvironment* environment = arenas[i].environment;
+        environment->time = primary->time;
+        environment->isCommunicationTime = primary->isCommunicationTime;
+        environment->lastTransitionTime = primary->lastTransitionTime;
+        environment->ongoingRuntimeIdentification = primary->ongoingRuntimeIdentification;
+        environment->minTimeBetweenTwoMessages = primary->minTimeBetweenTwoMessages;
+    }
+    if(this->pool == NULL || this->pool->size() != arenas.size()) {
+        delete this->pool;
+        this->pool = new WorkStealingPool(arenas.size());
+    }
+    for(arena_state& a : arenas) {
+        a.environment->outbox = &a.outbox;
+    }
+
+    // each arena only touches its own environment, inbox and outbox
+    pool->parallelFor(arenas.size(), [this](uint32_t task, uint32_t) {
+        arena_state& a = arenas[task];
+        for(Kilobot& kilobot : a.inbox) {
+            a.environment->updateVirtualSensor(kilobot);
+        }
+        a.inbox.clear();
+    });
+    // the horizon measured by the primary one with these sensor updates, that its update computes
+    // again with no change
+    primary->updatePredictionHorizon();
+    for(uint i=1; i<arenas.size(); i++) {
+        arenas[i].environment->predictionHorizon = primary->predictionHorizon;
+    }
+    pool->parallelFor(arenas.size(), [this](uint32_t task, uint32_t) {
+        arenas[task].environment->update();
+    });
+
+    // merge the messages in the transmit stream
+    for(arena_state& a : arenas) {
+        for(const kilobot_message& message : a.outbox) {
+            emit transmitKiloState(message);
+        }
+        a.outbox.clear();
+    }
+}
+
+#endif // ARENASET_CPP
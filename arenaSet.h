@@ -0,0 +1,88 @@
+/**
+ * Several arenas under the same camera, each one served by its own environment.
+ *
+ * The set is the environment ARK sends the sensor updates to. A kb is routed to the arena that
+ * contains its first position (the nearest one if none) and stays there, as the arenas are
+ * walled. With a single arena the updates go straight to the primary environment, as without the
+ * set. With more arenas the updates of a tick are queued per arena and, at update(), every arena
+ * classifies its kbs and steps its resources on its own worker thread: the tick lasts as the
+ * slowest arena, not as the sum of all of them. The messages of each arena are queued in its
+ * outbox and emitted afterwards from the calling thread, arena after arena.
+ *
+ * The phase (exploration or communication) is broadcast to the whole swarm, so the further arenas
+ * follow the timers of the primary one, copied at every update. The prediction horizon is measured
+ * by the primary one only, once the sensor updates of the tick are in, and copied before the
+ * updates. Each arena counts its own quorum.
+ *
+ * The state of the further arenas is saved with save() in the snapshot of the experiment, next to
+ * the one of the primary environment; the routing of the kbs follows from their registries.
+ */
+
+#ifndef ARENASET_H
+#define ARENASET_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <QObject>
+#include <QVector>
+#include <QDataStream>
+
+#include <kilobotenvironment.h>
+#include "kilobot.h"
+#include "complexityEnvironment.h"
+#include "experimentConfig.h"
+#include "workStealingPool.h"
+
+class ArenaSet : public KilobotEnvironment {
+ Q_OBJECT
+public:
+    /* the primary environment is arena 0, it is not owned by the set */
+    explicit ArenaSet(mykilobotenvironment* primary, QObject *parent=0);
+    ~ArenaSet();
+
+    /* destroy the further arenas and forget the routing of the kbs */
+    void clear();
+    /* add an arena in the region of the configuration (arena_center_x/y, arena_size), reset with resources resources */
+    mykilobotenvironment* addArena(const ExperimentConfig& config, uint resources);
+
+    /* the saveState of every further arena */
+    void save(QDataStream& out) const;
+    /* replace the further arenas with the ones of save, false (arenas untouched) if not valid or if their number differs */
+    bool restore(QDataStream& in);
+
+    uint size() const {return arenas.size();}
+    mykilobotenvironment* arena(uint index) const {return arenas[index].environment;}
+
+    /* arena of the kb, routed on its position if seen for the first time */
+    mykilobotenvironment* arenaOf(Kilobot& kilobot) {return arenas[routeOf(kilobot)].environment;}
+    /* arena of the kb, NULL if never seen */
+    mykilobotenvironment* arenaOf(kilobot_id id) const {
+        return id < route.size() && route[id] >= 0 ? arenas[route[id]].environment : NULL;
+    }
+
+    /* kilobots registered in all the arenas */
+    uint kilobots() const;
+    /* tallyQuorum of all the arenas, summed by resource */
+    QVector<uint8_t> tallyQuorum();
+
+public slots:
+    void update();
+    void updateVirtualSensor(Kilobot kilobot);
+
+private:
+    struct arena_state {
+        mykilobotenvironment* environment;
+        std::vector<Kilobot> inbox;             /* sensor updates of the tick */
+        std::vector<kilobot_message> outbox;    /* messages of the tick */
+    };
+
+    std::vector<arena_state> arenas;
+    std::vector<int16_t> route; /* arena of each kb id, -1 if not seen yet */
+    WorkStealingPool* pool;     /* one worker per arena, created at the first update with several arenas */
+
+    /* index of the arena of the kb, routed on its position if seen for the first time */
+    uint routeOf(Kilobot& kilobot);
+};
+
+#endif // ARENASET_H
@@ -0,0 +1,72 @@
+#-------------------------------------------------
+#
+# Microbenchmarks of the plugin and controller hot paths
+# run: ./complexityBenchmark [--filter=name] [--min-time=seconds] [--csv]
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = complexityBenchmark
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -fopenmp-simd
+
+# the plugin sources and the host replacement of kilolib.h
+INCLUDEPATH += .. .
+
+SOURCES += \
+    main.cpp \
+    ../kilobot.cpp \
+    ../complexityEnvironment.cpp \
+    ../arenaSet.cpp \
+    ../kilobotRegistry.cpp \
+    ../experimentConfig.cpp \
+    ../areaMask.cpp \
+    ../objectPool.cpp \
+    ../workStealingPool.cpp \
+    ../parallelStepper.cpp \
+    ../kinematics.cpp \
+    ../irChannel.cpp \
+    ../tickProfiler.cpp \
+    ../replayLog.cpp \
+    ../latencyPredictor.cpp \
+    ../trackingHandoff.cpp \
+    ../meanFieldModel.cpp \
+    ../stochasticSwarm.cpp \
+    ../kilobot_c_code/message_t_list.c \
+    ../kilobot_c_code/resource_codec.c
+
+HEADERS += \
+    kilolib.h \
+    ../kilobot.h \
+    ../kilobotenvironment.h \
+    ../complexityEnvironment.h \
+    ../arenaSet.h \
+    ../kilobotRegistry.h \
+    ../poseFilter.h \
+    ../experimentConfig.h \
+    ../objectPool.h \
+    ../workStealingPool.h \
+    ../parallelStepper.h \
+    ../kinematics.h \
+    ../irChannel.h \
+    ../tickProfiler.h \
+    ../replayLog.h \
+    ../latencyPredictor.h \
+    ../trackingHandoff.h \
+    ../spscRing.h \
+    ../meanFieldModel.h \
+    ../stochasticSwarm.h \
+    ../resources.h \
+    ../area.h \
+    ../areaMask.h \
+    ../resourceColours.h \
+    ../kilobot_c_code/resource_codec.h
+
+INCLUDEPATH += /usr/local/include/
+LIBS += -L/usr/local/lib \
+        -lopencv_core
@@ -0,0 +1,17 @@
+/*
+ * Minimal replacement of kilolib.h used to build the host side benchmarks of the
+ * kilobot C code (only the message structure is needed by message_t_list).
+ */
+
+#ifndef KILOLIB_HOST_H
+#define KILOLIB_HOST_H
+
+#include <stdint.h>
+
+typedef struct __attribute__((__packed__)) {
+    uint8_t data[9];
+    uint8_t type;
+    uint16_t crc;
+} message_t;
+
+#endif // KILOLIB_HOST_H
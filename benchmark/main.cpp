@@ -0,0 +1,513 @@
+/**
+ * Microbenchmarks of the plugin and controller hot paths.
+ *
+ * Each benchmark is run with an increasing number of iterations until it lasts at least
+ * min-time seconds, the time per operation is then reported. Results are printed on stdout
+ * as JSON (default) or CSV so that different builds can be compared before deploying a new
+ * plugin in the arena.
+ *
+ * With --scaling the benchmarks are not run: the simulated swarm of ParallelStepper is stepped
+ * with 1 to max-threads threads instead, and its scaling report is printed.
+ *
+ * usage: complexityBenchmark [--filter=substring] [--min-time=seconds] [--csv] [--scaling[=max-threads]]
+ */
+
+#include "complexityEnvironment.h"
+#include "arenaSet.h"
+#include "resources.h"
+#include "area.h"
+#include "kilobot.h"
+#include "poseFilter.h"
+#include "trackingHandoff.h"
+#include "meanFieldModel.h"
+#include "stochasticSwarm.h"
+#include "parallelStepper.h"
+#include "irChannel.h"
+#include "kinematics.h"
+
+extern "C" {
+#include "kilobot_c_code/message_t_list.h"
+uint16_t mtl_clean_old(node_t** head, uint32_t time);
+void mtl_push_back(node_t *head, node_t* new_node);
+uint16_t mtl_is_message_present(node_t* head, message_t msg);
+node_t* mtl_get_first_not_rebroadcasted(node_t* head);
+uint16_t mtl_size(node_t* head);
+void mtl_clean_list(node_t** head);
+}
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <functional>
+#include <random>
+#include <thread>
+
+#include <QtGlobal>
+
+/* prevents the compiler from optimizing away the benchmarked work */
+static volatile double sink;
+
+struct BenchmarkResult {
+    std::string name;
+    uint64_t iterations;
+    double ns_per_op;
+};
+
+/*
+ * a benchmark gets the number of iterations to run and returns the number of operations done
+ * (usually the iterations, more if one iteration covers several operations)
+ */
+typedef std::function<uint64_t(uint64_t iterations)> benchmark_function;
+
+static BenchmarkResult runBenchmark(const std::string& name, benchmark_function f, double min_time) {
+    uint64_t iterations = 1;
+    while(true) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        uint64_t operations = f(iterations);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        if(seconds >= min_time || iterations >= (1ull << 40)) {
+            BenchmarkResult result;
+            result.name = name;
+            result.iterations = operations;
+            result.ns_per_op = seconds*1e9/operations;
+            return result;
+        }
+        // aim a bit above min_time
+        double factor = seconds > 0 ? 1.4*min_time/seconds : 100;
+        iterations = (uint64_t)(iterations*std::min(std::max(factor, 2.0), 100.0));
+    }
+}
+
+/* areas far from each other as generated for the experiment */
+static QVector<Resource*> generateResources() {
+    QVector<Area> oth_areas;
+    QVector<Resource*> resources;
+    for(uint type=0; type<3; type++) {
+        resources.push_back(new Resource(type, ARENA_CENTER, 146, 1, oth_areas));
+    }
+    return resources;
+}
+
+static void deleteResources(QVector<Resource*>& resources) {
+    for(Resource* r : resources) {
+        delete r;
+    }
+    resources.clear();
+}
+
+int main(int argc, char** argv) {
+    std::string filter;
+    double min_time = 0.2;
+    bool csv = false;
+    uint32_t scaling_threads = 0;
+    for(int i=1; i<argc; i++) {
+        if(strncmp(argv[i], "--filter=", 9) == 0) {
+            filter = argv[i]+9;
+        } else if(strncmp(argv[i], "--min-time=", 11) == 0) {
+            min_time = atof(argv[i]+11);
+        } else if(strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else if(strcmp(argv[i], "--scaling") == 0) {
+            scaling_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        } else if(strncmp(argv[i], "--scaling=", 10) == 0 && atoi(argv[i]+10) > 0) {
+            scaling_threads = atoi(argv[i]+10);
+        } else {
+            fprintf(stderr, "usage: %s [--filter=substring] [--min-time=seconds] [--csv] [--scaling[=max-threads]]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // the checksum must be the same on all the lines
+    if(scaling_threads > 0) {
+        printf("%s", ParallelStepper::scalingReport(scaling_threads).toStdString().c_str());
+        return 0;
+    }
+
+    // fixed seeds so that all builds run the same workload
+    qsrand(42);
+    std::default_random_engine re(42);
+    std::uniform_real_distribution<double> arena(ARENA_CENTER-ARENA_SIZE, ARENA_CENTER+ARENA_SIZE);
+
+    std::vector<std::pair<std::string, benchmark_function>> benchmarks;
+
+    /************************************/
+    /* plugin: areas and resources      */
+    /************************************/
+    benchmarks.push_back(std::make_pair(std::string("Area::doStep"), benchmark_function([](uint64_t iterations) {
+        Area area(0, 0, QPointF(ARENA_CENTER, ARENA_CENTER), 146, "quadratic");
+        for(uint64_t i=0; i<iterations; i++) {
+            area.kilobots_in_area = i%3;
+            sink = area.doStep();
+        }
+        return iterations;
+    })));
+
+    benchmarks.push_back(std::make_pair(std::string("Area::isInside"), benchmark_function([&](uint64_t iterations) {
+        Area area(0, 0, QPointF(ARENA_CENTER, ARENA_CENTER), 146, "quadratic");
+        std::vector<QPointF> points(1024);
+        for(QPointF& p : points) {
+            p = QPointF(arena(re), arena(re));
+        }
+        uint64_t inside = 0;
+        for(uint64_t i=0; i<iterations; i++) {
+            inside += area.isInside(points[i%points.size()]);
+        }
+        sink = inside;
+        return iterations;
+    })));
+
+    benchmarks.push_back(std::make_pair(std::string("Resource::doStep"), benchmark_function([](uint64_t iterations) {
+        QVector<Resource*> resources = generateResources();
+        for(uint64_t i=0; i<iterations; i++) {
+            // one occupied area, moving at every step
+            std::vector<Area*>& areas = resources[0]->areas;
+            areas[(i+areas.size()-1)%areas.size()]->kilobots_in_area = 0;
+            areas[i%areas.size()]->kilobots_in_area = 1;
+            resources[0]->doStep();
+        }
+        sink = resources[0]->getPopulation();
+        deleteResources(resources);
+        return iterations;
+    })));
+
+    benchmarks.push_back(std::make_pair(std::string("Resource::generate"), benchmark_function([](uint64_t iterations) {
+        for(uint64_t i=0; i<iterations; i++) {
+            QVector<Resource*> resources = generateResources();
+            sink = resources[2]->areas.size();
+            deleteResources(resources);
+        }
+        return iterations;
+    })));
+
+    /************************************/
+    /* plugin: mean-field prediction    */
+    /************************************/
+    benchmarks.push_back(std::make_pair(std::string("MeanFieldModel::advanceTo(256 sets, 600 s)"), benchmark_function([&](uint64_t iterations) {
+        QVector<Resource*> resources = generateResources();
+        MeanFieldModel::parameters parameters = MeanFieldModel::fromResources(resources, 50, ARENA_SIZE, EXPLORATION_TIME, COMMUNICATION_TIME);
+        deleteResources(resources);
+        std::uniform_real_distribution<double> unit(0, 1);
+        for(uint64_t i=0; i<iterations; i++) {
+            MeanFieldModel model;
+            for(uint s=0; s<256; s++) {
+                MeanFieldModel::parameters p = parameters;
+                p.robots = 10+190*unit(re);
+                p.lambda = parameters.lambda*(0.5+unit(re));
+                p.committed = {0.1*unit(re), 0.1*unit(re), 0.1*unit(re)};
+                model.add(p);
+            }
+            model.advanceTo(600);
+            sink = model.population(255, 0);
+        }
+        // one operation is one parameter set
+        return iterations*256;
+    })));
+
+    benchmarks.push_back(std::make_pair(std::string("StochasticSwarm::simulate(50 robots, 600 s)"), benchmark_function([&](uint64_t iterations) {
+        QVector<Resource*> resources = generateResources();
+        MeanFieldModel::parameters parameters = MeanFieldModel::fromResources(resources, 50, ARENA_SIZE, EXPLORATION_TIME, COMMUNICATION_TIME);
+        deleteResources(resources);
+        StochasticSwarm swarm(parameters);
+        for(uint64_t i=0; i<iterations; i++) {
+            StochasticSwarm::replica_result result = swarm.simulate(600, 0, i);
+            sink = result.exploitation[0];
+        }
+        // one operation is one replica
+        return iterations;
+    })));
+
+    /************************************/
+    /* plugin: virtual sensor           */
+    /************************************/
+    const uint synthetic_robots = 100;
+    benchmarks.push_back(std::make_pair(std::string("mykilobotenvironment::updateVirtualSensor"), benchmark_function([&](uint64_t iterations) {
+        mykilobotenvironment environment;
+        for(uint k=0; k<synthetic_robots; k++) {
+            environment.kilobots.add(k);
+        }
+        environment.minTimeBetweenTwoMessages = 0;
+        std::vector<Kilobot> robots;
+        for(uint k=0; k<synthetic_robots; k++) {
+            robots.push_back(Kilobot(k, QPointF(arena(re), arena(re)), QPointF(1, 1), (lightColour)(k%4)));
+        }
+        for(uint64_t i=0; i<iterations; i++) {
+            // every robot gets a message (time always advances)
+            environment.time = i+1;
+            environment.updateVirtualSensor(robots[i%synthetic_robots]);
+        }
+        return iterations;
+    })));
+
+    benchmarks.push_back(std::make_pair(std::string("ArenaSet::update(4 arenas, 100 robots each)"), benchmark_function([&](uint64_t iterations) {
+        // four arenas in the corners of the image, one operation is one tick of all of them
+        const double arena_size = ARENA_SIZE/2;
+        mykilobotenvironment primary;
+        ExperimentConfig config;
+        config.arena_center_x = config.arena_center_y = ARENA_CENTER-arena_size;
+        config.arena_size = arena_size;
+        primary.configure(config);
+        primary.reset();
+        ArenaSet arenas(&primary);
+        for(uint i=1; i<4; i++) {
+            config.arena_center_x = ARENA_CENTER+(i%2 ? arena_size : -arena_size);
+            config.arena_center_y = ARENA_CENTER+(i/2 ? arena_size : -arena_size);
+            arenas.addArena(config, 3);
+        }
+        std::uniform_real_distribution<double> offset(-arena_size*0.7, arena_size*0.7);
+        std::vector<Kilobot> robots;
+        for(uint k=0; k<4*synthetic_robots; k++) {
+            const ExperimentConfig& region = arenas.arena(k%4)->configuration();
+            robots.push_back(Kilobot(k, QPointF(region.arena_center_x+offset(re), region.arena_center_y+offset(re)), QPointF(1, 1),
+                                     (lightColour)(k%4)));
+        }
+        for(uint64_t i=0; i<iterations; i++) {
+            primary.time = i+1;
+            for(Kilobot& robot : robots) {
+                arenas.updateVirtualSensor(robot);
+            }
+            arenas.update();
+        }
+        sink = arenas.kilobots();
+        return iterations;
+    })));
+
+    benchmarks.push_back(std::make_pair(std::string("mykilobotenvironment::reset"), benchmark_function([](uint64_t iterations) {
+        // resources and areas are carved from the pool of the environment, rewound at every reset
+        mykilobotenvironment environment;
+        for(uint64_t i=0; i<iterations; i++) {
+            environment.reset();
+        }
+        sink = environment.resources.size();
+        return iterations;
+    })));
+
+    benchmarks.push_back(std::make_pair(std::string("mykilobotenvironment::packSensorMessage"), benchmark_function([](uint64_t iterations) {
+        uint64_t packed = 0;
+        for(uint64_t i=0; i<iterations; i++) {
+            double utilities[3] = {(i%32)/31.0, ((i/32)%32)/31.0, ((i/1024)%32)/31.0};
+            kilobot_message message = mykilobotenvironment::packSensorMessage(i%127, (i/4)%8, utilities, 3, i%4);
+            packed += message.id+message.type+message.data;
+        }
+        sink = packed;
+        return iterations;
+    })));
+
+    benchmarks.push_back(std::make_pair(std::string("mykilobotenvironment::packSensorMessage(8 resources)"), benchmark_function([](uint64_t iterations) {
+        uint64_t packed = 0;
+        double utilities[MAX_RESOURCES];
+        for(uint r=0; r<MAX_RESOURCES; r++) {
+            utilities[r] = (r+1)/(double)MAX_RESOURCES;
+        }
+        for(uint64_t i=0; i<iterations; i++) {
+            kilobot_message message = mykilobotenvironment::packSensorMessage(i%127, i%256, utilities, MAX_RESOURCES, i%4);
+            packed += message.id+message.type+message.data;
+        }
+        sink = packed;
+        return iterations;
+    })));
+
+    /************************************/
+    /* plugin: tracking buffers         */
+    /************************************/
+    benchmarks.push_back(std::make_pair(std::string("ColourBuffer::getAvgColour"), benchmark_function([](uint64_t iterations) {
+        ColourBuffer buffer(5);
+        uint64_t colours = 0;
+        for(uint64_t i=0; i<iterations; i++) {
+            buffer.addColour((lightColour)(i%4));
+            colours += buffer.getAvgColour();
+        }
+        sink = colours;
+        return iterations;
+    })));
+
+    benchmarks.push_back(std::make_pair(std::string("PositionBuffer::getOrientationFromPositions"), benchmark_function([](uint64_t iterations) {
+        PositionBuffer buffer(6);
+        double orientation = 0;
+        for(uint64_t i=0; i<iterations; i++) {
+            buffer.addPosition(QPointF(i%100, (i*7)%100));
+            orientation += buffer.getOrientationFromPositions().x();
+        }
+        sink = orientation;
+        return iterations;
+    })));
+
+    // a frame of 100 kbs through the ring, as from the tracking to run()
+    benchmarks.push_back(std::make_pair(std::string("TrackingHandoff::track+drain"), benchmark_function([](uint64_t iterations) {
+        TrackingHandoff handoff;
+        std::vector<TrackingHandoff::robot_snapshot> records;
+        std::vector<Kilobot> robots;
+        for(uint k=0; k<100; k++) {
+            robots.push_back(Kilobot(k, QPointF(k, k), QPointF(1, 1), (lightColour)(k%4)));
+        }
+        uint64_t drained = 0;
+        for(uint64_t i=0; i<iterations; i++) {
+            handoff.track(robots[i%robots.size()]);
+            if(i%robots.size() == robots.size()-1) {
+                handoff.drain(records);
+                drained += records.size();
+            }
+        }
+        sink = drained;
+        return iterations;
+    })));
+
+    benchmarks.push_back(std::make_pair(std::string("PoseFilter::update"), benchmark_function([](uint64_t iterations) {
+        PoseFilter filter;
+        filter.clear();
+        double heading = 0;
+        for(uint64_t i=0; i<iterations; i++) {
+            filter.update(QPointF(i%100, (i*7)%100));
+            heading += filter.heading();
+        }
+        sink = heading;
+        return iterations;
+    })));
+
+    /************************************/
+    /* simulation: kinematics           */
+    /************************************/
+    // one operation is a tick of 10k robots, the target is above 1000 ticks per second (below 1 ms)
+    benchmarks.push_back(std::make_pair(std::string("KilobotKinematics::step/10k"), benchmark_function([](uint64_t iterations) {
+        // kilobot: ~1 cm/s at 31 ticks per second and pi/5 rad/s, 5 px of radius
+        KilobotKinematics kinematics(10000, 5, 0.3, M_PI/5/31, 42);
+        kinematics.scatter();
+        for(uint64_t i=0; i<iterations; i++) {
+            kinematics.step();
+        }
+        sink = kinematics.x[0];
+        return iterations;
+    })));
+
+    /************************************/
+    /* simulation: infrared channel     */
+    /************************************/
+    // the swarm spreads at the same density (a robot every 40x40 pixels) whatever its size, so
+    // with the spatial hash the time per robot must stay about the same: one operation is a robot
+    for(uint32_t robots : {1000u, 4000u, 16000u}) {
+        benchmarks.push_back(std::make_pair(std::string("IrChannel::step/")+std::to_string(robots/1000)+"k", benchmark_function([robots](uint64_t iterations) {
+            float side = 40*sqrtf(robots);
+            std::default_random_engine re(robots);
+            std::uniform_real_distribution<float> place(0, side);
+            std::vector<float> x(robots), y(robots);
+            for(uint32_t i=0; i<robots; i++) {
+                x[i] = place(re);
+                y[i] = place(re);
+            }
+            // a quarter of the robots sends at every tick, as the gossip of complexity.c
+            std::vector<kilobot_ir_message> messages(robots);
+            IrChannel channel(60, 8, 0.9, 42);
+            channel.setTxCallback([&messages](uint16_t robot) {
+                return (robot%4 == 0) ? &messages[robot] : (kilobot_ir_message*)NULL;
+            });
+            uint64_t received = 0;
+            channel.setRxCallback([&received](uint16_t, const kilobot_ir_message&, double) {
+                received++;
+            });
+            for(uint64_t i=0; i<iterations; i++) {
+                channel.step(x.data(), y.data(), robots);
+            }
+            sink = received;
+            return iterations*robots;
+        })));
+    }
+
+    /************************************/
+    /* controller: message_t_list.c     */
+    /************************************/
+    // a list as long as the kilobot one with messages from 30 different robots
+    const uint16_t list_length = 30;
+    benchmarks.push_back(std::make_pair(std::string("mtl_push_back+mtl_clean_old"), benchmark_function([&](uint64_t iterations) {
+        node_t* head = NULL;
+        for(uint64_t i=0; i<iterations; i++) {
+            node_t* node = (node_t*)malloc(sizeof(node_t));
+            memset(node, 0, sizeof(node_t));
+            node->msg.data[0] = i%list_length;
+            node->time_stamp = i;
+            if(head == NULL) {
+                head = node;
+                head->next = NULL;
+            } else {
+                mtl_push_back(head, node);
+            }
+            // keep at most list_length messages
+            if(i >= list_length) {
+                mtl_clean_old(&head, i-list_length+1);
+            }
+        }
+        if(head) {
+            mtl_clean_list(&head);
+        }
+        return iterations;
+    })));
+
+    benchmarks.push_back(std::make_pair(std::string("mtl_is_message_present"), benchmark_function([&](uint64_t iterations) {
+        node_t* head = NULL;
+        for(uint16_t i=0; i<list_length; i++) {
+            node_t* node = (node_t*)calloc(1, sizeof(node_t));
+            node->msg.data[0] = i;
+            node->next = head;
+            head = node;
+        }
+        message_t msg;
+        memset(&msg, 0, sizeof(msg));
+        uint64_t found = 0;
+        for(uint64_t i=0; i<iterations; i++) {
+            // half of the lookups miss
+            msg.data[0] = i%(2*list_length);
+            found += mtl_is_message_present(head, msg);
+        }
+        sink = found;
+        mtl_clean_list(&head);
+        return iterations;
+    })));
+
+    benchmarks.push_back(std::make_pair(std::string("mtl_size+mtl_get_first_not_rebroadcasted"), benchmark_function([&](uint64_t iterations) {
+        node_t* head = NULL;
+        for(uint16_t i=0; i<list_length; i++) {
+            node_t* node = (node_t*)calloc(1, sizeof(node_t));
+            node->been_rebroadcasted = (i != 0);
+            node->next = head;
+            head = node;
+        }
+        uint64_t size = 0;
+        for(uint64_t i=0; i<iterations; i++) {
+            size += mtl_size(head);
+            size += mtl_get_first_not_rebroadcasted(head) != NULL;
+        }
+        sink = size;
+        mtl_clean_list(&head);
+        return iterations;
+    })));
+
+    /************************************/
+    /* run and report                   */
+    /************************************/
+    std::vector<BenchmarkResult> results;
+    for(const std::pair<std::string, benchmark_function>& b : benchmarks) {
+        if(!filter.empty() && b.first.find(filter) == std::string::npos) {
+            continue;
+        }
+        results.push_back(runBenchmark(b.first, b.second, min_time));
+        fprintf(stderr, "%-50s %12.1f ns/op\n", results.back().name.c_str(), results.back().ns_per_op);
+    }
+
+    if(csv) {
+        printf("name,iterations,ns_per_op\n");
+        for(const BenchmarkResult& r : results) {
+            printf("%s,%llu,%.3f\n", r.name.c_str(), (unsigned long long)r.iterations, r.ns_per_op);
+        }
+    } else {
+        printf("{\n  \"context\": {\"compiler\": \"%s\", \"qt\": \"%s\", \"min_time\": %.3f},\n", __VERSION__, QT_VERSION_STR, min_time);
+        printf("  \"benchmarks\": [\n");
+        for(size_t i=0; i<results.size(); i++) {
+            printf("    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f}%s\n", results[i].name.c_str(),
+                   (unsigned long long)results[i].iterations, results[i].ns_per_op, i+1 < results.size() ? "," : "");
+        }
+        printf("  ]\n}\n");
+    }
+
+    return 0;
+}
@@ -14,202 +14,562 @@
 #include <QtMath>
 #include <QColor>
 
+#include <QDataStream>
+
+#include <algorithm>
+#include <limits>
+
+#define ENVIRONMENT_STATE_VERSION 11
+// pixels removed from the distance to the nearest area boundary (see classifyKilobot)
+#define SAFE_RADIUS_MARGIN 1e-6
+// updates without a report after which a kb leaves its areas (see expireKilobots)
+#define MEMBERSHIP_EXPIRY 30
+
 mykilobotenvironment::mykilobotenvironment(QObject *parent) : KilobotEnvironment(parent) {
     // environment specifications
     this->ArenaX = 0.5;
     this->ArenaY = 0.5;
     this->ongoingRuntimeIdentification = false;
+    this->parallelSensing = false;
+    this->sensorPool = NULL;
+    this->profiler = NULL;
+    this->recorder = NULL;
+    this->outbox = NULL;
+    this->latency = NULL;
+    this->predictionHorizon = 0;
+    this->time = 0;
+    this->resourcePool = new ObjectPool();
+    this->resourcesCount = 3;
+    configure(ExperimentConfig());
 
     // define environment:
     // call any functions to setup features in the environment
     reset();
 }
 
+mykilobotenvironment::~mykilobotenvironment() {
+    delete this->sensorPool;
+    resources.clear();
+    delete this->resourcePool;
+}
+
+void mykilobotenvironment::configure(const ExperimentConfig& config) {
+    this->config = config;
+    // the switches are resolved here once, the per robot path has no test on them
+    if(config.global_quorum && config.real_utility) {
+        sensorPath = &mykilobotenvironment::senseKilobot<true, true>;
+        framePath = &mykilobotenvironment::senseFrame<true, true>;
+    } else if(config.global_quorum) {
+        sensorPath = &mykilobotenvironment::senseKilobot<true, false>;
+        framePath = &mykilobotenvironment::senseFrame<true, false>;
+    } else if(config.real_utility) {
+        sensorPath = &mykilobotenvironment::senseKilobot<false, true>;
+        framePath = &mykilobotenvironment::senseFrame<false, true>;
+    } else {
+        sensorPath = &mykilobotenvironment::senseKilobot<false, false>;
+        framePath = &mykilobotenvironment::senseFrame<false, false>;
+    }
+    dynamicAreas = config.area_respawn_time > 0 || !config.paths.empty();
+    resetDynamicAreas();
+
+    // the mask is labelled again only if another one is configured
+    if(config.area_mask.isEmpty()) {
+        areaMask.clear();
+    } else if(config.area_mask != areaMask.filename() || config.area_mask_origin != areaMask.origin()) {
+        QString error;
+        if(!areaMask.load(config.area_mask, config.area_mask_origin, &error)) {
+            qDebug() << error;
+            emit errorMessage(error);
+        }
+    }
+}
+
 void mykilobotenvironment::reset() {
     this->time = 0;
+    this->updatesCount = 0;
     this->minTimeBetweenTwoMessages = 0;
+    this->predictionHorizon = 0;
     this->ongoingRuntimeIdentification = false;
 
+    // the resources and areas of the previous run are destroyed, their memory is reused
     resources.clear();
-    kilobots_states.clear();
-    kilobots_positions.clear();
-    kilobots_colours.clear();
-
-    // generate quorum array
-    kilobots_quorum.clear();
-    QVector<uint8_t> colors_hits = {0,0,0};
-    // add 127 (max kilobots allowed)
-    for(uint i=0; i<127; i++){
-        kilobots_quorum.push_back(colors_hits);
-    }
+    resourcePool->rewind();
+    pendingFrame.clear();
 
     QVector<Area> oth_areas;
-    double area_radius = 146;
-    Resource* a = new Resource(0, ARENA_CENTER, area_radius, 1, oth_areas);
-    Resource* b = new Resource(1, ARENA_CENTER, area_radius, 1, oth_areas);
-    Resource* c = new Resource(2, ARENA_CENTER, area_radius, 1, oth_areas);
-    resources.push_back(a);
-    resources.push_back(b);
-    resources.push_back(c);
+    // a resource beyond the leds reported by the tracker could not be exploited (see resourceColours.h)
+    for(uint type=0; type<resourcesCount && type<TRACKED_RESOURCES; type++) {
+        // the resources painted in the mask have its patches as areas, the others generated circles
+        bool masked = areaMask.paints(type);
+        resources.push_back(resourcePool->create<Resource>(type, config.arena_size, config.area_radius, masked ? 0 : 1, oth_areas, resourcePool,
+                                                           QPointF(config.arena_center_x, config.arena_center_y)));
+        if(masked) {
+            resources.last()->generate(areaMask);
+        }
+    }
+    // the kilobots are registered again, with one quorum and membership entry per resource
+    kilobots.clear(resources.size());
+    resetDynamicAreas();
 
     isCommunicationTime = false;
     lastTransitionTime = this->time;
 }
 
 void mykilobotenvironment::update() {
+    updatePredictionHorizon();
+    if(this->recorder) {
+        recorder->recordUpdate(this->time, this->isCommunicationTime, this->lastTransitionTime, this->predictionHorizon);
+    }
+
+    // process the sensor updates buffered since the last update
+    // (occupancy must be counted before stepping the areas)
+    if(!pendingFrame.empty()) {
+        updateVirtualSensors(pendingFrame);
+        pendingFrame.clear();
+    }
+    expireKilobots();
+
     // if in communication time the enironment is frozen
     if(!this->isCommunicationTime) {
         // update resources and areas
-        for(Resource* r : resources) {
-            r->doStep();
+        for(int r=0; r<resources.size(); r++) {
+            depletedAreas.clear();
+            if(resources[r]->doStep(config.area_depletion, &depletedAreas)) {
+                for(uint a : depletedAreas) {
+                    removeArea(r, a);
+                }
+            }
+        }
+        if(this->dynamicAreas) {
+            updateDynamicAreas();
+        }
+    }
+    this->lastAreasUpdate = this->time;
+    this->updatesCount++;
+}
+
+void mykilobotenvironment::updatePredictionHorizon() {
+    // the kbs are classified at the delivery of their message until the next update
+    if(this->latency) {
+        this->predictionHorizon = config.sensing_latency > 0 ? latency->horizon(config.sensing_latency) : 0;
+    }
+}
+
+void mykilobotenvironment::expireKilobots() {
+    // a kb lost by the tracking is not classified again, it would be counted in its area forever
+    const uint resources_count = kilobots.resources();
+    const uint32_t* last_seen = kilobots.lastSeen();
+    for(uint i=0; i<kilobots.size(); i++) {
+        resource_mask& state = kilobots.states()[i];
+        int8_t& exploiting = kilobots.exploiting()[i];
+        if((exploiting < 0 && state == 0) || updatesCount-last_seen[i] <= MEMBERSHIP_EXPIRY) {
+            continue;
+        }
+        int16_t* over = kilobots.areas()+i*resources_count;
+        if(exploiting >= 0) {
+            resources[exploiting]->areas[over[exploiting]]->kilobots_in_area--;
         }
+        // as a kb not seen yet, its filter restarts when it is reported again
+        exploiting = -1;
+        state = 0;
+        for(uint r=0; r<resources_count; r++) {
+            over[r] = -1;
+        }
+        kilobots.safeRadii()[i] = -1;
+        kilobots.poses()[i].clear();
     }
 }
 
+void mykilobotenvironment::updateDynamicAreas() {
+    // the removed areas come back in order of removal
+    while(config.area_respawn_time > 0 && !removedAreas.empty()) {
+        std::pair<uint, uint> removed = removedAreas.front();
+        Area* a = resources[removed.first]->areas[removed.second];
+        if(a->removed_time+config.area_respawn_time > this->time) {
+            break;
+        }
+        removedAreas.pop_front();
+        if(!respawnArea(removed.first, removed.second)) {
+            // no room in the arena now, retry later
+            a->removed_time = this->time;
+            removedAreas.push_back(removed);
+        }
+    }
+
+    // move the areas along their paths, by the distance covered since the last update
+    double elapsed = this->time-this->lastAreasUpdate;
+    for(uint p=0; p<config.paths.size(); p++) {
+        const ExperimentConfig::area_path& path = config.paths[p];
+        if((int)path.resource >= resources.size() || path.area >= resources[path.resource]->areas.size()) {
+            continue;
+        }
+        QPointF position = resources[path.resource]->areas[path.area]->position;
+        double distance = path.speed*elapsed;
+        // at most one lap of the waypoints per update
+        for(uint w=0; w<path.waypoints.size() && distance > 0; w++) {
+            QPointF target = path.waypoints[pathWaypoints[p]];
+            double to_target = QLineF(position, target).length();
+            if(to_target > distance) {
+                position += (target-position)*(distance/to_target);
+                break;
+            }
+            position = target;
+            distance -= to_target;
+            pathWaypoints[p] = (pathWaypoints[p]+1)%path.waypoints.size();
+        }
+        moveArea(path.resource, path.area, position);
+    }
+}
+
+void mykilobotenvironment::resetDynamicAreas() {
+    pathWaypoints.assign(config.paths.size(), 0);
+    this->lastAreasUpdate = this->time;
+    removedAreas.clear();
+    for(int r=0; r<resources.size(); r++) {
+        for(uint a=0; a<resources[r]->areas.size(); a++) {
+            if(!resources[r]->areas[a]->active) {
+                removedAreas.push_back(std::make_pair(r, a));
+            }
+        }
+    }
+    const QVector<Resource*>& resources = this->resources;
+    std::stable_sort(removedAreas.begin(), removedAreas.end(), [&resources](const std::pair<uint, uint>& a, const std::pair<uint, uint>& b) {
+        return resources[a.first]->areas[a.second]->removed_time < resources[b.first]->areas[b.second]->removed_time;
+    });
+}
+
+void mykilobotenvironment::removeArea(uint resource, uint area) {
+    Area* a = resources[resource]->areas[area];
+    if(!a->active) {
+        return;
+    }
+    resources[resource]->remove(area, this->time);
+    removedAreas.push_back(std::make_pair(resource, area));
+    // the kbs over it exit it at their next classification
+    invalidateClassifications(a->position, a->radius);
+}
+
+bool mykilobotenvironment::respawnArea(uint resource, uint area) {
+    Area* a = resources[resource]->areas[area];
+    if(a->active || !resources[resource]->respawn(area)) {
+        return false;
+    }
+    // respawned before its time
+    std::deque<std::pair<uint, uint>>::iterator queued = std::find(removedAreas.begin(), removedAreas.end(), std::make_pair(resource, area));
+    if(queued != removedAreas.end()) {
+        removedAreas.erase(queued);
+    }
+    invalidateClassifications(a->position, a->radius);
+    return true;
+}
+
+void mykilobotenvironment::moveArea(uint resource, uint area, QPointF position) {
+    Area* a = resources[resource]->areas[area];
+    if(a->position == position) {
+        return;
+    }
+    // the kbs around the area before and after the move
+    invalidateClassifications(a->position, a->radius);
+    resources[resource]->move(area, position);
+    invalidateClassifications(a->position, a->radius);
+}
+
 // generate virtual sensors reading and send it to the kbs (same as for ARGOS)
 void mykilobotenvironment::updateVirtualSensor(Kilobot kilobot_entity) {
+    PROFILE_STAGE(profiler, SENSOR_UPDATE);
+
+    if(this->recorder) {
+        recorder->recordSensor(kilobot_entity.getID(), kilobot_entity.getPosition(), kilobot_entity.getVelocity(), kilobot_entity.getLedColour());
+    }
+    if(this->latency) {
+        latency->sensed(kilobot_entity.getID());
+    }
+
+    // in parallel sensing the frame is processed all at once at the next update
+    if(this->parallelSensing) {
+        pendingFrame.push_back(kilobot_entity);
+        return;
+    }
+
+    (this->*sensorPath)(kilobot_entity);
+}
+
+template<bool global_quorum, bool real_utility>
+void mykilobotenvironment::senseKilobot(Kilobot& kilobot_entity) {
+    uint index = kilobots.add(kilobot_entity.getID());
+    if(classifyKilobot<global_quorum, real_utility>(kilobot_entity, index, NULL)) {
+        sendVirtualSensorMessage<real_utility>(kilobot_entity, index);
+    }
+}
+
+void mykilobotenvironment::updateVirtualSensors(std::vector<Kilobot>& frame) {
+    (this->*framePath)(frame);
+}
+
+template<bool global_quorum, bool real_utility>
+void mykilobotenvironment::senseFrame(std::vector<Kilobot>& frame) {
+    if(frame.empty()) {
+        return;
+    }
+    if(this->sensorPool == NULL) {
+        this->sensorPool = new WorkStealingPool();
+    }
+
+    // per thread counters, one for each area of all resources
+    uint areas_count = 0;
+    for(Resource* r : resources) {
+        areas_count += r->areas.size();
+    }
+    workerAreaCounters.resize(sensorPool->size());
+    for(std::vector<int>& counters : workerAreaCounters) {
+        counters.assign(areas_count, 0);
+    }
+    // new kbs are registered before the parallel pass, the registry does not move during it
+    frameIndexes.resize(frame.size());
+    for(uint i=0; i<frame.size(); i++) {
+        frameIndexes[i] = kilobots.add(frame[i].getID());
+    }
+
+    // messages are sent from this thread in order of kilobot id; a kb reported twice in the frame
+    // is classified once, with its last report (two threads must not update the same membership)
+    std::vector<uint> order(frame.size());
+    for(uint i=0; i<order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&frame](uint a, uint b) {
+        return frame[a].getID() < frame[b].getID();
+    });
+    uint reported = 0;
+    for(uint i=0; i<order.size(); i++) {
+        if(i+1 < order.size() && frame[order[i]].getID() == frame[order[i+1]].getID()) {
+            continue;
+        }
+        order[reported++] = order[i];
+    }
+    order.resize(reported);
+
+    // classify, each robot only writes its own entries
+    std::vector<uint8_t> to_send(frame.size());
+    const uint robots_per_task = 16;
+    uint tasks = (order.size()+robots_per_task-1)/robots_per_task;
+    sensorPool->parallelFor(tasks, [&](uint32_t task, uint32_t worker) {
+        uint last = qMin((uint)order.size(), (task+1)*robots_per_task);
+        for(uint i=task*robots_per_task; i<last; i++) {
+            to_send[order[i]] = classifyKilobot<global_quorum, real_utility>(frame[order[i]], frameIndexes[order[i]],
+                                                                             workerAreaCounters[worker].data());
+        }
+    });
+
+    // reduce the occupancy changes into the areas
+    for(const std::vector<int>& counters : workerAreaCounters) {
+        uint area_index = 0;
+        for(Resource* r : resources) {
+            for(Area* a : r->areas) {
+                a->kilobots_in_area += counters[area_index++];
+            }
+        }
+    }
+
+    for(uint i : order) {
+        if(to_send[i]) {
+            sendVirtualSensorMessage<real_utility>(frame[i], frameIndexes[i]);
+        }
+    }
+}
+
+void mykilobotenvironment::invalidateClassifications() {
+    double* safe_radii = kilobots.safeRadii();
+    for(uint i=0; i<kilobots.size(); i++) {
+        safe_radii[i] = -1;
+    }
+}
+
+void mykilobotenvironment::invalidateClassifications(QPointF centre, double radius) {
+    // a cached classification holds while no area boundary crosses the safe circle of the kb, only
+    // the safe circles that overlap the circle can be crossed by its boundary or be inside it
+    const QPointF* safe_centres = kilobots.safeCentres();
+    double* safe_radii = kilobots.safeRadii();
+    for(uint i=0; i<kilobots.size(); i++) {
+        if(safe_radii[i] > 0 &&
+                pow(safe_centres[i].x()-centre.x(),2)+pow(safe_centres[i].y()-centre.y(),2) < pow(safe_radii[i]+radius,2)) {
+            safe_radii[i] = -1;
+        }
+    }
+}
+
+template<bool global_quorum, bool real_utility>
+bool mykilobotenvironment::classifyKilobot(Kilobot& kilobot_entity, uint index, int* area_changes) {
     // update local arrays
     // update kilobot position
-    kilobot_id k_id = kilobot_entity.getID();
-    this->kilobots_positions[k_id] = kilobot_entity.getPosition();
+    const uint resources_count = kilobots.resources();
+    kilobots.positions()[index] = kilobot_entity.getPosition();
+    kilobots.lastSeen()[index] = updatesCount;
+    // every sensor update is one tracking frame of the filter, also in communication time
+    PoseFilter& pose = kilobots.poses()[index];
+    pose.update(kilobot_entity.getPosition());
 
-    // update kilobot led colour (indicates the internal decision state of the kb)
+    // update kilobot led (indicates the internal decision state of the kb, see resourceLed)
     lightColour kb_colour = kilobot_entity.getLedColour();
-    if(kb_colour == lightColour::RED)
-        this->kilobots_colours[k_id] = Qt::red;     // committed resource 0
-    else if(kb_colour == lightColour::GREEN)
-        this->kilobots_colours[k_id] = Qt::green;   // committed resource 1
-    else if(kb_colour == lightColour::BLUE)
-        this->kilobots_colours[k_id] = Qt::blue;    // committed resource 2
-    else
-        this->kilobots_colours[k_id] = Qt::black;   // uncommitted
+    kilobots.leds()[index] = kb_colour;
 
     // if in communication time only update kilobots but avoid sending information to them
     if(this->isCommunicationTime) {
-#ifdef GLOBAL_QUORUM
-        // store for quorum
-        if(kilobots_colours[k_id]==Qt::red) {
-            kilobots_quorum[k_id][0] = kilobots_quorum[k_id][0]+1;
-        } else if(kilobots_colours[k_id]==Qt::green) {
-            kilobots_quorum[k_id][1] = kilobots_quorum[k_id][1]+1;
-        } else if(kilobots_colours[k_id]==Qt::blue) {
-            kilobots_quorum[k_id][2] = kilobots_quorum[k_id][2]+1;
-        }
-#endif
-        return;
+        if(global_quorum) {
+            // store for quorum
+            int committed = resourceOfLed(kb_colour);
+            if(committed >= 0 && committed < (int)resources_count) {
+                kilobots.quorum()[index*resources_count+committed]++;
+            }
+        }
+        return false;
     }
 
-    // used to update working kilbots
-    Qt::GlobalColor areaColors[3] = {Qt::red, Qt::green, Qt::blue};
-#ifndef REAL_UTILITY
-    // used later for sending the utility
-    double areasUt[3] = {0,0,0};
-#endif
     // initialize as on white space
-    this->kilobots_states[k_id] = (KilobotEnvironment::kilobot_arena_state)255; // start as over no area
+    resource_mask& state = kilobots.states()[index];
+    state = 0; // start as over no area
+    // membership of the kb: the occupancy only changes when it enters or exits an area
+    int16_t* over = kilobots.areas()+index*resources_count;
+    int8_t exploiting = -1;
+    Area* exploited_before = NULL;
+    Area* exploited_now = NULL;
+    int changed_before = -1, changed_now = -1;
+    // the kb is classified where it will be when it reads the message (the tracked position with a
+    // horizon of 0), extrapolating the filtered velocity, in pixels per tracking frame
+    QPointF position = kilobot_entity.getPosition()+pose.velocity()*predictionHorizon;
+    // the kb moves a few millimetres per frame: the areas under it are recomputed only when it
+    // gets farther from its last full classification than the nearest area boundary was
+    QPointF& safe_centre = kilobots.safeCentres()[index];
+    double& safe_radius_before = kilobots.safeRadii()[index];
+    bool cached = safe_radius_before > 0 &&
+            pow(position.x()-safe_centre.x(),2)+pow(position.y()-safe_centre.y(),2) < pow(safe_radius_before,2);
+    double safe_radius = std::numeric_limits<double>::max();
+    // the patches of the mask under the kb and their boundaries are read from the rasters, once
+    uint16_t mask_label = 0;
+    if(!cached && !areaMask.isEmpty()) {
+        mask_label = areaMask.labelAt(position);
+        safe_radius = areaMask.boundaryDistance(position);
+    }
+    // index of the first area of the resource in area_changes
+    uint resource_offset = 0;
     // cycle over the resources
-    for(Resource *r : resources) {
-        // and areas
-        for(Area *a : r->areas) {
-            // if inside
-            if(a->isInside(kilobot_entity.getPosition())) {
-                // check the color and update the area at the same time
-                if(this->kilobots_colours[k_id] == areaColors[r->type])  {
-                    a->kilobots_in_area++;
+    for(int r_index=0; r_index<resources.size(); r_index++) {
+        Resource* r = resources[r_index];
+        int16_t before = over[r_index];
+        if(before >= 0 && r_index == kilobots.exploiting()[index]) {
+            exploited_before = r->areas[before];
+            changed_before = resource_offset+before;
+        }
+        int16_t now = before;
+        if(!cached) {
+            now = -1;
+            for(uint i=0; i<r->areas.size(); i++) {
+                Area* a = r->areas[i];
+                // a removed area has no boundary
+                if(!a->active) {
+                    continue;
                 }
-                // update kilobot state
-                if(this->kilobots_states[k_id] != OUTSIDE_AREA)
-                    this->kilobots_states[k_id] = (KilobotEnvironment::kilobot_arena_state)(this->kilobots_states[k_id]+r->type*3);
-                else
-                    this->kilobots_states[k_id] = (KilobotEnvironment::kilobot_arena_state)r->type;
-#ifndef REAL_UTILITY
-                // update kb perception of utility (see below)
-                areasUt[r->type] = a->population;
-#endif
-                // break and go to the next resource
-                break;
+                if(a->mask) {
+                    if(now < 0 && a->label == mask_label) {
+                        now = i;
+                    }
+                    continue;
+                }
+                if(now < 0 && a->isInside(position)) {
+                    now = i;
+                }
+                double boundary = fabs(sqrt(pow(position.x()-a->position.x(),2)+pow(position.y()-a->position.y(),2))-a->radius);
+                safe_radius = std::min(safe_radius, boundary);
             }
         }
+        over[r_index] = now;
+
+        // if inside
+        if(now >= 0) {
+            Area* a = r->areas[now];
+            // check the color, the kb exploits the area
+            if(kb_colour == resourceLed(r->type))  {
+                exploiting = r_index;
+                exploited_now = a;
+                changed_now = resource_offset+now;
+            }
+            // update kilobot state
+            state |= 1 << r->type;
+        }
+        resource_offset += r->areas.size();
+    }
+
+    if(!cached) {
+        // the margin covers the rounding of isInside
+        safe_centre = position;
+        safe_radius_before = safe_radius-SAFE_RADIUS_MARGIN;
     }
 
+    // enter/exit transition
+    kilobots.exploiting()[index] = exploiting;
+    if(exploited_before != exploited_now) {
+        if(area_changes) {
+            if(changed_before >= 0)
+                area_changes[changed_before]--;
+            if(changed_now >= 0)
+                area_changes[changed_now]++;
+        } else {
+            if(exploited_before)
+                exploited_before->kilobots_in_area--;
+            if(exploited_now)
+                exploited_now->kilobots_in_area++;
+        }
+    }
+
+    return true;
+}
+
+template<bool real_utility>
+void mykilobotenvironment::sendVirtualSensorMessage(Kilobot& kilobot_entity, uint index) {
+    kilobot_id k_id = kilobot_entity.getID();
+    // used for sending the utility
+    // population of the area under the kb of each resource, when sent
+    double* areasUt = kilobots.utilities()+index*kilobots.resources();
+    const int16_t* over_areas = kilobots.areas()+index*kilobots.resources();
+
     // now we have everything up to date and everything we need
     // then if it is time to send the message to the kilobot send info to the kb
-    if(this->time - this->lastSent[k_id] > minTimeBetweenTwoMessages && !ongoingRuntimeIdentification){
-        lastSent[k_id] = this->time;
-        // create and fill the message
-        kilobot_message message; // this is a 24 bits field not the original kb message
-        // make sure to start clean
-        message.id = 0;
-        message.type = 0;
-        message.data = 0;
-
-        // !!! THE FOLLOWING IS OF EXTREME IMPORTANCE !!!
-        // NOTE although the message is defined as type, id and data, in ARK the fields type and id are swapped
-        // resulting in a mixed message. If you are not using the whole field this could lead to problems.
-        // To avoid it, consider to concatenate the message as ID, type and data.
-
-        /* Prepare the inividual kilobot's message         */
-        /* see README.md to understand about ARK messaging */
-        /* data has 3x24 bits divided as                   */
-        /*   ID 10b    type 4b  data 10b     <- ARK msg    */
-        /*  data[0]   data[1]   data[2]      <- kb msg     */
-        /* xxxx xxxy yyyy zzzz zwww wwtt     <- complexity */
-        /* x bits used for kilobot id                      */
-        /* y bits used for resource 0 population           */
-        /* z bits used for resource 1 population           */
-        /* w bits used for resource 2 population           */
-        /* t bits used for rotation toward the center      */
-
-        // 7 bits used for the id of the kilobot store in the first 10 bits of the message and shift left
-        message.id = k_id;
-        message.id = message.id << 3;
-        // 5 bits to signal are utility and proximity (i.e. 0 ut means over no area)
-        // get the state
-        KilobotEnvironment::kilobot_arena_state kst = this->kilobots_states[k_id];
-        if(kst == INSIDE_AREA_0 || kst == INSIDE_AREA_01 || kst == INSIDE_AREA_02 || kst == INSIDE_AREA_012) {
-#ifdef REAL_UTILITY
-            uint8_t ut = ceil(resources.at(0)->population*31);
-#else
-            uint8_t ut = ceil(areasUt[0]*31);
-#endif
-            message.id = message.id | (ut >> 2);
-            message.type = ut << 2;
-        }
-        if(kst == INSIDE_AREA_1 || kst == INSIDE_AREA_01 || kst == INSIDE_AREA_12 || kst == INSIDE_AREA_012) {
-#ifdef REAL_UTILITY
-            uint8_t ut = ceil(resources.at(1)->population*31);
-#else
-            uint8_t ut = ceil(areasUt[1]*31);
-#endif
-            message.type = message.type | (ut>>3);
-            message.data = ut;
-            message.data = message.data << 7;
-        }
-        if(kst == INSIDE_AREA_2 || kst == INSIDE_AREA_02 || kst == INSIDE_AREA_12 || kst == INSIDE_AREA_012) {
-#ifdef REAL_UTILITY
-            uint8_t ut = ceil(resources.at(2)->population*31);
-#else
-            uint8_t ut = ceil(areasUt[2]*31);
-#endif
-            message.data = message.data | (ut << 2);
+    float& last_sent = kilobots.lastSent()[index];
+    if(this->time - last_sent > minTimeBetweenTwoMessages && !ongoingRuntimeIdentification){
+        last_sent = this->time;
+
+        // utility of the resources under the kb, only sent for the resources in the mask
+        double utilities[MAX_RESOURCES] = {0};
+        resource_mask over = kilobots.states()[index];
+        for(int r=0; r<resources.size() && r<MAX_RESOURCES; r++) {
+            if(over & (1 << r)) {
+                if(real_utility) {
+                    utilities[r] = resources.at(r)->getPopulation();
+                } else {
+                    // read here, out of the parallel classification, so that the area keeps the steps caught up
+                    areasUt[r] = resources.at(r)->getAreaPopulation(over_areas[r]);
+                    utilities[r] = areasUt[r];
+                }
+            }
         }
 
         // store kb rotation toward the center if the kb is too close to the border
         // this is used to avoid that the kb gets stuck in the wall
         uint8_t turning_in_msg = 0;  // 0 no turn, 1 pi/2, 2 pi, 3 3pi/2
-        double distance_from_centre = sqrt(pow(this->kilobots_positions[k_id].x()-ARENA_CENTER,2)+pow(this->kilobots_positions[k_id].y()-ARENA_CENTER,2));
-        if(distance_from_centre/ARENA_SIZE > 0.9) {
+        const QPointF& position = kilobots.positions()[index];
+        double distance_from_centre = sqrt(pow(position.x()-config.arena_center_x,2)+pow(position.y()-config.arena_center_y,2));
+        if(distance_from_centre/config.arena_size > 0.9) {
 
             // get position translated w.r.t. center of arena
-            QVector2D pos = QVector2D(this->kilobots_positions[k_id]);
-            pos.setX(ARENA_CENTER - pos.x());
-            pos.setY(ARENA_CENTER - pos.y());
-            // get orientation (from velocity)
-            QVector2D ori = QVector2D(kilobot_entity.getVelocity());
-            ori.setX(ori.x()*10);
-            ori.setY(ori.y()*10);
-            // use atan2 to get angle between two vectors
-            double angle = qAtan2(ori.y(), ori.x()) - qAtan2(pos.y(), pos.x());
+            QVector2D pos = QVector2D(position);
+            pos.setX(config.arena_center_x - pos.x());
+            pos.setY(config.arena_center_y - pos.y());
+            // get orientation (from the filtered velocity), angle between the two vectors in (-pi, pi]
+            double angle = kilobots.poses()[index].heading() - qAtan2(pos.y(), pos.x());
+            if(angle > M_PI) {
+                angle -= 2*M_PI;
+            } else if(angle <= -M_PI) {
+                angle += 2*M_PI;
+            }
 
             if(angle > M_PI*3/4 || angle < -M_PI*3/4) {
                  turning_in_msg = 2;
@@ -218,13 +578,198 @@ void mykilobotenvironment::updateVirtualSensor(Kilobot kilobot_entity) {
             } else if(angle > M_PI/2){
                 turning_in_msg = 1;
             }
-            // store angle (no need if 0)
-            message.data = message.data | turning_in_msg;
         }
 
         // send it
-        emit transmitKiloState(message);
+        kilobot_message message = packSensorMessage(k_id, over, utilities, resources.size(), turning_in_msg);
+        if(this->outbox) {
+            outbox->push_back(message);
+        } else {
+            emit transmitKiloState(message);
+        }
+        if(this->latency) {
+            latency->sent(k_id);
+        }
+    }
+}
+
+QVector<uint8_t> mykilobotenvironment::tallyQuorum() {
+    // the loops over the resources are unrolled for each number of resources
+    static_assert(MAX_RESOURCES == 8, "one case for each number of resources");
+    QVector<uint8_t> totals(kilobots.resources(), 0);
+    switch(kilobots.resources()) {
+    case 1: countQuorum<1>(totals.data()); break;
+    case 2: countQuorum<2>(totals.data()); break;
+    case 3: countQuorum<3>(totals.data()); break;
+    case 4: countQuorum<4>(totals.data()); break;
+    case 5: countQuorum<5>(totals.data()); break;
+    case 6: countQuorum<6>(totals.data()); break;
+    case 7: countQuorum<7>(totals.data()); break;
+    case 8: countQuorum<8>(totals.data()); break;
+    }
+    return totals;
+}
+
+template<uint resources_count>
+void mykilobotenvironment::countQuorum(uint8_t* totals) {
+    uint8_t* quorum = kilobots.quorum();
+    for(uint k=0; k<kilobots.size(); k++, quorum += resources_count) {
+        uint perceived = 0;
+        for(uint r=1; r<resources_count; r++) {
+            if(quorum[r] >= quorum[perceived]) {
+                perceived = r;
+            }
+        }
+        totals[perceived]++;
+        // reset current quorum value
+        for(uint r=0; r<resources_count; r++) {
+            quorum[r] = 0;
+        }
+    }
+}
+
+kilobot_message mykilobotenvironment::packSensorMessage(kilobot_id k_id, resource_mask over, const double* utilities, uint resources, uint8_t turning) {
+    // !!! THE FOLLOWING IS OF EXTREME IMPORTANCE !!!
+    // NOTE although the message is defined as type, id and data, in ARK the fields type and id are swapped
+    // resulting in a mixed message. If you are not using the whole field this could lead to problems.
+    // To avoid it, consider to concatenate the message as ID, type and data.
+
+    /* Prepare the inividual kilobot's message         */
+    /* see README.md to understand about ARK messaging */
+    /* data has 3x24 bits divided as                   */
+    /*   ID 10b    type 4b  data 10b     <- ARK msg    */
+    /*  data[0]   data[1]   data[2]      <- kb msg     */
+    /* xxxx xxxy yyyy zzzz zwww wwtt     <- complexity */
+    /* x bits used for kilobot id                      */
+    /* y z w bits used for the resources (see          */
+    /* kilobot_c_code/resource_codec.h), y z w are the */
+    /* populations of resources 0 1 2 up to 3          */
+    /* t bits used for rotation toward the center      */
+    uint32_t word = sensor_pack(k_id, resources, over, utilities, turning);
+
+    // create and fill the message
+    kilobot_message message; // this is a 24 bits field not the original kb message
+    message.id = word >> 14;
+    message.type = (word >> 10) & 0x0F;
+    message.data = word & 0x3FF;
+
+    return message;
+}
+
+QByteArray mykilobotenvironment::saveState() const {
+    QByteArray state;
+    QDataStream out(&state, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << (quint32)ENVIRONMENT_STATE_VERSION;
+
+    // phase and timers
+    out << time << lastTransitionTime << isCommunicationTime << minTimeBetweenTwoMessages << updatesCount;
+    // configuration, the replay classifies the kbs as the run did
+    config.save(out);
+
+    // resources and areas
+    out << (quint32)resources.size();
+    for(const Resource* r : resources) {
+        r->save(out);
+    }
+
+    // kilobots
+    kilobots.save(out);
+    return state;
+}
+
+bool mykilobotenvironment::restoreState(const QByteArray& state) {
+    QDataStream in(state);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 version;
+    in >> version;
+    if(version != ENVIRONMENT_STATE_VERSION) {
+        qDebug() << "Environment snapshot version" << version << "not supported";
+        return false;
+    }
+
+    // read everything in temporaries, the current state is replaced only if the snapshot is valid
+    double time, lastTransitionTime;
+    bool isCommunicationTime;
+    float minTimeBetweenTwoMessages;
+    quint32 updatesCount;
+    quint32 resources_count;
+    ExperimentConfig config;
+    in >> time >> lastTransitionTime >> isCommunicationTime >> minTimeBetweenTwoMessages >> updatesCount;
+    bool config_valid = config.load(in);
+    in >> resources_count;
+    if(!config_valid || in.status() != QDataStream::Ok || resources_count > MAX_RESOURCES) {
+        return false;
+    }
+
+    // the snapshot is read in a new pool, that replaces the current one if valid
+    ObjectPool* pool = new ObjectPool();
+    QVector<Resource*> resources;
+    bool valid = true;
+    for(quint32 i=0; i<resources_count && valid; i++) {
+        resources.push_back(pool->create<Resource>(pool));
+        valid = resources.last()->load(in);
+    }
+
+    // the patches of the areas, labelled again if the mask is not the current one
+    AreaMask mask;
+    bool same_mask = config.area_mask == areaMask.filename() && config.area_mask_origin == areaMask.origin();
+    if(valid && !config.area_mask.isEmpty() && !same_mask) {
+        QString error;
+        valid = mask.load(config.area_mask, config.area_mask_origin, &error);
+        if(!valid) {
+            qDebug() << error;
+        }
+    }
+    uint patches = same_mask ? areaMask.regionsCount() : mask.regionsCount();
+    for(int r=0; r<resources.size() && valid; r++) {
+        for(const Area* a : resources[r]->areas) {
+            valid = valid && a->label <= patches;
+        }
+    }
+
+    KilobotRegistry kilobots;
+    valid = valid && kilobots.load(in);
+    // the membership indexes the areas
+    valid = valid && kilobots.resources() == (uint)resources.size();
+    for(uint k=0; k<kilobots.size() && valid; k++) {
+        for(int r=0; r<resources.size() && valid; r++) {
+            valid = kilobots.areas()[k*resources.size()+r] < (int)resources[r]->areas.size();
+        }
+    }
+    if(!valid || in.status() != QDataStream::Ok) {
+        delete pool;
+        qDebug() << "Environment snapshot corrupted";
+        return false;
+    }
+
+    // replace the current state
+    delete this->resourcePool;
+    this->resourcePool = pool;
+    this->resources = resources;
+    if(!same_mask) {
+        areaMask.swap(mask);
+    }
+    for(Resource* r : this->resources) {
+        for(Area* a : r->areas) {
+            if(a->label > 0)
+                a->mask = &areaMask;
+        }
     }
+    this->time = time;
+    this->lastTransitionTime = lastTransitionTime;
+    this->isCommunicationTime = isCommunicationTime;
+    this->minTimeBetweenTwoMessages = minTimeBetweenTwoMessages;
+    this->updatesCount = updatesCount;
+    // measured again from the next update, as after a reset
+    this->predictionHorizon = 0;
+    this->resourcesCount = resources.size();
+    this->kilobots.swap(kilobots);
+    // the paths restart from their first waypoint
+    configure(config);
+    invalidateClassifications();
+    pendingFrame.clear();
+    return true;
 }
 
 #endif // COMPLEXITYENVIRONMENT_CPP
@@ -5,8 +5,9 @@
  * Author: Dario Albani
  *
  * This is the code that specifies the specific environment used for the complexity experiment.
- * The environment is composed by empty spaces and up to three resources that have to be exploited by the kilobots.
- * Colours for the resources are green, blue and red (not be confused with led colours for the kb having different meanings).
+ * The environment is composed by empty spaces and resourcesCount resources (up to TRACKED_RESOURCES) that have to be exploited
+ * by the kilobots. Colours for the resources are red, green and blue (see resourceColours.h).
+ * A kb committed to a resource lights the led of the same colour, the only commitment ARK can observe.
  */
 
 #include <QObject>
@@ -18,38 +19,45 @@
 #include <QList>
 #include <QColor>
 #include <QElapsedTimer>
+#include <QByteArray>
 
+#include <deque>
 #include <limits>
+#include <vector>
 
 #include <kilobotenvironment.h>
 #include "resources.h"
 #include "area.h"
+#include "areaMask.h"
+#include "resourceColours.h"
+#include "kilobotRegistry.h"
+#include "experimentConfig.h"
+#include "objectPool.h"
+#include "workStealingPool.h"
+#include "tickProfiler.h"
+#include "replayLog.h"
+#include "latencyPredictor.h"
 
 
-#define ARENA_CENTER 750
-#define ARENA_SIZE 746
-
-#define EXPLORATION_TIME 5 // in seconds
-#define COMMUNICATION_TIME 5 // in seconds
-
-// if true, quorum is perceived and sent by ARK
-#define GLOBAL_QUORUM
-// if true, then send the total utility of the resources
-#define REAL_UTILITY
-
 class mykilobotenvironment : public KilobotEnvironment {
  Q_OBJECT
 public:
     explicit mykilobotenvironment(QObject *parent=0);
+    ~mykilobotenvironment();
     void reset();
 
-    QVector<kilobot_arena_state> kilobots_states;  // list of all kilobots locations meaning 255 for empty spaces and 1, 2, 3 for resources
+    uint resourcesCount; // resources created at reset, 3 by default (up to TRACKED_RESOURCES)
+
+    // configuration of the run, arena, area radius and area mask are applied at the next reset
+    const ExperimentConfig& configuration() const {return config;}
+    // replace the configuration and select the instantiation of the virtual sensor for it
+    void configure(const ExperimentConfig& config);
 
-    QVector<Resource*> resources; // list of all resources present in the experiment
-    QVector<QPointF> kilobots_positions;    // list of all kilobots positions
-    QVector<QColor> kilobots_colours;  // list of all kilobots led colours, the led indicate the resource to which the kb is committed (red, green, blue)
-    QVector<QVector<uint8_t>> kilobots_quorum; // list of quorum states of the kilobots as perceived during the broadcast phase (the one perceived more counts)
-    QVector<float> lastSent;    // when the last message was sent to the kb at given position
+    QVector<Resource*> resources; // list of all resources present in the experiment, created in resourcePool
+
+    // position, led, arena state, quorum, membership and message timing of all kilobots, by dense index
+    // (a kb is registered when first seen, the led indicates the resource to which it is committed)
+    KilobotRegistry kilobots;
 
     float minTimeBetweenTwoMessages;    // minimum time between two messages
     double time;
@@ -62,6 +70,45 @@ public:
     double lastCommunication; // used to transmit either the "communicate" or "stop communication" message three times per second
     bool isCommunicationTime; // determine if the robots are communicating or explorations
 
+    // if true the sensor updates are buffered and the whole frame is processed in parallel at the next update
+    bool parallelSensing;
+
+    TickProfiler* profiler; // if not NULL the sensor updates are timed
+    ReplayLogWriter* recorder; // if not NULL the sensor updates and the updates are recorded for offline replay
+    std::vector<kilobot_message>* outbox; // if not NULL the messages are queued here instead of emitted (see ArenaSet)
+    LatencyPredictor* latency; // if not NULL the sensor updates and the messages are timed to set predictionHorizon at every update
+    double predictionHorizon; // tracking frames of velocity added to the tracked positions of the kbs to classify them (0 by default)
+    // measure predictionHorizon from latency if set, done at every update
+    void updatePredictionHorizon();
+
+    // classify all kilobots of a frame on several threads, then send the messages in order of kilobot id
+    void updateVirtualSensors(std::vector<Kilobot>& frame);
+
+    // pack id, membership and utilities in [0, 1] of the resources and turning hint in the ARK message
+    // (see kilobot_c_code/resource_codec.h for the layout, the original one up to 3 resources)
+    static kilobot_message packSensorMessage(kilobot_id k_id, resource_mask over, const double* utilities, uint resources, uint8_t turning);
+
+    // binary snapshot of phase, timers, resources, areas and kilobots (see restoreState)
+    QByteArray saveState() const;
+    // replace the current state with a snapshot taken by saveState, false (state untouched) if not valid
+    bool restoreState(const QByteArray& state);
+
+    // forget the cached classifications, to be called whenever areas are added, removed or moved
+    void invalidateClassifications();
+    // forget the cached classifications that the circle centre, radius may change (an area before or after a change)
+    void invalidateClassifications(QPointF centre, double radius);
+
+    // area lifecycle, only the classifications of the kbs near the area are invalidated
+    // remove the area of the resource, it comes back after the area_respawn_time of the configuration
+    void removeArea(uint resource, uint area);
+    // bring a removed area back at a random position, false if no free position was found
+    bool respawnArea(uint resource, uint area);
+    void moveArea(uint resource, uint area, QPointF position);
+
+    // for each resource the kbs that perceived it the most during the communication (the later one on
+    // ties), then reset the counts of all kbs for the next communication
+    QVector<uint8_t> tallyQuorum();
+
 // signals and slots are used by qt to signal state changes to objects
 signals:
     void errorMessage(QString);
@@ -71,7 +118,56 @@ public slots:
     void updateVirtualSensor(Kilobot kilobot);
 
 private:
-
+    ExperimentConfig config;
+    // instantiations of the virtual sensor for the configuration (see configure)
+    typedef void (mykilobotenvironment::*kilobot_sensor)(Kilobot& kilobot_entity);
+    typedef void (mykilobotenvironment::*frame_sensor)(std::vector<Kilobot>& frame);
+    kilobot_sensor sensorPath;
+    frame_sensor framePath;
+
+    ObjectPool* resourcePool;          // resources and areas, rewound at every reset
+    AreaMask areaMask;                 // patches of the area mask of the configuration, empty if none
+    std::vector<Kilobot> pendingFrame; // sensor updates waiting for the next update (parallel sensing)
+    WorkStealingPool* sensorPool;      // created at the first parallel pass
+    std::vector<std::vector<int>> workerAreaCounters; // per thread changes of kilobots_in_area of all areas
+    std::vector<uint> frameIndexes;    // dense index of each kb of the frame being processed
+
+    // dynamic areas (see the configuration), nothing to do per tick with static ones
+    bool dynamicAreas;                 // respawn or paths configured
+    std::vector<uint> depletedAreas;   // areas of a resource depleted by its last step
+    std::deque<std::pair<uint, uint>> removedAreas; // resource and area of the removed areas, in order of removal
+    std::vector<uint> pathWaypoints;   // next waypoint of each path of the configuration
+    double lastAreasUpdate;            // time of the last update of the dynamic areas
+    quint32 updatesCount;              // updates since the reset, the kbs are stamped with it when reported
+
+    // respawn the areas removed for long enough and move the areas along their paths
+    void updateDynamicAreas();
+    // back to the first waypoint of the paths and rebuild the respawn queue from the areas
+    void resetDynamicAreas();
+    // take the kbs not reported for MEMBERSHIP_EXPIRY updates out of the areas under them
+    void expireKilobots();
+
+    // the virtual sensor, one instantiation for each value of the switches of the configuration:
+    // classify and send the message to one kb / all the kbs of a frame
+    template<bool global_quorum, bool real_utility>
+    void senseKilobot(Kilobot& kilobot_entity);
+    template<bool global_quorum, bool real_utility>
+    void senseFrame(std::vector<Kilobot>& frame);
+
+    // update position, colour, quorum and arena state of the kb at index, return true if a message should be sent
+    // when the kb enters or exits an area the change of occupancy is added to area_changes (one per area,
+    // resources in order) if not NULL, to the areas otherwise
+    // while the kb is closer to its last full classification than the nearest area boundary was (safe
+    // radius), the areas under it cannot have changed and are not recomputed
+    template<bool global_quorum, bool real_utility>
+    bool classifyKilobot(Kilobot& kilobot_entity, uint index, int* area_changes);
+    // build and emit the virtual sensor message of the kb at index
+    template<bool real_utility>
+    void sendVirtualSensorMessage(Kilobot& kilobot_entity, uint index);
+
+    // tallyQuorum for a number of resources known at compile time
+    template<uint resources_count>
+    void countQuorum(uint8_t* totals);
 };
 
 #endif // COMPLEXITYENVIRONMENT_H
@@ -20,10 +20,10 @@
 #include <iterator>
 #include <QSignalMapper>
 #include <QFile>
+#include <QDataStream>
 
-#define STOP_AFTER 3600 + 3600
-#define SAVE_IMAGE_EVERY 5
-#define SAVE_LOG_EVERY 5
+#define SNAPSHOT_MAGIC 0x434d5058 // "CMPX"
+#define SNAPSHOT_VERSION 3
 
 // return pointer to interface!
 // mykilobotexperiment can and should be completely hidden from the application
@@ -38,10 +38,18 @@ mykilobotexperiment::mykilobotexperiment() {
 
     // Initialize seed
     QDateTime cd = QDateTime::currentDateTime();
-    qsrand(cd.toTime_t());
+    this->seed = cd.toTime_t();
+    qsrand(this->seed);
 
     // setup the environment here
     connect(&complexityEnvironment,SIGNAL(transmitKiloState(kilobot_message)), this, SLOT(signalKilobotExpt(kilobot_message)));
+    // messages of all the arenas, when there are more than one
+    connect(&arenas,SIGNAL(transmitKiloState(kilobot_message)), this, SLOT(signalKilobotExpt(kilobot_message)));
+    complexityEnvironment.profiler = &tickProfiler;
+    complexityEnvironment.latency = &latencyPredictor;
+    this->resumeFromSnapshot = false;
+    this->kilobotsConnected = false;
+    this->resourcesCount = RESOURCES_COUNT;
     this->serviceInterval = 100; // timestep expressed in ms
 }
 
@@ -64,6 +72,36 @@ QWidget *mykilobotexperiment::createGUI() {
     lay->addWidget(logExp_ckb);
     toggleLogExp(logExp_ckb->isChecked());
 
+    // add check box for processing the virtual sensors of a frame in parallel
+    QCheckBox *parallelSensing_ckb = new QCheckBox("Parallel virtual sensing");
+    parallelSensing_ckb->setChecked(false);  // start as not checked
+    lay->addWidget(parallelSensing_ckb);
+    toggleParallelSensing(parallelSensing_ckb->isChecked());
+
+    // add check box for timing the stages of the tick and a button to print them
+    QCheckBox *profileTick_ckb = new QCheckBox("Profile tick");
+    profileTick_ckb->setChecked(false);  // start as not checked
+    lay->addWidget(profileTick_ckb);
+    toggleProfileTick(profileTick_ckb->isChecked());
+    QPushButton *dumpProfile_btn = new QPushButton("Print tick profile");
+    lay->addWidget(dumpProfile_btn);
+
+    // add check box for continuing from the last snapshot also when not resuming (e.g. after a crash)
+    QCheckBox *resumeSnapshot_ckb = new QCheckBox("Start from last snapshot");
+    resumeSnapshot_ckb->setChecked(false);  // start as not checked
+    lay->addWidget(resumeSnapshot_ckb);
+    toggleResumeFromSnapshot(resumeSnapshot_ckb->isChecked());
+
+    // add spin box for the number of resources, applied at the next initialise (the configuration file wins)
+    QFormLayout *resources_layout = new QFormLayout;
+    QSpinBox *resources_spin = new QSpinBox();
+    resources_spin->setMinimum(1);
+    // the tracker only tells the leds of TRACKED_RESOURCES resources apart
+    resources_spin->setMaximum(TRACKED_RESOURCES);
+    resources_spin->setValue(resourcesCount);
+    resources_layout->addRow(new QLabel("Resources"), resources_spin);
+    lay->addLayout(resources_layout);
+
     // create a box for resource parameters as following
     // Resource A:
     //   eta [     ]
@@ -147,6 +185,11 @@ QWidget *mykilobotexperiment::createGUI() {
 
     connect(saveImages_ckb, SIGNAL(toggled(bool)),this, SLOT(toggleSaveImages(bool)));
     connect(logExp_ckb, SIGNAL(toggled(bool)),this, SLOT(toggleLogExp(bool)));
+    connect(parallelSensing_ckb, SIGNAL(toggled(bool)),this, SLOT(toggleParallelSensing(bool)));
+    connect(profileTick_ckb, SIGNAL(toggled(bool)),this, SLOT(toggleProfileTick(bool)));
+    connect(dumpProfile_btn, SIGNAL(clicked()),this, SLOT(dumpTickProfile()));
+    connect(resumeSnapshot_ckb, SIGNAL(toggled(bool)),this, SLOT(toggleResumeFromSnapshot(bool)));
+    connect(resources_spin, SIGNAL(valueChanged(int)),this, SLOT(setResourcesCount(int)));
     connect(this,SIGNAL(destroyed(QObject*)), lay, SLOT(deleteLater()));
 
     return frame;
@@ -155,11 +198,45 @@ QWidget *mykilobotexperiment::createGUI() {
 void mykilobotexperiment::initialise(bool isResume) {
     //qDebug() << QString("in initialise");
 
-    // generate the environments
-    setupEnvironments();
+    // configuration of the run, the defaults if there is no configuration file
+    ExperimentConfig config;
+    config.resources = resourcesCount;
+    if(QFile::exists(config_filename)) {
+        QString error;
+        if(config.load(config_filename, &error)) {
+            qDebug() << "Configuration read from" << config_filename;
+        } else {
+            qDebug() << "ERROR" << error << "- using the default configuration";
+        }
+    }
+    qDebug().noquote() << "Configuration:\n" + config.toString();
+    complexityEnvironment.configure(config);
+    complexityEnvironment.resourcesCount = config.resources;
+
+    // further arenas, each with its own environment (restored from the snapshot when resuming)
+    arenas.clear();
+    for(uint i=0; i<config.arenas.size(); i++) {
+        arenas.addArena(config.arena(i), complexityEnvironment.resourcesCount);
+    }
+
+    // continue from the last snapshot if resuming, generate the environments otherwise
+    bool resumed = false;
+    if(isResume || resumeFromSnapshot) {
+        resumed = restoreSnapshot();
+    }
+    if(resumed) {
+        // the configuration file wins over the one of the snapshot
+        complexityEnvironment.configure(config);
+        for(uint i=0; i<config.arenas.size(); i++) {
+            arenas.arena(i+1)->configure(config.arena(i));
+        }
+    } else {
+        setupEnvironments();
+    }
 
     // initialize kilobot states
-    if(!isResume) {
+    // (also when resuming in a new instance of the plugin, the kilobots must be connected again)
+    if(!isResume || !kilobotsConnected) {
         emit getInitialKilobotStates();
     }
 
@@ -168,8 +245,28 @@ void mykilobotexperiment::initialise(bool isResume) {
 
     QThread::currentThread()->setPriority(QThread::HighestPriority);
 
-    savedImagesCounter = 0;
-    this->time = 0;
+    if(!resumed) {
+        savedImagesCounter = 0;
+        this->time = 0;
+        runStatistics.reset(complexityEnvironment.resources.size(), this->time);
+    }
+    tickProfiler.reset();
+    // the frames tracked before the start are stale
+    trackingHandoff.clear();
+
+    // macroscopic prediction from the current state, logged next to the observed populations
+    prediction = MeanFieldModel(complexityEnvironment.resources.size());
+    MeanFieldModel::parameters parameters = MeanFieldModel::fromResources(complexityEnvironment.resources, complexityEnvironment.kilobots.size(),
+                                                                          config.arena_size, config.exploration_time, config.communication_time);
+    for(int r=0; r<runStatistics.resources.size() && r<(int)parameters.committed.size(); r++) {
+        uint robots = complexityEnvironment.kilobots.size();
+        parameters.committed[r] = robots == 0 ? 0 : (double)runStatistics.resources[r].committed/robots;
+    }
+    prediction.add(parameters, this->time);
+
+    // stop recording the previous run
+    complexityEnvironment.recorder = NULL;
+    replayLog.close();
 
     // init log file operations
     // if the log checkmark is marked then save the logs
@@ -181,15 +278,24 @@ void mykilobotexperiment::initialise(bool isResume) {
             log_file.close();
         }
         // log filename consist of the prefix and current date and time
-        QString log_filename = log_filename_prefix + "_" + QDate::currentDate().toString("yyMMdd") + "_" + QTime::currentTime().toString("hhmmss") + ".txt";
+        // when resuming from a snapshot the log continues in the same file
+        if(!resumed || log_filename.isEmpty()) {
+            log_filename = log_filename_prefix + "_" + QDate::currentDate().toString("yyMMdd") + "_" + QTime::currentTime().toString("hhmmss") + ".txt";
+        }
         log_file.setFileName(log_filename);
         // open the file
-        if(log_file.open(QIODevice::WriteOnly)) {
+        if(log_file.open(resumed ? QIODevice::WriteOnly | QIODevice::Append : QIODevice::WriteOnly)) {
             qDebug() << "Log file " << log_file.fileName() << " opened";
             log_stream.setDevice(&log_file);
         } else {
             qDebug() << "ERROR opening file "<< log_filename;
         }
+
+        // record what the environment perceives, to replay the experiment offline (see replay/)
+        if(replayLog.open(log_filename + ".replay", resumed)) {
+            replayLog.recordState(seed, complexityEnvironment.saveState());
+            complexityEnvironment.recorder = &replayLog;
+        }
     }
 
     // if the checkbox for saving the images is checked
@@ -201,20 +307,75 @@ void mykilobotexperiment::initialise(bool isResume) {
 }
 
 void mykilobotexperiment::stopExperiment() {
-    // close log file
+    // print the tick timings
+    if(tickProfiler.enabled) {
+        dumpTickProfile();
+    }
+
+    // summary of the run
+    printTotalExploitaion();
+
+    // last snapshot, resuming continues from here
+    snapshotWriter.write(snapshot_filename, saveSnapshot());
+    snapshotWriter.flush();
+
+    // close replay log and log file
+    complexityEnvironment.recorder = NULL;
+    replayLog.close();
     if(log_file.isOpen()) {
         qDebug() << "Closing log file " << log_file.fileName();
         log_file.close();
     }
 }
 
+void mykilobotexperiment::printTotalExploitaion() {
+    QString summary = runStatistics.summary();
+    qDebug().noquote() << "Run summary:\n" + summary;
+
+    // written next to the log, so that the run can be compared without reading the log again
+    if(logExp && !log_filename.isEmpty()) {
+        QFile summary_file(log_filename + ".summary");
+        if(summary_file.open(QIODevice::WriteOnly)) {
+            QTextStream summary_stream(&summary_file);
+            summary_stream << "seed " << seed << "\n" << summary;
+        } else {
+            qDebug() << "ERROR opening file" << summary_file.fileName();
+        }
+    }
+}
+
+void mykilobotexperiment::dumpTickProfile() {
+    qDebug().noquote() << "Tick profile:\n" + tickProfiler.report();
+    qDebug().noquote() << "Tracking handoff:" << trackingHandoff.report();
+}
+
+void mykilobotexperiment::senseTrackedFrames() {
+    trackingHandoff.drain(trackedFrames);
+    for(const TrackingHandoff::robot_snapshot& record : trackedFrames) {
+        // the latency is measured from the tracking, not from the drain
+        latencyPredictor.setSensingAge(trackingHandoff.age(record));
+        trackedKilobot.setID(record.id);
+        trackedKilobot.updateState(record.position, record.velocity, record.colour);
+        arenas.updateVirtualSensor(trackedKilobot);
+    }
+    latencyPredictor.setSensingAge(0);
+}
+
 void mykilobotexperiment::run() {
     //qDebug() << QString("in run");
+    PROFILE_STAGE(&tickProfiler, RUN_TOTAL);
+    const ExperimentConfig& config = complexityEnvironment.configuration();
+
+    // the frames tracked since the last tick are sensed first, on the environment of the last tick
+    {
+        PROFILE_STAGE(&tickProfiler, TRACKING_HANDOFF);
+        senseTrackedFrames();
+    }
 
     this->time += 0.1; // 10 ms
 
     // stop after given time
-    if(this->time >= STOP_AFTER) {
+    if(this->time >= config.stop_after) {
         // close the experiment
         this->stopExperiment();
         emit(experimentComplete());
@@ -222,40 +383,30 @@ void mykilobotexperiment::run() {
 
     // update environment
     // switch between communication time and exploration time
-    if(!complexityEnvironment.isCommunicationTime && EXPLORATION_TIME <= this->time - complexityEnvironment.lastTransitionTime) {
+    {
+    PROFILE_STAGE(&tickProfiler, PHASE_SWITCH);
+    if(!complexityEnvironment.isCommunicationTime && config.exploration_time <= this->time - complexityEnvironment.lastTransitionTime) {
         complexityEnvironment.isCommunicationTime = true;
         complexityEnvironment.lastTransitionTime = this->time;
         kilobot_broadcast message;
         message.type = 2; // 2 "communicate"
         emit broadcastMessage(message);
-    } else if(complexityEnvironment.isCommunicationTime && COMMUNICATION_TIME <= this->time - complexityEnvironment.lastTransitionTime) {
+    } else if(complexityEnvironment.isCommunicationTime && config.communication_time <= this->time - complexityEnvironment.lastTransitionTime) {
         complexityEnvironment.isCommunicationTime = false;
         complexityEnvironment.lastTransitionTime = this->time;
         kilobot_broadcast message;
         message.type = 3; // 3 "stop communications"
-#ifdef GLOBAL_QUORUM
-        // compute quorum status for all kilobots
-        uint8_t totaleRed, totalGreen, totalBlue = 0;
-
-        for(int id = 0; id<complexityEnvironment.kilobots_quorum.size(); id++) {
-            if(complexityEnvironment.kilobots_quorum[id][0] > complexityEnvironment.kilobots_quorum[id][1] &&
-                    complexityEnvironment.kilobots_quorum[id][0] > complexityEnvironment.kilobots_quorum[id][2]) {
-                totaleRed++;
-            } else if(complexityEnvironment.kilobots_quorum[id][1] > complexityEnvironment.kilobots_quorum[id][2]) {
-                totalGreen++;
-            } else {
-                totalBlue++;
+        if(config.global_quorum) {
+            // compute quorum status for all kilobots, each counts for the resource perceived more
+            // (the later one on ties, as the original red / green / blue comparison)
+            QVector<uint8_t> totals = arenas.tallyQuorum();
+
+            // add the overall quorum values at pos r for resource r
+            message.data = {0,0,0,0,0,0,0,0,0};
+            for(int r=0; r<totals.size() && r<message.data.size(); r++) {
+                message.data[r] = totals[r];
             }
-            // reset current quorum value
-            complexityEnvironment.kilobots_quorum[id] = {0,0,0};
         }
-
-        // add the overall quorum values at pos 0(red) 1(green) 2(blue)
-        message.data = {0,0,0,0,0,0,0,0,0};
-        message.data[0] = totaleRed;
-        message.data[1] = totalGreen;
-        message.data[2] = totalBlue;
-#endif
         emit broadcastMessage(message);
     }
 
@@ -266,16 +417,30 @@ void mykilobotexperiment::run() {
         message.type = complexityEnvironment.isCommunicationTime?2:3; //2 "communicate" 3 "stop communications"
         emit broadcastMessage(message);
     }
+    }
 
     complexityEnvironment.time = (float)time;
     complexityEnvironment.ongoingRuntimeIdentification = this->runtimeIdentificationLock;
-    complexityEnvironment.update();
+    {
+        PROFILE_STAGE(&tickProfiler, ENVIRONMENT_UPDATE);
+        arenas.update();
+    }
+
+    // fold populations and commitments of this tick in the run statistics
+    {
+        PROFILE_STAGE(&tickProfiler, STATISTICS);
+        runStatistics.update(this->time, complexityEnvironment.resources, complexityEnvironment.kilobots);
+    }
 
     // update kilobots states
-    emit updateKilobotStates();
+    {
+        PROFILE_STAGE(&tickProfiler, STATE_REQUEST);
+        emit updateKilobotStates();
+    }
 
     // update visualization twice per second
     if(qRound(this->time*10)%5 == 0) {
+        PROFILE_STAGE(&tickProfiler, PLOT);
         // clear current environment
         clearDrawings();
         clearDrawingsOnRecordedImage();
@@ -287,100 +452,130 @@ void mykilobotexperiment::run() {
     // if in communication time do not save image and the log
     if(!complexityEnvironment.isCommunicationTime) {
         // save image and log
-        if(qRound(this->time*10)%SAVE_IMAGE_EVERY == 0) {
+        if(qRound(this->time*10)%config.save_image_every == 0) {
             if(saveImages) {
+                PROFILE_STAGE(&tickProfiler, SAVE_IMAGE);
                 emit saveImage(QString("complexity_%1.jpg").arg(savedImagesCounter++, 5, 10, QChar('0')));
             }
         }
-        if(qRound(this->time*10)%SAVE_LOG_EVERY == 0) {
+        if(qRound(this->time*10)%config.save_log_every == 0) {
             qDebug() << "LOG: saving at " << this->time*10;
             // log kilobot positions
             if(logExp) {
-                // count kilobots
-                uint8_t committed0 = 0;
-                uint8_t committed1 = 0;
-                uint8_t committed2 = 0;
-                uint8_t uncommitted = 0;
-                for(int i=0; i<kilobots_ids.size(); ++i) {
-                    kilobot_id k_id = kilobots_ids.at(i);
-                    if(complexityEnvironment.kilobots_colours.at(k_id) == Qt::red) {
-                        committed0++;
-                    } else if(complexityEnvironment.kilobots_colours.at(k_id) == Qt::blue) {
-                        committed1++;
-                    } else if(complexityEnvironment.kilobots_colours.at(k_id) == Qt::blue) {
-                        committed2++;
-                    } else {
-                        uncommitted++;
-                    }
-                    log_stream
-                            << complexityEnvironment.resources.at(0)->population << " " << committed0
-                            << complexityEnvironment.resources.at(1)->population << " " << committed0
-                            << complexityEnvironment.resources.at(2)->population << " " << committed0
-                            << uncommitted;
+                PROFILE_STAGE(&tickProfiler, LOG);
+                // population and committed kilobots of each resource, uncommitted kilobots, then predicted populations
+                for(int r=0; r<complexityEnvironment.resources.size(); r++) {
+                    log_stream << complexityEnvironment.resources.at(r)->getPopulation() << " "
+                               << runStatistics.resources.at(r).committed << " ";
+                }
+                log_stream << runStatistics.uncommitted;
+                // predicted population of each resource
+                prediction.advanceTo(this->time);
+                for(uint r=0; r<prediction.resourcesCount(); r++) {
+                    log_stream << " " << prediction.population(0, r);
                 }
                 log_stream << endl;
             }
         }
     }
-}
 
-void mykilobotexperiment::setupInitialKilobotState(Kilobot kilobot_entity) {
-    //qDebug() << QString("in setup init kilobot state");
+    // checkpoint, serialized here and written to disk by the snapshot writer thread
+    if(qRound(this->time*10)%config.save_snapshot_every == 0) {
+        PROFILE_STAGE(&tickProfiler, SNAPSHOT);
+        snapshotWriter.write(snapshot_filename, saveSnapshot());
+    }
+}
 
-    // assign all kilobot to environment complexity
-    this->setCurrentKilobotEnvironment(&complexityEnvironment);
-    kilobot_id k_id = kilobot_entity.getID();
+QByteArray mykilobotexperiment::saveSnapshot() const {
+    QByteArray snapshot;
+    QDataStream out(&snapshot, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << (quint32)SNAPSHOT_MAGIC << (quint32)SNAPSHOT_VERSION;
+    out << this->time << (qint32)savedImagesCounter << log_filename;
+    out << complexityEnvironment.saveState();
+    runStatistics.save(out);
+    arenas.save(out);
+    return snapshot;
+}
 
-    // create a necessary list and variable for correct message timing
-    if(k_id+1 > kilobots.size()) {
-        kilobots.resize(k_id+1);
+bool mykilobotexperiment::restoreSnapshot() {
+    QByteArray snapshot = SnapshotWriter::readFile(snapshot_filename);
+    if(snapshot.isEmpty()) {
+        qDebug() << "No snapshot to resume from in" << snapshot_filename;
+        return false;
     }
 
-    // this are used to solve a bug causing the app to crash after resetting
-    if(complexityEnvironment.lastSent.size() < k_id+1) {
-        complexityEnvironment.lastSent.resize(k_id+1);
-    }
-    if(complexityEnvironment.kilobots_positions.size() < k_id+1) {
-        complexityEnvironment.kilobots_positions.resize(k_id+1);
-    }
-    if(complexityEnvironment.kilobots_states.size() < k_id+1) {
-        complexityEnvironment.kilobots_states.resize(k_id+1);
+    QDataStream in(snapshot);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 magic, version;
+    in >> magic >> version;
+    if(magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION) {
+        qDebug() << "ERROR" << snapshot_filename << "is not a snapshot of this experiment";
+        return false;
     }
-    if(complexityEnvironment.kilobots_colours.size() < k_id+1) {
-        complexityEnvironment.kilobots_colours.resize(k_id+1);
-    }
-    if(complexityEnvironment.kilobots_quorum.size() < k_id+1) {
-        complexityEnvironment.kilobots_quorum.resize(k_id+1);
+    double time;
+    qint32 savedImagesCounter;
+    QString log_filename;
+    QByteArray environment_state;
+    in >> time >> savedImagesCounter >> log_filename >> environment_state;
+    RunStatistics statistics;
+    if(in.status() != QDataStream::Ok || !statistics.load(in) || !complexityEnvironment.restoreState(environment_state)
+            || !arenas.restore(in)) {
+        qDebug() << "ERROR reading snapshot" << snapshot_filename;
+        return false;
     }
 
+    this->time = time;
+    this->savedImagesCounter = savedImagesCounter;
+    this->log_filename = log_filename;
+    this->runStatistics = statistics;
+    qDebug() << "Resumed from" << snapshot_filename << "at time" << time;
+    return true;
+}
+
+void mykilobotexperiment::setupInitialKilobotState(Kilobot kilobot_entity) {
+    //qDebug() << QString("in setup init kilobot state");
 
-    complexityEnvironment.lastSent[k_id] = complexityEnvironment.minTimeBetweenTwoMessages;
+    // assign all kilobot to the arenas, each kb is served by the environment of its arena
+    this->setCurrentKilobotEnvironment(&arenas);
+    // the sensor updates are handed over by the tracking thread instead, whole frames at every tick
+    Kilobot* tracked = qobject_cast<Kilobot*>(sender());
+    if(tracked) {
+        trackingHandoff.attach(tracked);
+    }
+    kilobot_id k_id = kilobot_entity.getID();
 
-    // TODO initialize kilobots location correctly
-    complexityEnvironment.kilobots_positions[k_id] = kilobot_entity.getPosition();
-    complexityEnvironment.kilobots_states[k_id] = (KilobotEnvironment::kilobot_arena_state)255;
-    complexityEnvironment.kilobots_colours[k_id] = Qt::black;
+    // register the kb (a new one gets the next dense index)
+    KilobotRegistry& registry = arenas.arenaOf(kilobot_entity)->kilobots;
+    uint index = registry.add(k_id);
+    kilobotsConnected = true;
 
-    KiloLog kLog(k_id, kilobot_entity.getPosition(), 0, kilobot_entity.getLedColour());
-    kilobots[k_id] = kLog;
-    if(!kilobots_ids.contains(k_id))
-        kilobots_ids.append(k_id);
+    // TODO initialize kilobots location correctly
+    registry.positions()[index] = kilobot_entity.getPosition();
+    registry.orientations()[index] = 0;
+    registry.states()[index] = 0; // over no area
+    registry.leds()[index] = OFF;
+    registry.poses()[index].clear();
 
     double timeForAMessage = 0.05; // 50 ms each message
-    complexityEnvironment.minTimeBetweenTwoMessages = kilobots_ids.size()*timeForAMessage/2.8;
-    complexityEnvironment.lastSent[k_id] = complexityEnvironment.minTimeBetweenTwoMessages;
+    // the messages of all the arenas share the same transmitter
+    complexityEnvironment.minTimeBetweenTwoMessages = arenas.kilobots()*timeForAMessage/2.8;
+    registry.lastSent()[index] = complexityEnvironment.minTimeBetweenTwoMessages;
 }
 
 void mykilobotexperiment::updateKilobotState(Kilobot kilobotCopy) {
     //qDebug() << QString("in update kilobot state");
 
     // update values for logging
-    if(logExp && (qRound(time*10)%SAVE_LOG_EVERY == 0)) {
-        kilobot_id k_id = kilobotCopy.getID();
-        kilobot_colour k_colour = kilobotCopy.getLedColour();
-        QPointF k_position = kilobotCopy.getPosition();
-        double k_rotation = qRadiansToDegrees(qAtan2(-kilobotCopy.getVelocity().y(), kilobotCopy.getVelocity().x()));
-        kilobots[k_id].updateAllValues(k_id, k_position, k_rotation, k_colour);
+    if(logExp && (qRound(time*10)%complexityEnvironment.configuration().save_log_every == 0)) {
+        // position and led are updated by the environment at every sensor update
+        mykilobotenvironment* environment = arenas.arenaOf(kilobotCopy.getID());
+        int index = environment ? environment->kilobots.indexOf(kilobotCopy.getID()) : -1;
+        if(index >= 0) {
+            QPointF velocity = environment->kilobots.poses()[index].velocity();
+            double k_rotation = qRadiansToDegrees(qAtan2(-velocity.y(), velocity.x()));
+            environment->kilobots.orientations()[index] = k_rotation;
+        }
     }
 }
 
@@ -394,16 +589,18 @@ QColor mykilobotexperiment::GetFloorColor(int track_x, int track_y) {
     //qDebug() << QString("in get floor color");
 
     QColor floorColour = Qt::white; // no resource
-    // paint the resources
-    for(Resource* r : complexityEnvironment.resources) {
-        for(Area* a : r->areas) {
-            if(a->isInside(QPointF(track_x,track_y))) {
-                floorColour = r->colour;
-                break;
+    // paint the resources of all the arenas
+    for(uint i=0; i<arenas.size() && floorColour == Qt::white; i++) {
+        for(Resource* r : arenas.arena(i)->resources) {
+            for(Area* a : r->areas) {
+                if(a->isInside(QPointF(track_x,track_y))) {
+                    floorColour = r->colour;
+                    break;
+                }
             }
+            if(floorColour != Qt::white)
+                break;
         }
-        if(floorColour != Qt::white)
-            break;
     }
     return floorColour;
 }
@@ -412,28 +609,41 @@ void mykilobotexperiment::plotEnvironment() {
     // clean image
     clearDrawingsOnRecordedImage();
 
-    // center, radius, color, thikness, text, dunno
-    drawCircle(QPointF(750,750), 13, QColor(Qt::yellow), 25, "", true);
-    drawCircle(QPointF(750,750), 735, QColor(Qt::yellow), 25, "", true);
-    uint8_t size = 10;
-    // print areas as circles
-    for(const Resource* r : complexityEnvironment.resources) {
-        for(const Area* a : r->areas) {
-            char apop[3];
-            sprintf(apop, "%d", (int)(a->population*100));
-            drawCircle(a->position, a->radius, r->colour, 15, apop, true);
-
-            if(this->saveImages) {
-                // draw a inner gray circle if below umin
-                if(a->population < 0.6) {
-                    drawCircleOnRecordedImage(a->position, a->radius-(size*a->population/2), Qt::gray, 5, apop);
+    // every arena with its areas and kilobots
+    for(uint i=0; i<arenas.size(); i++) {
+        const mykilobotenvironment* environment = arenas.arena(i);
+
+        // center, radius, color, thikness, text, dunno
+        QPointF centre(environment->configuration().arena_center_x, environment->configuration().arena_center_y);
+        drawCircle(centre, 13, QColor(Qt::yellow), 25, "", true);
+        drawCircle(centre, environment->configuration().arena_size-11, QColor(Qt::yellow), 25, "", true);
+        uint8_t size = 10;
+        // print areas as circles
+        for(Resource* r : environment->resources) {
+            // bring the areas without kilobots up to date
+            r->catchUp();
+            for(const Area* a : r->areas) {
+                if(!a->active)
+                    continue;
+                char apop[4];
+                sprintf(apop, "%d", (int)(a->population*100));
+                // a patch of the mask is marked at its centroid, its shape is on the floor
+                double radius = a->mask ? 30 : a->radius;
+                drawCircle(a->position, radius, r->colour, 15, apop, true);
+
+                if(this->saveImages) {
+                    // draw a inner gray circle if below umin
+                    if(a->population < 0.6) {
+                        drawCircleOnRecordedImage(a->position, radius-(size*a->population/2), Qt::gray, 5, apop);
+                    }
+                    drawCircleOnRecordedImage(a->position, radius, r->colour, size*a->population, apop);
                 }
-                drawCircleOnRecordedImage(a->position, a->radius, r->colour, size*a->population, apop);
             }
         }
-    }
 
-    for(uint k_id : this->kilobots_ids) {
-        drawCircleOnRecordedImage(complexityEnvironment.kilobots_positions.at(k_id), 5, complexityEnvironment.kilobots_colours.at(k_id), 5, "");
+        const KilobotRegistry& registry = environment->kilobots;
+        for(uint k=0; k<registry.size(); k++) {
+            drawCircleOnRecordedImage(registry.positions()[k], 5, ledColour(registry.led(k)), 5, "");
+        }
     }
 }
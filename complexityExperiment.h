@@ -7,7 +7,7 @@
  * This is the main file for the experiment that implements the template functions in the kilobot*.h files
  * and that are need for ARK to correctly execute the experiment.
  *
- * The complexity experiment consist in a swarm of kilobots exploiting several resources (up to three) present
+ * The complexity experiment consist in a swarm of kilobots exploiting several resources (up to TRACKED_RESOURCES, three by default) present
  * in the environment. Each resource consiste of k (k=25) areas that the kilobots can exploit as single or group.
  *
  * A kilobot can assume three states indicated by three different led colours:
@@ -25,10 +25,18 @@
 #include "kilobotexperiment.h"
 #include "kilobotenvironment.h"
 #include "complexityEnvironment.h"
+#include "arenaSet.h"
 
 // there are the file for the complexity experiment
 #include "resources.h"
 #include "area.h"
+#include "tickProfiler.h"
+#include "latencyPredictor.h"
+#include "trackingHandoff.h"
+#include "snapshotWriter.h"
+#include "replayLog.h"
+#include "runStatistics.h"
+#include "meanFieldModel.h"
 
 // OpenCV includes
 #include <opencv2/core/core.hpp>
@@ -53,43 +61,6 @@
 #include <QtMath>
 #include <QElapsedTimer>
 
-/**
- * @brief Log kilobot related information, Values are defined in the template file kilobot.h
- */
-class KiloLog {
-public:
-    KiloLog() {}
-    KiloLog(kilobot_id id, QPointF position, double orientation, kilobot_colour colour) :
-        id(id), position(position), orientation(orientation), colour(colour) {}
-
-    kilobot_id id;          // unique kilobot id
-    QPointF position;       // kilobot position on the plane
-    double orientation;     // kilobot orientation
-    kilobot_colour colour;  // kilobot led colour
-
-    /** Update all log values */
-    void updateAllValues(kilobot_id id, QPointF position, double orientation, kilobot_colour colour) {
-        this->id = id;
-        this->position = position;
-        this->orientation = orientation;
-        this->colour = colour;
-    }
-
-    /** Set position */
-    void setPosition(QPointF position) {
-        this->position = position;
-    }
-
-    /** Set orientation */
-    void setOrientation(double orientation) {
-        this->orientation = orientation;
-    }
-
-    void setColour(kilobot_colour colour) {
-        this->colour = colour;
-    }
-}; /* end class kilo_log */
-
 /**
  * @brief mykilobotexperiment is where the complexity experiment is defined and ARK templates area extended
  * This create a separate window in the ARK GUI where one can set up experiments variables.
@@ -118,6 +89,21 @@ public slots:
     void toggleLogExp(bool toggle) {
         logExp = toggle;
     }
+    void toggleParallelSensing(bool toggle) {
+        complexityEnvironment.parallelSensing = toggle;
+    }
+    void toggleProfileTick(bool toggle) {
+        tickProfiler.enabled = toggle;
+    }
+    void toggleResumeFromSnapshot(bool toggle) {
+        resumeFromSnapshot = toggle;
+    }
+    void setResourcesCount(int resources) {
+        resourcesCount = qBound(1, resources, TRACKED_RESOURCES);
+    }
+
+    // print p50/p99/max of each stage of the tick
+    void dumpTickProfile();
 
 //    // set resource growth rate
 //    inline void setResourceAEta(double eta) {
@@ -151,9 +137,41 @@ private:
     void setupEnvironments();
     void plotEnvironment();
 
+    // print the summary of the run statistics and write it next to the log
     void printTotalExploitaion();
 
+    // serialize time, counters and environment / restore them from snapshot_filename
+    QByteArray saveSnapshot() const;
+    bool restoreSnapshot();
+
     mykilobotenvironment complexityEnvironment;
+    // the arenas ARK sends the sensor updates to, complexityEnvironment is the primary one (see arenaSet.h);
+    // the statistics and the log are of the primary arena, the snapshots hold all the arenas
+    ArenaSet arenas{&complexityEnvironment};
+
+    // timings of the stages of run() and of the sensor updates
+    TickProfiler tickProfiler;
+
+    // delays from the tracking of the kbs to their messages, for the positions predicted at delivery
+    LatencyPredictor latencyPredictor;
+
+    // tracked kbs, handed over by the tracking thread and drained at the start of run()
+    TrackingHandoff trackingHandoff;
+    std::vector<TrackingHandoff::robot_snapshot> trackedFrames;
+    Kilobot trackedKilobot; // carries each record to the environment
+    // give the frames completed since the last tick to the environment
+    void senseTrackedFrames();
+
+    // populations, commitments and exploitation of the run, updated every tick
+    RunStatistics runStatistics;
+
+    // mean-field prediction of populations and commitments, started from the state at initialise
+    MeanFieldModel prediction;
+
+    // seed of qrand, the layout of the resources depends on it
+    uint seed;
+    // resources set in the GUI, the resources key of the configuration file wins
+    uint resourcesCount;
 
     // loggin variables
     bool saveImages;
@@ -161,7 +179,17 @@ private:
     bool logExp;
     QFile log_file;
     QString log_filename_prefix = "log_complexity";
+    QString log_filename;
     QTextStream log_stream;
+    ReplayLogWriter replayLog;
+
+    // checkpoints of the experiment, written periodically and at stop
+    bool resumeFromSnapshot;
+    QString snapshot_filename = "complexity_snapshot.bin";
+    SnapshotWriter snapshotWriter;
+
+    // configuration of the runs, read at every initialise (see experimentConfig.h)
+    QString config_filename = "complexity_config.txt";
 
     // GUI objects (not currently used)
     QSpinBox *pop_spina, *pop_spinb, *pop_spinc;
@@ -169,9 +197,9 @@ private:
     QSpinBox *k_spina, *k_spinb, *k_spinc;
     QDoubleSpinBox *umin_spina, *umin_spinb, *umin_spinc;
 
-    // kilobots objects
-    QVector<kilobot_id> kilobots_ids;
-    QVector<KiloLog> kilobots;
+    // true once the kilobots have been connected to the environment (see setupInitialKilobotState),
+    // their state is in complexityEnvironment.kilobots
+    bool kilobotsConnected;
 
 }; /* end class mykilobotexperiment */
 
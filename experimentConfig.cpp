@@ -0,0 +1,243 @@
+#ifndef EXPERIMENTCONFIG_CPP
+#define EXPERIMENTCONFIG_CPP
+
+#include "experimentConfig.h"
+#include "resourceColours.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QtMath>
+
+ExperimentConfig::ExperimentConfig() {
+    global_quorum = GLOBAL_QUORUM;
+    real_utility = REAL_UTILITY;
+    exploration_time = EXPLORATION_TIME;
+    communication_time = COMMUNICATION_TIME;
+    stop_after = STOP_AFTER;
+    save_image_every = SAVE_IMAGE_EVERY;
+    save_log_every = SAVE_LOG_EVERY;
+    save_snapshot_every = SAVE_SNAPSHOT_EVERY;
+    arena_center_x = ARENA_CENTER;
+    arena_center_y = ARENA_CENTER;
+    arena_size = ARENA_SIZE;
+    area_radius = AREA_RADIUS;
+    resources = RESOURCES_COUNT;
+    area_depletion = 0;
+    area_respawn_time = 0;
+    area_mask_origin = QPointF(0,0);
+    sensing_latency = 0;
+}
+
+// set the value of the key, false if the key is unknown or the value out of range
+static bool setKey(ExperimentConfig& config, const QString& key, double value) {
+    bool is_bool = value == 0 || value == 1;
+    bool is_ticks = value >= 1 && value <= 1e6 && value == qFloor(value);
+    if(key == "global_quorum" && is_bool) {
+        config.global_quorum = value;
+    } else if(key == "real_utility" && is_bool) {
+        config.real_utility = value;
+    } else if(key == "exploration_time" && value > 0) {
+        config.exploration_time = value;
+    } else if(key == "communication_time" && value > 0) {
+        config.communication_time = value;
+    } else if(key == "stop_after" && value > 0) {
+        config.stop_after = value;
+    } else if(key == "save_image_every" && is_ticks) {
+        config.save_image_every = value;
+    } else if(key == "save_log_every" && is_ticks) {
+        config.save_log_every = value;
+    } else if(key == "save_snapshot_every" && is_ticks) {
+        config.save_snapshot_every = value;
+    } else if(key == "arena_center" && value > 0) {
+        config.arena_center_x = value;
+        config.arena_center_y = value;
+    } else if(key == "arena_center_x" && value > 0) {
+        config.arena_center_x = value;
+    } else if(key == "arena_center_y" && value > 0) {
+        config.arena_center_y = value;
+    } else if(key == "arena_size" && value > 0) {
+        config.arena_size = value;
+    } else if(key == "area_radius" && value > 0) {
+        config.area_radius = value;
+    } else if(key == "resources" && is_ticks && value <= TRACKED_RESOURCES) {
+        config.resources = value;
+    } else if(key == "area_depletion" && value >= 0 && value < 1) {
+        config.area_depletion = value;
+    } else if(key == "area_respawn_time" && value >= 0) {
+        config.area_respawn_time = value;
+    } else if(key == "sensing_latency" && value >= 0 && value < 10) {
+        config.sensing_latency = value;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool ExperimentConfig::load(const QString& filename, QString* error) {
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        *error = "cannot open " + filename;
+        return false;
+    }
+
+    // read in a copy, assigned if the whole file is valid
+    ExperimentConfig config = *this;
+    QTextStream stream(&file);
+    for(int line_number=1; !stream.atEnd(); line_number++) {
+        QString line = stream.readLine().trimmed();
+        if(line.isEmpty() || line.startsWith("#")) {
+            continue;
+        }
+        QStringList fields = line.split(" ", QString::SkipEmptyParts);
+        bool valid;
+        if(fields[0] == "arena") {
+            // further arena: centre and radius
+            arena_region region;
+            valid = fields.size() == 4;
+            region.center_x = valid ? fields[1].toDouble(&valid) : 0;
+            region.center_y = valid ? fields[2].toDouble(&valid) : 0;
+            region.size = valid ? fields[3].toDouble(&valid) : 0;
+            if(valid && region.size > 0) {
+                config.arenas.push_back(region);
+                continue;
+            }
+            valid = false;
+        } else if(fields[0] == "area_path") {
+            // resource, area, speed and at least one waypoint
+            area_path path;
+            valid = fields.size() >= 6 && fields.size()%2 == 0;
+            path.resource = valid ? fields[1].toUInt(&valid) : 0;
+            path.area = valid ? fields[2].toUInt(&valid) : 0;
+            path.speed = valid ? fields[3].toDouble(&valid) : 0;
+            for(int i=4; valid && i+1<fields.size(); i+=2) {
+                bool valid_y;
+                path.waypoints.push_back(QPointF(fields[i].toDouble(&valid), fields[i+1].toDouble(&valid_y)));
+                valid = valid && valid_y;
+            }
+            if(valid && path.speed > 0) {
+                config.paths.push_back(path);
+                continue;
+            }
+            valid = false;
+        } else if(fields[0] == "area_mask") {
+            // file name, then the optional origin
+            valid = fields.size() == 2 || fields.size() == 4;
+            QPointF origin(0,0);
+            if(valid && fields.size() == 4) {
+                bool valid_y;
+                origin = QPointF(fields[2].toDouble(&valid), fields[3].toDouble(&valid_y));
+                valid = valid && valid_y;
+            }
+            if(valid) {
+                config.area_mask = fields[1];
+                config.area_mask_origin = origin;
+                continue;
+            }
+        } else {
+            valid = fields.size() == 2;
+        }
+        double value = valid ? fields[1].toDouble(&valid) : 0;
+        if(!valid || !setKey(config, fields[0], value)) {
+            *error = QString("%1:%2 invalid setting \"%3\"").arg(filename).arg(line_number).arg(line);
+            return false;
+        }
+    }
+    *this = config;
+    return true;
+}
+
+ExperimentConfig ExperimentConfig::arena(uint index) const {
+    ExperimentConfig config = *this;
+    config.arena_center_x = arenas[index].center_x;
+    config.arena_center_y = arenas[index].center_y;
+    config.arena_size = arenas[index].size;
+    config.arenas.clear();
+    // the waypoints and the mask are in the region of the primary arena
+    config.paths.clear();
+    config.area_mask.clear();
+    return config;
+}
+
+QString ExperimentConfig::toString() const {
+    QString text = QString("global_quorum %1\nreal_utility %2\n").arg((int)global_quorum).arg((int)real_utility)
+            + QString("exploration_time %1\ncommunication_time %2\nstop_after %3\n")
+            .arg(exploration_time).arg(communication_time).arg(stop_after)
+            + QString("save_image_every %1\nsave_log_every %2\nsave_snapshot_every %3\n")
+            .arg(save_image_every).arg(save_log_every).arg(save_snapshot_every)
+            + QString("arena_center_x %1\narena_center_y %2\narena_size %3\narea_radius %4\n")
+            .arg(arena_center_x).arg(arena_center_y).arg(arena_size).arg(area_radius)
+            + QString("resources %1\n").arg(resources)
+            + QString("area_depletion %1\narea_respawn_time %2\n").arg(area_depletion).arg(area_respawn_time)
+            + QString("sensing_latency %1\n").arg(sensing_latency);
+    for(const area_path& path : paths) {
+        text = text + QString("area_path %1 %2 %3").arg(path.resource).arg(path.area).arg(path.speed);
+        for(const QPointF& waypoint : path.waypoints) {
+            text = text + QString(" %1 %2").arg(waypoint.x()).arg(waypoint.y());
+        }
+        text = text + "\n";
+    }
+    if(!area_mask.isEmpty()) {
+        text = text + QString("area_mask %1 %2 %3\n").arg(area_mask).arg(area_mask_origin.x()).arg(area_mask_origin.y());
+    }
+    for(const arena_region& region : arenas) {
+        text = text + QString("arena %1 %2 %3\n").arg(region.center_x).arg(region.center_y).arg(region.size);
+    }
+    return text;
+}
+
+void ExperimentConfig::save(QDataStream& out) const {
+    out << global_quorum << real_utility << exploration_time << communication_time << stop_after
+        << (quint32)save_image_every << (quint32)save_log_every << (quint32)save_snapshot_every
+        << arena_center_x << arena_center_y << arena_size << area_radius
+        << area_depletion << area_respawn_time << (quint32)paths.size();
+    for(const area_path& path : paths) {
+        out << (quint32)path.resource << (quint32)path.area << path.speed << (quint32)path.waypoints.size();
+        for(const QPointF& waypoint : path.waypoints) {
+            out << waypoint;
+        }
+    }
+    out << area_mask << area_mask_origin << sensing_latency;
+}
+
+bool ExperimentConfig::load(QDataStream& in) {
+    ExperimentConfig config;
+    quint32 save_image_every, save_log_every, save_snapshot_every;
+    in >> config.global_quorum >> config.real_utility >> config.exploration_time >> config.communication_time
+       >> config.stop_after >> save_image_every >> save_log_every >> save_snapshot_every
+       >> config.arena_center_x >> config.arena_center_y >> config.arena_size >> config.area_radius
+       >> config.area_depletion >> config.area_respawn_time;
+    quint32 paths_count;
+    in >> paths_count;
+    // a path per area at most
+    if(in.status() != QDataStream::Ok || save_image_every == 0 || save_log_every == 0 || save_snapshot_every == 0
+            || paths_count > 10000) {
+        return false;
+    }
+    for(quint32 p=0; p<paths_count; p++) {
+        area_path path;
+        quint32 resource, area, waypoints_count;
+        in >> resource >> area >> path.speed >> waypoints_count;
+        if(in.status() != QDataStream::Ok || waypoints_count == 0 || waypoints_count > 10000) {
+            return false;
+        }
+        path.resource = resource;
+        path.area = area;
+        path.waypoints.resize(waypoints_count);
+        for(QPointF& waypoint : path.waypoints) {
+            in >> waypoint;
+        }
+        config.paths.push_back(path);
+    }
+    in >> config.area_mask >> config.area_mask_origin >> config.sensing_latency;
+    if(in.status() != QDataStream::Ok) {
+        return false;
+    }
+    config.save_image_every = save_image_every;
+    config.save_log_every = save_log_every;
+    config.save_snapshot_every = save_snapshot_every;
+    *this = config;
+    return true;
+}
+
+#endif // EXPERIMENTCONFIG_CPP
@@ -0,0 +1,117 @@
+/**
+ * Configuration of a run of the complexity experiment.
+ *
+ * The experiment reads it from a text file at every initialise, so that the conditions can be
+ * changed between two runs in the arena without rebuilding the plugin. The file has one
+ * "key value" pair per line, empty lines and lines starting with # are ignored and the keys not
+ * in the file keep their default (the defines below). For example:
+ *
+ *   # longer exploration, quorum sensed by the kilobots
+ *   exploration_time 10
+ *   global_quorum 0
+ *
+ * The arena is the circle arena_center_x/y, arena_size (arena_center sets both coordinates). Each
+ * "arena x y size" line adds a further arena under the same camera, served by its own environment
+ * with the same configuration (see arenaSet.h).
+ *
+ * The areas are static unless set otherwise: an exploited area whose population falls to
+ * area_depletion is removed, and comes back at a random position area_respawn_time seconds later
+ * (never if 0). Each "area_path resource area speed x1 y1 x2 y2 ..." line moves an area of the
+ * primary arena along the waypoints at speed pixels per second, back to the first one after the
+ * last one.
+ *
+ * "area_mask file [x y]" reads the areas from a mask image placed at x, y (0, 0 by default) of the
+ * tracking image (see areaMask.h): a resource painted in the mask has the patches of its colour as
+ * areas, the others keep their generated circles. Only the primary arena has the mask.
+ *
+ * sensing_latency is the time from the emission of a message to the kb acting on it (overhead
+ * controller and IR frame): when not 0 the kbs are classified at the position predicted for the
+ * delivery of their message (see latencyPredictor.h), otherwise at the tracked one.
+ *
+ * resources is the number of resources created at the reset of the environment, up to
+ * TRACKED_RESOURCES: the kbs show their commitment with the led, and the tracker of ARK only tells
+ * red, green and blue apart (see resourceColours.h). The experiment starts from the value of its
+ * GUI, so the file only overrides it when it has the key.
+ *
+ * global_quorum and real_utility change the per robot path of the environment: each combination
+ * has its own instantiation of the virtual sensor, selected once when the configuration is
+ * applied (see mykilobotenvironment::configure).
+ */
+
+#ifndef EXPERIMENTCONFIG_H
+#define EXPERIMENTCONFIG_H
+
+#include <vector>
+
+#include <QString>
+#include <QPointF>
+#include <QDataStream>
+
+// defaults of the configuration
+#define ARENA_CENTER 750
+#define ARENA_SIZE 746
+#define AREA_RADIUS 146
+#define RESOURCES_COUNT 3
+
+#define EXPLORATION_TIME 5 // in seconds
+#define COMMUNICATION_TIME 5 // in seconds
+
+#define STOP_AFTER 3600 + 3600
+#define SAVE_IMAGE_EVERY 5
+#define SAVE_LOG_EVERY 5
+#define SAVE_SNAPSHOT_EVERY 100 // ticks (10 s)
+
+// if true, quorum is perceived and sent by ARK
+#define GLOBAL_QUORUM true
+// if true, then send the total utility of the resources
+#define REAL_UTILITY true
+
+struct ExperimentConfig {
+    struct arena_region {
+        double center_x, center_y;  /* pixels */
+        double size;                /* radius, pixels */
+    };
+    struct area_path {
+        uint resource, area;        /* indexes in the environment */
+        double speed;               /* pixels per second */
+        std::vector<QPointF> waypoints;
+    };
+
+    bool global_quorum;         /* quorum counted by ARK during the communication and broadcast at its end */
+    bool real_utility;          /* send the population of the resource, not the one of the area under the kb */
+    double exploration_time;    /* seconds */
+    double communication_time;  /* seconds */
+    double stop_after;          /* seconds */
+    uint save_image_every;      /* ticks */
+    uint save_log_every;        /* ticks */
+    uint save_snapshot_every;   /* ticks */
+    double arena_center_x;      /* pixels */
+    double arena_center_y;      /* pixels */
+    double arena_size;          /* radius of the arena, pixels */
+    double area_radius;         /* pixels */
+    uint resources;             /* resources of the environment, up to TRACKED_RESOURCES, not in the binary form (the snapshot has the resources) */
+    double area_depletion;      /* population at which an exploited area is removed, 0 never */
+    double area_respawn_time;   /* seconds before a removed area comes back, 0 never */
+    std::vector<area_path> paths;       /* scripted motion of areas */
+    QString area_mask;          /* mask image of the areas, none if empty */
+    QPointF area_mask_origin;   /* top left corner of the mask, pixels */
+    double sensing_latency;     /* seconds from the emission of a message to its delivery, 0 no prediction */
+    std::vector<arena_region> arenas;   /* further arenas, not in the binary form */
+
+    /* the defaults */
+    ExperimentConfig();
+
+    /* read the keys of a configuration file, false (configuration untouched) with the reason in error if not valid */
+    bool load(const QString& filename, QString* error);
+    /* configuration of the further arena, same as this one in its region */
+    ExperimentConfig arena(uint index) const;
+
+    /* all the keys, in the format of the configuration file */
+    QString toString() const;
+
+    /* binary form, in the snapshots of the environment */
+    void save(QDataStream& out) const;
+    bool load(QDataStream& in);
+};
+
+#endif // EXPERIMENTCONFIG_H
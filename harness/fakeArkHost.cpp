@@ -0,0 +1,184 @@
+#ifndef FAKEARKHOST_CPP
+#define FAKEARKHOST_CPP
+
+#include "fakeArkHost.h"
+
+#include <string.h>
+#include <chrono>
+
+#include <QDebug>
+#include <QMetaObject>
+
+typedef KilobotExperiment* (*create_experiment_t)();
+
+FakeArkHost::FakeArkHost() : experiment(NULL), gui(NULL), trace(NULL), initialised(false), completed(false) {
+    memset(&counters, 0, sizeof(counters));
+}
+
+FakeArkHost::~FakeArkHost() {
+    for(Kilobot* k : kilobots) {
+        delete k;
+    }
+    // the gui is owned by the host in ARK, the experiment is deleted before unloading the library
+    delete gui;
+    delete experiment;
+    if(library.isLoaded()) {
+        library.unload();
+    }
+}
+
+bool FakeArkHost::load(const QString& plugin_path) {
+    library.setFileName(plugin_path);
+    if(!library.load()) {
+        error = library.errorString();
+        return false;
+    }
+    create_experiment_t createExpt = (create_experiment_t)library.resolve("createExpt");
+    if(createExpt == NULL) {
+        error = "createExpt not found in " + plugin_path;
+        return false;
+    }
+    experiment = createExpt();
+
+    // same connections of ARK
+    connect(experiment, SIGNAL(signalKilobot(kilobot_message)), this, SLOT(countMessage(kilobot_message)));
+    connect(experiment, SIGNAL(broadcastMessage(kilobot_broadcast)), this, SLOT(countBroadcast(kilobot_broadcast)));
+    connect(experiment, SIGNAL(getInitialKilobotStates()), this, SLOT(setupKilobots()));
+    connect(experiment, SIGNAL(updateKilobotStates()), this, SLOT(updateKilobots()));
+    connect(experiment, SIGNAL(experimentComplete()), this, SLOT(complete()));
+    connect(experiment, SIGNAL(saveImage(QString)), this, SLOT(countImage()));
+    connect(experiment, SIGNAL(saveVideoFrames(QString,uint)), this, SLOT(countImage()));
+    connect(experiment, SIGNAL(drawCircle(QPointF,float,QColor,int,std::string,bool)), this, SLOT(countDrawing()));
+    connect(experiment, SIGNAL(drawLine(std::vector<cv::Point>,QColor,int,std::string,bool)), this, SLOT(countDrawing()));
+    connect(experiment, SIGNAL(drawCircleOnRecordedImage(QPointF,float,QColor,int,std::string)), this, SLOT(countDrawing()));
+    connect(experiment, SIGNAL(clearDrawings()), this, SLOT(countClear()));
+    connect(experiment, SIGNAL(clearDrawingsOnRecordedImage()), this, SLOT(countClear()));
+    return true;
+}
+
+bool FakeArkHost::setOption(const char* slot, bool value) {
+    // the check boxes of the GUI set the defaults, they are overwritten here
+    buildGUI();
+    return QMetaObject::invokeMethod(experiment, slot, Qt::DirectConnection, Q_ARG(bool, value));
+}
+
+void FakeArkHost::start(TrackingTrace* trace) {
+    this->trace = trace;
+    initialised = false;
+    completed = false;
+
+    buildGUI();
+
+    // the robots of the first frame are the ones identified by ARK before the start
+    if(trace->nextFrame(frame)) {
+        applyFrame();
+    }
+    experiment->initialise(false);
+    initialised = true;
+}
+
+void FakeArkHost::buildGUI() {
+    // as in ARK the GUI is created once, before the experiment starts
+    if(gui == NULL) {
+        gui = experiment->createGUI();
+    }
+}
+
+void FakeArkHost::applyFrame() {
+    for(const tracked_kilobot& k : frame) {
+        if(k.id >= kilobots.size()) {
+            kilobots.resize(k.id+1);
+        }
+        if(kilobots[k.id] == NULL) {
+            kilobots[k.id] = new Kilobot(k.id, k.position, k.velocity, k.colour);
+            kilobots_ids.append(k.id);
+            counters.robots++;
+            // a robot appearing after the start is set up on the fly
+            if(initialised) {
+                connect(kilobots[k.id], SIGNAL(sendUpdateToExperiment(Kilobot*,Kilobot)),
+                        experiment, SLOT(setupInitialStateRequiredCode(Kilobot*,Kilobot)));
+                kilobots[k.id]->updateExperiment();
+            }
+        }
+        kilobots[k.id]->updateState(k.position, k.velocity, k.colour);
+    }
+}
+
+bool FakeArkHost::tick() {
+    if(completed || !trace->nextFrame(frame)) {
+        return false;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    applyFrame();
+    // the tracker updates the virtual sensors of the robots seen in the frame
+    for(const tracked_kilobot& k : frame) {
+        kilobots[k.id]->updateHardware();
+    }
+    std::chrono::steady_clock::time_point sensed = std::chrono::steady_clock::now();
+    experiment->run();
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    sensor_latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(sensed-start).count());
+    run_latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(end-sensed).count());
+    tick_latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(end-start).count());
+    counters.ticks++;
+    return !completed;
+}
+
+void FakeArkHost::stop() {
+    experiment->stopExperiment();
+}
+
+void FakeArkHost::countMessage(kilobot_message) {
+    counters.messages++;
+}
+
+void FakeArkHost::countBroadcast(kilobot_broadcast message) {
+    counters.broadcasts++;
+    counters.broadcasts_by_type[message.type & 0xF]++;
+}
+
+void FakeArkHost::setupKilobots() {
+    for(kilobot_id id : kilobots_ids) {
+        connect(kilobots[id], SIGNAL(sendUpdateToExperiment(Kilobot*,Kilobot)), experiment, SLOT(setupInitialStateRequiredCode(Kilobot*,Kilobot)));
+        kilobots[id]->updateExperiment();
+    }
+}
+
+void FakeArkHost::updateKilobots() {
+    for(kilobot_id id : kilobots_ids) {
+        kilobots[id]->updateExperiment();
+    }
+}
+
+QString FakeArkHost::report(double wall_seconds) const {
+    // run() advances the experiment by 0.1 s
+    double simulated_seconds = counters.ticks*0.1;
+    QString report = QString("robots %1\nticks %2\nwall_s %3\nticks_per_s %4\nrealtime_factor %5\n")
+            .arg(counters.robots).arg(counters.ticks).arg(wall_seconds, 0, 'f', 3)
+            .arg(wall_seconds > 0 ? counters.ticks/wall_seconds : 0, 0, 'f', 1)
+            .arg(wall_seconds > 0 ? simulated_seconds/wall_seconds : 0, 0, 'f', 1);
+    report = report + QString("messages %1\nmessages_per_robot_per_s %2\nbroadcasts %3\n")
+            .arg(counters.messages)
+            .arg(counters.robots && simulated_seconds > 0 ? counters.messages/(counters.robots*simulated_seconds) : 0, 0, 'f', 3)
+            .arg(counters.broadcasts);
+    for(uint8_t t=0; t<16; t++) {
+        if(counters.broadcasts_by_type[t]) {
+            report = report + QString("broadcasts_type_%1 %2\n").arg(t).arg(counters.broadcasts_by_type[t]);
+        }
+    }
+    report = report + QString("drawings %1\nclears %2\nimages %3\n").arg(counters.drawings).arg(counters.clears).arg(counters.images);
+
+    report = report + "cost count p50_us p99_us max_us mean_us\n";
+    const char* names[3] = {"sensors", "run", "tick"};
+    const LatencyHistogram* histograms[3] = {&sensor_latency, &run_latency, &tick_latency};
+    for(uint8_t h=0; h<3; h++) {
+        report = report + QString("%1 %2 %3 %4 %5 %6\n").arg(names[h]).arg(histograms[h]->count())
+                .arg(histograms[h]->percentile(50)/1000.0, 0, 'f', 1).arg(histograms[h]->percentile(99)/1000.0, 0, 'f', 1)
+                .arg(histograms[h]->max()/1000.0, 0, 'f', 1).arg(histograms[h]->mean()/1000.0, 0, 'f', 1);
+    }
+    return report;
+}
+
+#endif // FAKEARKHOST_CPP
@@ -0,0 +1,107 @@
+/**
+ * Minimal replacement of ARK used to drive the experiment plugin offline.
+ *
+ * The host loads the plugin through createExpt(), connects the experiment signals as ARK
+ * does and owns one Kilobot object per tracked robot. Every tick it:
+ * - copies the next tracking frame into the Kilobot objects
+ * - calls Kilobot::updateHardware() for each robot (the virtual sensors of the environment)
+ * - calls run() on the experiment, which requests the kilobot states through updateKilobotStates
+ *
+ * There is no timer, ticks run back to back. Messages, broadcasts and drawings are counted
+ * and the cost of each tick is recorded in LatencyHistograms.
+ */
+
+#ifndef FAKEARKHOST_H
+#define FAKEARKHOST_H
+
+#include <stdint.h>
+
+#include <QObject>
+#include <QLibrary>
+#include <QVector>
+#include <QString>
+#include <QWidget>
+
+#include "kilobot.h"
+#include "kilobotexperiment.h"
+#include "tickProfiler.h"
+#include "trackingTrace.h"
+
+class FakeArkHost : public QObject {
+    Q_OBJECT
+public:
+    /* what the experiment asked to the host */
+    struct host_counters {
+        uint64_t messages;          /* signalKilobot */
+        uint64_t broadcasts;        /* broadcastMessage */
+        uint64_t broadcasts_by_type[16];
+        uint64_t drawings;          /* drawCircle, drawLine and the recorded image versions */
+        uint64_t clears;            /* clearDrawings and clearDrawingsOnRecordedImage */
+        uint64_t images;            /* saveImage and saveVideoFrames */
+        uint64_t ticks;
+        uint32_t robots;            /* Kilobot objects created by the host */
+    };
+
+    host_counters counters;
+
+    /* cost of the sensor updates, of run() and of the whole tick */
+    LatencyHistogram sensor_latency;
+    LatencyHistogram run_latency;
+    LatencyHistogram tick_latency;
+
+    FakeArkHost();
+    ~FakeArkHost();
+
+    /* load the plugin and create the experiment, false (see errorString) if it fails */
+    bool load(const QString& plugin_path);
+    QString errorString() const {return error;}
+
+    KilobotExperiment* getExperiment() {return experiment;}
+
+    /*
+     * call a bool slot of the experiment (e.g. toggleLogExp), as the GUI check boxes do,
+     * false if the experiment has no such slot; call it before start to affect initialise
+     */
+    bool setOption(const char* slot, bool value);
+
+    /* build the experiment GUI (its check boxes set the defaults) and call initialise */
+    void start(TrackingTrace* trace);
+
+    /* run one tick, false when the trace is over or the experiment is complete */
+    bool tick();
+
+    /* call stopExperiment on the experiment */
+    void stop();
+
+    /* counters and tick costs */
+    QString report(double wall_seconds) const;
+
+public slots:
+    void countMessage(kilobot_message message);
+    void countBroadcast(kilobot_broadcast message);
+    void countDrawing() {counters.drawings++;}
+    void countClear() {counters.clears++;}
+    void countImage() {counters.images++;}
+    void setupKilobots();
+    void updateKilobots();
+    void complete() {completed = true;}
+
+private:
+    QLibrary library;
+    KilobotExperiment* experiment;
+    QWidget* gui;
+    QString error;
+
+    TrackingTrace* trace;
+    QVector<tracked_kilobot> frame;
+    /* indexed by kilobot id, NULL if not tracked */
+    QVector<Kilobot*> kilobots;
+    QVector<kilobot_id> kilobots_ids;
+    bool initialised;
+    bool completed;
+
+    void buildGUI();
+    void applyFrame();
+};
+
+#endif // FAKEARKHOST_H
@@ -0,0 +1,40 @@
+#-------------------------------------------------
+#
+# Fake ARK host: loads the experiment plugin and replays tracking traces at full speed
+# run: ./complexityHarness --plugin=../libExperimentCOMPLEXITY.so [--robots=N | --trace=file] [--ticks=N]
+#
+#-------------------------------------------------
+
+QT       += widgets
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = complexityHarness
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -fopenmp-simd
+
+# the ARK templates and the kinematics used for the synthetic traces
+INCLUDEPATH += .. .
+
+SOURCES += \
+    main.cpp \
+    fakeArkHost.cpp \
+    trackingTrace.cpp \
+    ../kilobot.cpp \
+    ../kinematics.cpp \
+    ../tickProfiler.cpp
+
+HEADERS += \
+    fakeArkHost.h \
+    trackingTrace.h \
+    ../kilobot.h \
+    ../kilobotexperiment.h \
+    ../kilobotenvironment.h \
+    ../kinematics.h \
+    ../tickProfiler.h
+
+INCLUDEPATH += /usr/local/include/
+LIBS += -L/usr/local/lib \
+        -lopencv_core
@@ -0,0 +1,117 @@
+/**
+ * Fake ARK host: drives the experiment plugin with a recorded or synthetic tracking trace
+ * as fast as possible and reports the messages sent and the cost of each tick.
+ *
+ * usage: complexityHarness [--plugin=path] [--trace=file | --robots=N] [--ticks=N] [--seed=N]
+ *                          [--log] [--save-images] [--parallel-sensing] [--profile]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include <QApplication>
+#include <QDebug>
+
+#include "fakeArkHost.h"
+#include "trackingTrace.h"
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [--plugin=path] [--trace=file | --robots=N] [--ticks=N] [--seed=N]\n"
+                    "          [--log] [--save-images] [--parallel-sensing] [--profile]\n", name);
+}
+
+int main(int argc, char** argv) {
+    // the experiment GUI is created but never shown
+    if(qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    QString plugin = "libExperimentCOMPLEXITY.so";
+    QString trace_file;
+    uint32_t robots = 100;
+    uint32_t ticks = 36000; // one hour of experiment
+    unsigned int seed = 0;
+    bool log = false, save_images = false, parallel_sensing = false, profile = false;
+    for(int i=1; i<argc; i++) {
+        if(strncmp(argv[i], "--plugin=", 9) == 0) {
+            plugin = argv[i]+9;
+        } else if(strncmp(argv[i], "--trace=", 8) == 0) {
+            trace_file = argv[i]+8;
+        } else if(strncmp(argv[i], "--robots=", 9) == 0) {
+            robots = atoi(argv[i]+9);
+        } else if(strncmp(argv[i], "--ticks=", 8) == 0) {
+            ticks = atoi(argv[i]+8);
+        } else if(strncmp(argv[i], "--seed=", 7) == 0) {
+            seed = atoi(argv[i]+7);
+        } else if(strcmp(argv[i], "--log") == 0) {
+            log = true;
+        } else if(strcmp(argv[i], "--save-images") == 0) {
+            save_images = true;
+        } else if(strcmp(argv[i], "--parallel-sensing") == 0) {
+            parallel_sensing = true;
+        } else if(strcmp(argv[i], "--profile") == 0) {
+            profile = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(robots == 0 || robots > KILOBOT_MAX_ID) {
+        fprintf(stderr, "robots must be between 1 and %d\n", KILOBOT_MAX_ID);
+        return 1;
+    }
+
+    // the trace
+    TrackingTrace* trace;
+    if(trace_file.isEmpty()) {
+        trace = new SyntheticTrace(robots, seed);
+    } else {
+        RecordedTrace* recorded = new RecordedTrace(trace_file);
+        if(!recorded->isOpen()) {
+            fprintf(stderr, "cannot open trace %s\n", qPrintable(trace_file));
+            delete recorded;
+            return 1;
+        }
+        trace = recorded;
+    }
+
+    // the plugin
+    FakeArkHost host;
+    if(!host.load(plugin)) {
+        fprintf(stderr, "cannot load %s: %s\n", qPrintable(plugin), qPrintable(host.errorString()));
+        delete trace;
+        return 1;
+    }
+
+    // options are set as the check boxes of the experiment GUI would do
+    if(!host.setOption("toggleLogExp", log) || !host.setOption("toggleSaveImages", save_images)) {
+        qDebug() << "The experiment has no log/save image options";
+    }
+    if(parallel_sensing && !host.setOption("toggleParallelSensing", true)) {
+        qDebug() << "The experiment does not support parallel sensing";
+    }
+    if(profile && !host.setOption("toggleProfileTick", true)) {
+        qDebug() << "The experiment does not support tick profiling";
+    }
+
+    // the experiment seeds qrand with the current time, make the synthetic runs repeatable
+    qsrand(seed);
+    host.start(trace);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(uint32_t t=0; t<ticks; t++) {
+        if(!host.tick()) {
+            break;
+        }
+    }
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    // prints the tick profile of the experiment when profiling
+    host.stop();
+
+    printf("%s", qPrintable(host.report(wall_seconds)));
+    delete trace;
+    return 0;
+}
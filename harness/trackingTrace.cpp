@@ -0,0 +1,118 @@
+#ifndef TRACKINGTRACE_CPP
+#define TRACKINGTRACE_CPP
+
+#include "trackingTrace.h"
+
+#include <math.h>
+
+#include <QDebug>
+#include <QStringList>
+
+#define KILOBOT_RADIUS 5            // pixels, as drawn by plotEnvironment
+#define KILOBOT_TICKS_PER_FRAME 3   // the kilobot loop runs at ~31 Hz, a frame every 100 ms
+
+SyntheticTrace::SyntheticTrace(uint32_t robots, unsigned int seed, double switch_probability, uint32_t frames) :
+    // 1 px per tick, turning at pi/5 rad per second at 31 ticks per second
+    kinematics(robots, KILOBOT_RADIUS, 1, M_PI/5/31, seed),
+    switch_probability(switch_probability), frames(frames), frame_counter(0), re(seed) {
+    kinematics.scatter();
+
+    // half of the robots start committed to a random resource
+    std::uniform_int_distribution<int> colour(RED, BLUE);
+    colours.resize(robots);
+    for(uint32_t i=0; i<robots; i++) {
+        colours[i] = (i%2) ? (kilobot_colour)colour(re) : OFF;
+    }
+}
+
+bool SyntheticTrace::nextFrame(QVector<tracked_kilobot>& frame) {
+    if(frames != 0 && frame_counter >= frames) {
+        return false;
+    }
+    frame_counter++;
+
+    uint32_t robots = kinematics.size();
+    QVector<QPointF> previous(robots);
+    for(uint32_t i=0; i<robots; i++) {
+        previous[i] = kinematics.getPosition(i);
+    }
+    for(uint8_t t=0; t<KILOBOT_TICKS_PER_FRAME; t++) {
+        kinematics.step();
+    }
+
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::uniform_int_distribution<int> colour(OFF, BLUE);
+    frame.resize(robots);
+    for(uint32_t i=0; i<robots; i++) {
+        if(uniform(re) < switch_probability) {
+            colours[i] = (kilobot_colour)colour(re);
+        }
+        frame[i].id = i;
+        frame[i].position = kinematics.getPosition(i);
+        frame[i].velocity = frame[i].position-previous[i];
+        frame[i].colour = colours[i];
+    }
+    return true;
+}
+
+RecordedTrace::RecordedTrace(const QString& filename) : file(filename), has_pending(false) {
+    if(file.open(QIODevice::ReadOnly)) {
+        stream.setDevice(&file);
+    }
+}
+
+bool RecordedTrace::readLine(double& time, tracked_kilobot& kilobot) {
+    while(!stream.atEnd()) {
+        QString line = stream.readLine().trimmed();
+        if(line.isEmpty() || line.startsWith("#")) {
+            continue;
+        }
+        QStringList fields = line.split(" ", QString::SkipEmptyParts);
+        if(fields.size() < 5) {
+            qDebug() << "Skipping malformed trace line:" << line;
+            continue;
+        }
+        int id = fields[1].toInt();
+        if(id < 0 || id >= KILOBOT_MAX_ID) {
+            qDebug() << "Skipping trace line with invalid id:" << line;
+            continue;
+        }
+        time = fields[0].toDouble();
+        kilobot.id = id;
+        kilobot.position = QPointF(fields[2].toDouble(), fields[3].toDouble());
+        kilobot.colour = (kilobot_colour)qBound(0, fields[4].toInt(), (int)BLUE);
+        return true;
+    }
+    return false;
+}
+
+bool RecordedTrace::nextFrame(QVector<tracked_kilobot>& frame) {
+    frame.clear();
+    if(!has_pending) {
+        has_pending = readLine(pending_time, pending);
+    }
+    if(!has_pending) {
+        return false;
+    }
+
+    // collect all lines with the time of the first one
+    double frame_time = pending_time;
+    while(has_pending && pending_time == frame_time) {
+        frame.append(pending);
+        has_pending = readLine(pending_time, pending);
+    }
+
+    // velocity from the previous position of the same id (as the kilobot default if unknown)
+    if(last_positions.size() < KILOBOT_MAX_ID) {
+        last_positions.resize(KILOBOT_MAX_ID);
+        seen.fill(false, KILOBOT_MAX_ID);
+    }
+    for(tracked_kilobot& k : frame) {
+        k.velocity = seen[k.id] ? k.position-last_positions[k.id] : QPointF(1,1);
+        last_positions[k.id] = k.position;
+        seen[k.id] = true;
+    }
+    return true;
+}
+
+#endif // TRACKINGTRACE_CPP
@@ -0,0 +1,91 @@
+/**
+ * Sources of tracking frames for the fake ARK host.
+ *
+ * A frame holds, for each robot seen by the tracker, the same values ARK copies into its
+ * Kilobot objects: id, position and velocity in pixels of the tracking image and led colour.
+ *
+ * - SyntheticTrace moves N robots with KilobotKinematics (random walk of complexity.c) and
+ *   changes their led colour at random, it scales to the 1024 ids of kilobot_message
+ * - RecordedTrace reads a text trace, one line per robot per frame:
+ *       time id x y colour
+ *   where colour is a lightColour (0 off, 1 red, 2 green, 3 blue) and lines with the same
+ *   time belong to the same frame; lines starting with # are comments.
+ *   Velocities are the displacement from the previous frame.
+ */
+
+#ifndef TRACKINGTRACE_H
+#define TRACKINGTRACE_H
+
+#include <stdint.h>
+#include <random>
+
+#include <QVector>
+#include <QPointF>
+#include <QFile>
+#include <QTextStream>
+#include <QString>
+
+#include "kilobot.h"
+#include "kinematics.h"
+
+/* a robot in a tracking frame */
+struct tracked_kilobot {
+    kilobot_id id;
+    QPointF position;
+    QPointF velocity;
+    kilobot_colour colour;
+};
+
+class TrackingTrace {
+public:
+    virtual ~TrackingTrace() {}
+
+    /* fill frame with the next tracking frame, false when the trace is over */
+    virtual bool nextFrame(QVector<tracked_kilobot>& frame) = 0;
+};
+
+class SyntheticTrace : public TrackingTrace {
+public:
+    /*
+     * robots: number of robots (ids 0 to robots-1)
+     * switch_probability: probability per frame that a robot changes its led colour
+     * frames: length of the trace, 0 for endless
+     */
+    SyntheticTrace(uint32_t robots, unsigned int seed=0, double switch_probability=0.002, uint32_t frames=0);
+
+    bool nextFrame(QVector<tracked_kilobot>& frame);
+
+private:
+    KilobotKinematics kinematics;
+    QVector<kilobot_colour> colours;
+    double switch_probability;
+    uint32_t frames, frame_counter;
+    std::default_random_engine re;
+};
+
+class RecordedTrace : public TrackingTrace {
+public:
+    RecordedTrace(const QString& filename);
+
+    /* false if the file could not be opened */
+    bool isOpen() const {return file.isOpen();}
+
+    bool nextFrame(QVector<tracked_kilobot>& frame);
+
+private:
+    QFile file;
+    QTextStream stream;
+
+    /* first line of the next frame, already read */
+    bool has_pending;
+    double pending_time;
+    tracked_kilobot pending;
+
+    /* last position of each id, used for the velocities */
+    QVector<QPointF> last_positions;
+    QVector<bool> seen;
+
+    bool readLine(double& time, tracked_kilobot& kilobot);
+};
+
+#endif // TRACKINGTRACE_H
@@ -0,0 +1,211 @@
+#ifndef IRCHANNEL_CPP
+#define IRCHANNEL_CPP
+
+#include "irChannel.h"
+
+IrChannel::IrChannel(double communication_range, uint8_t slots_per_tick, double delivery_probability, unsigned int seed) :
+    communication_range(communication_range), slots_per_tick(slots_per_tick), delivery_probability(delivery_probability) {
+    this->pos_x = NULL;
+    this->pos_y = NULL;
+    this->robots_count = 0;
+    this->buckets_mask = 0;
+    this->tick_seed = 0;
+    // at least one slot (and at most 255 to fit the slot in a byte)
+    if(this->slots_per_tick == 0)
+        this->slots_per_tick = 1;
+
+    re.seed(seed);
+    resetCounters();
+}
+
+void IrChannel::resetCounters() {
+    this->transmitted = 0;
+    this->delivered = 0;
+    this->collided = 0;
+    this->dropped = 0;
+}
+
+void IrChannel::rebuild(const float* x, const float* y, uint16_t robots) {
+    this->pos_x = x;
+    this->pos_y = y;
+    this->robots_count = robots;
+
+    // use a power of two buckets, at least twice the robots, to keep them sparse
+    uint32_t buckets = 16;
+    while(buckets < 2*(uint32_t)robots) {
+        buckets = buckets << 1;
+    }
+    this->buckets_mask = buckets-1;
+
+    // counting sort of the robots by bucket
+    bucket_start.assign(buckets+1, 0);
+    robot_bucket.resize(robots);
+    sorted_robots.resize(robots);
+    for(uint16_t i=0; i<robots; i++) {
+        robot_bucket[i] = bucketOf(cellOf(x[i]), cellOf(y[i]));
+        bucket_start[robot_bucket[i]+1]++;
+    }
+    for(uint32_t b=0; b<buckets; b++) {
+        bucket_start[b+1] += bucket_start[b];
+    }
+    // robots keep increasing id order inside the bucket, needed for deterministic delivery
+    std::vector<uint32_t> fill(bucket_start.begin(), bucket_start.end()-1);
+    for(uint16_t i=0; i<robots; i++) {
+        sorted_robots[fill[robot_bucket[i]]++] = i;
+    }
+}
+
+uint8_t IrChannel::surroundingBuckets(uint16_t robot, uint32_t buckets[9]) const {
+    uint8_t count = 0;
+    int32_t cx = cellOf(pos_x[robot]);
+    int32_t cy = cellOf(pos_y[robot]);
+    for(int32_t dx=-1; dx<=1; dx++) {
+        for(int32_t dy=-1; dy<=1; dy++) {
+            uint32_t b = bucketOf(cx+dx, cy+dy);
+            // different cells can share the same bucket, visit it only once
+            bool visited = false;
+            for(uint8_t i=0; i<count; i++) {
+                if(buckets[i] == b) {
+                    visited = true;
+                    break;
+                }
+            }
+            if(!visited) {
+                buckets[count++] = b;
+            }
+        }
+    }
+    return count;
+}
+
+void IrChannel::neighbours(uint16_t robot, std::vector<uint16_t>& neighbours) const {
+    double range2 = communication_range*communication_range;
+    uint32_t buckets[9];
+    uint8_t buckets_count = surroundingBuckets(robot, buckets);
+    for(uint8_t b=0; b<buckets_count; b++) {
+        for(uint32_t s=bucket_start[buckets[b]]; s<bucket_start[buckets[b]+1]; s++) {
+            uint16_t other = sorted_robots[s];
+            double dx = pos_x[other]-pos_x[robot];
+            double dy = pos_y[other]-pos_y[robot];
+            if(other != robot && dx*dx+dy*dy <= range2) {
+                neighbours.push_back(other);
+            }
+        }
+    }
+}
+
+double IrChannel::receiverRandom(uint16_t robot, uint8_t slot) const {
+    // splitmix64 of the tick seed mixed with receiver and slot
+    uint64_t z = tick_seed + 0x9E3779B97F4A7C15ull*((uint64_t)robot*256+slot+1);
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBull;
+    z = z ^ (z >> 31);
+    return (z >> 11)*(1.0/9007199254740992.0);
+}
+
+void IrChannel::prepare(const float* x, const float* y, uint16_t robots) {
+    rebuild(x, y, robots);
+
+    // collect outgoing messages and pick a slot for each of them
+    std::uniform_int_distribution<int> slot_distribution(0, slots_per_tick-1);
+    outgoing.assign(robots, NULL);
+    robot_slot.resize(robots);
+    for(uint16_t i=0; i<robots; i++) {
+        if(tx) {
+            outgoing[i] = tx(i);
+        }
+        if(outgoing[i]) {
+            robot_slot[i] = (uint8_t)slot_distribution(re);
+            this->transmitted++;
+        }
+    }
+    this->tick_seed = ((uint64_t)re() << 32) ^ re();
+}
+
+void IrChannel::listen(uint16_t robot, std::vector<delivery>& deliveries, listen_counters& counters) const {
+    // per slot number of transmitters in range, the last of them and its squared distance
+    uint16_t slot_count[256] = {0};
+    uint16_t slot_sender[256];
+    double slot_distance[256];
+
+    double range2 = communication_range*communication_range;
+    uint32_t buckets[9];
+    uint8_t buckets_count = surroundingBuckets(robot, buckets);
+    for(uint8_t b=0; b<buckets_count; b++) {
+        for(uint32_t s=bucket_start[buckets[b]]; s<bucket_start[buckets[b]+1]; s++) {
+            uint16_t t = sorted_robots[s];
+            if(t == robot || !outgoing[t])
+                continue;
+            double dx = pos_x[t]-pos_x[robot];
+            double dy = pos_y[t]-pos_y[robot];
+            double d2 = dx*dx+dy*dy;
+            if(d2 <= range2) {
+                uint8_t slot = robot_slot[t];
+                slot_count[slot]++;
+                slot_sender[slot] = t;
+                slot_distance[slot] = d2;
+            }
+        }
+    }
+
+    for(uint16_t slot=0; slot<slots_per_tick; slot++) {
+        if(slot_count[slot] == 0)
+            continue;
+        // half duplex: a robot does not hear while transmitting
+        if(slot_count[slot] > 1 || (outgoing[robot] && robot_slot[robot] == slot)) {
+            counters.collided += slot_count[slot];
+            continue;
+        }
+        if(receiverRandom(robot, slot) >= delivery_probability) {
+            counters.dropped++;
+            continue;
+        }
+        counters.delivered++;
+        delivery d;
+        d.receiver = robot;
+        d.sender = slot_sender[slot];
+        d.distance = sqrt(slot_distance[slot]);
+        deliveries.push_back(d);
+    }
+}
+
+void IrChannel::merge(const listen_counters& counters) {
+    this->delivered += counters.delivered;
+    this->collided += counters.collided;
+    this->dropped += counters.dropped;
+}
+
+void IrChannel::dispatch(const std::vector<delivery>& deliveries) {
+    if(rx) {
+        for(const delivery& d : deliveries) {
+            rx(d.receiver, *outgoing[d.sender], d.distance);
+        }
+    }
+}
+
+void IrChannel::notifyTransmitters() {
+    // signal the transmitters that their message left
+    if(tx_success) {
+        for(uint16_t i=0; i<robots_count; i++) {
+            if(outgoing[i]) {
+                tx_success(i);
+            }
+        }
+    }
+}
+
+void IrChannel::step(const float* x, const float* y, uint16_t robots) {
+    prepare(x, y, robots);
+
+    // deliver to each receiver the messages from the slots with a single transmitter in range
+    std::vector<delivery> deliveries;
+    listen_counters counters;
+    for(uint16_t r=0; r<robots; r++) {
+        listen(r, deliveries, counters);
+    }
+    merge(counters);
+    dispatch(deliveries);
+    notifyTransmitters();
+}
+
+#endif // IRCHANNEL_CPP
@@ -0,0 +1,141 @@
+/**
+ * Headless model of the kilobot infrared channel.
+ *
+ * Used to study the kilobot-to-kilobot gossip (type 1 messages, see send_own_state and
+ * get_message_for_rebroadcast in kilobot_c_code/complexity.c) without ARGoS or real hardware.
+ *
+ * Every tick the robots are hashed in a uniform grid with cells as large as the communication
+ * range, so that each receiver only tests the robots in the 3x3 block of cells around it.
+ * A tick is divided in a number of transmission slots; every transmitter picks one slot at random.
+ * A receiver gets a message only if exactly one transmitter within range used that slot (otherwise
+ * the messages collide) and it was not transmitting itself in the same slot. Non colliding messages
+ * are then delivered with a given probability to model the lossy medium.
+ *
+ * The random draws of the receivers only depend on the tick and on the receiver, so that
+ * listen() can be called for different receivers from different threads (see ParallelStepper)
+ * and the deliveries are the same regardless of the order or of the number of threads.
+ */
+
+#ifndef IRCHANNEL_H
+#define IRCHANNEL_H
+
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+#include <random>
+#include <functional>
+
+/* the message as seen by the kilobot, same layout of message_t in kilolib (crc excluded) */
+struct kilobot_ir_message {
+    uint8_t data[9];
+    uint8_t type;
+};
+
+class IrChannel {
+public:
+    /* called to get the message a robot wants to send this tick, NULL if none (as message_tx) */
+    typedef std::function<kilobot_ir_message*(uint16_t robot)> tx_callback;
+    /* called after the robot transmitted its message (as message_tx_success) */
+    typedef std::function<void(uint16_t robot)> tx_success_callback;
+    /* called for every delivered message (as message_rx), distance is in the same unit of positions */
+    typedef std::function<void(uint16_t robot, const kilobot_ir_message& msg, double distance)> rx_callback;
+
+    double communication_range; /* maximum distance for a message to be received */
+    uint8_t slots_per_tick;     /* transmission slots in one tick, messages in the same slot collide */
+    double delivery_probability; /* probability that a non colliding message is received */
+
+    /* counters since last resetCounters() */
+    uint64_t transmitted;   /* messages sent */
+    uint64_t delivered;     /* messages received */
+    uint64_t collided;      /* messages lost at a receiver due to a collision */
+    uint64_t dropped;       /* messages lost at a receiver due to the delivery probability */
+
+    /* constructor */
+    IrChannel(double communication_range, uint8_t slots_per_tick=8, double delivery_probability=0.9, unsigned int seed=0);
+
+    /* set the callbacks used to exchange messages with the robots */
+    void setTxCallback(tx_callback tx) {this->tx = tx;}
+    void setTxSuccessCallback(tx_success_callback tx_success) {this->tx_success = tx_success;}
+    void setRxCallback(rx_callback rx) {this->rx = rx;}
+
+    void seed(unsigned int seed) {re.seed(seed);}
+    void resetCounters();
+
+    /*
+     * rebuild the spatial hash with the current robot positions
+     * (called by step, exposed for neighbour queries)
+     */
+    void rebuild(const float* x, const float* y, uint16_t robots);
+
+    /* append to neighbours all robots within communication range of robot (uses last rebuild) */
+    void neighbours(uint16_t robot, std::vector<uint16_t>& neighbours) const;
+
+    /* a message received by a robot, see listen */
+    struct delivery {
+        uint16_t receiver;
+        uint16_t sender;
+        double distance;
+    };
+
+    /* receiver side counters of a listen call, to be merged with merge */
+    struct listen_counters {
+        uint64_t delivered;
+        uint64_t collided;
+        uint64_t dropped;
+        listen_counters() : delivered(0), collided(0), dropped(0) {}
+    };
+
+    /*
+     * split of step, used to serve the receivers from several threads
+     * - prepare: rebuild the hash and collect the outgoing messages (single thread)
+     * - listen: compute the messages received by robot (thread safe, appends to deliveries)
+     * - dispatch: call the rx callback for the deliveries and the tx_success callback (single thread)
+     */
+    void prepare(const float* x, const float* y, uint16_t robots);
+    void listen(uint16_t robot, std::vector<delivery>& deliveries, listen_counters& counters) const;
+    void dispatch(const std::vector<delivery>& deliveries);
+    void merge(const listen_counters& counters);
+    void notifyTransmitters();
+
+    /*
+     * simulate one tick of communication:
+     * - rebuild the spatial hash
+     * - collect the messages to send and assign them a random slot
+     * - deliver non colliding messages to the receivers
+     */
+    void step(const float* x, const float* y, uint16_t robots);
+
+private:
+    tx_callback tx;
+    tx_success_callback tx_success;
+    rx_callback rx;
+
+    std::default_random_engine re;
+
+    /* spatial hash, robots sorted by bucket (counting sort) */
+    const float* pos_x;
+    const float* pos_y;
+    uint16_t robots_count;
+    uint32_t buckets_mask;
+    std::vector<uint32_t> bucket_start; /* first robot of each bucket in sorted_robots, size buckets+1 */
+    std::vector<uint16_t> sorted_robots;
+    std::vector<uint32_t> robot_bucket;
+
+    /* per tick transmission state */
+    std::vector<kilobot_ir_message*> outgoing; /* message of each robot, NULL if silent */
+    std::vector<uint8_t> robot_slot;          /* slot used by each transmitting robot */
+    uint64_t tick_seed;                       /* drawn every tick, base of the receivers random draws */
+
+    /* uniform in [0,1) depending only on the tick, the receiver and the slot */
+    double receiverRandom(uint16_t robot, uint8_t slot) const;
+
+    int32_t cellOf(float v) const {return (int32_t)floorf(v/communication_range);}
+    uint32_t bucketOf(int32_t cx, int32_t cy) const {
+        return (((uint32_t)cx*73856093u) ^ ((uint32_t)cy*19349663u)) & buckets_mask;
+    }
+
+    /* collect the (deduplicated) buckets in the 3x3 block of cells around robot */
+    uint8_t surroundingBuckets(uint16_t robot, uint32_t buckets[9]) const;
+};
+
+#endif // IRCHANNEL_H
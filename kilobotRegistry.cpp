@@ -0,0 +1,187 @@
+#ifndef KILOBOTREGISTRY_CPP
+#define KILOBOTREGISTRY_CPP
+
+#include "kilobotRegistry.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <utility>
+
+KilobotRegistry::KilobotRegistry(uint resources) :
+    count(0), capacity(0), resources_count(resources), block(NULL),
+    ids_(NULL), positions_(NULL), orientations_(NULL), leds_(NULL), states_(NULL), last_sent_(NULL),
+    last_seen_(NULL), exploiting_(NULL), safe_centres_(NULL), safe_radii_(NULL), poses_(NULL), quorum_(NULL), areas_(NULL), utilities_(NULL) {
+}
+
+KilobotRegistry::~KilobotRegistry() {
+    free(block);
+}
+
+void KilobotRegistry::clear(uint resources) {
+    count = 0;
+    index_of.clear();
+    if(resources != resources_count) {
+        // the per resource fields change stride, the next add lays out a new block
+        KilobotRegistry empty(resources);
+        swap(empty);
+    }
+}
+
+uint KilobotRegistry::add(kilobot_id id) {
+    int known = indexOf(id);
+    if(known >= 0) {
+        return known;
+    }
+    if(id >= index_of.size()) {
+        index_of.resize(id+1, -1);
+    }
+    if(count == capacity) {
+        reserve(capacity ? 2*capacity : REGISTRY_INITIAL_CAPACITY);
+    }
+
+    // default state, as a kb not seen yet by the tracking
+    uint index = count++;
+    index_of[id] = index;
+    ids_[index] = id;
+    positions_[index] = QPointF();
+    orientations_[index] = 0;
+    leds_[index] = OFF;
+    states_[index] = 0;
+    last_sent_[index] = 0;
+    last_seen_[index] = 0;
+    exploiting_[index] = -1;
+    safe_centres_[index] = QPointF();
+    safe_radii_[index] = -1;
+    poses_[index].clear();
+    for(uint r=0; r<resources_count; r++) {
+        quorum_[index*resources_count+r] = 0;
+        areas_[index*resources_count+r] = -1;
+        utilities_[index*resources_count+r] = 0;
+    }
+    return index;
+}
+
+template<class T>
+void KilobotRegistry::relocate(T*& field, char* block, size_t& offset, uint capacity, uint per_kb) {
+    if(block) {
+        T* moved = reinterpret_cast<T*>(block+offset);
+        if(count) {
+            memcpy(moved, field, (size_t)count*per_kb*sizeof(T));
+        }
+        field = moved;
+    }
+    size_t bytes = (size_t)capacity*per_kb*sizeof(T);
+    offset += (bytes+REGISTRY_ALIGNMENT-1)/REGISTRY_ALIGNMENT*REGISTRY_ALIGNMENT;
+}
+
+void KilobotRegistry::reserve(uint capacity) {
+    // the first pass only measures the block, the second one moves the fields in it
+    char* block = NULL;
+    for(int pass=0; pass<2; pass++) {
+        size_t offset = 0;
+        relocate(poses_, block, offset, capacity, 1);
+        relocate(positions_, block, offset, capacity, 1);
+        relocate(safe_centres_, block, offset, capacity, 1);
+        relocate(orientations_, block, offset, capacity, 1);
+        relocate(safe_radii_, block, offset, capacity, 1);
+        relocate(utilities_, block, offset, capacity, resources_count);
+        relocate(last_sent_, block, offset, capacity, 1);
+        relocate(last_seen_, block, offset, capacity, 1);
+        relocate(ids_, block, offset, capacity, 1);
+        relocate(areas_, block, offset, capacity, resources_count);
+        relocate(leds_, block, offset, capacity, 1);
+        relocate(states_, block, offset, capacity, 1);
+        relocate(exploiting_, block, offset, capacity, 1);
+        relocate(quorum_, block, offset, capacity, resources_count);
+        if(pass == 0) {
+            block = (char*)malloc(offset);
+            if(block == NULL) {
+                throw std::bad_alloc();
+            }
+        }
+    }
+    free(this->block);
+    this->block = block;
+    this->capacity = capacity;
+}
+
+void KilobotRegistry::swap(KilobotRegistry& other) {
+    std::swap(count, other.count);
+    std::swap(capacity, other.capacity);
+    std::swap(resources_count, other.resources_count);
+    std::swap(block, other.block);
+    index_of.swap(other.index_of);
+    std::swap(ids_, other.ids_);
+    std::swap(positions_, other.positions_);
+    std::swap(orientations_, other.orientations_);
+    std::swap(leds_, other.leds_);
+    std::swap(states_, other.states_);
+    std::swap(last_sent_, other.last_sent_);
+    std::swap(last_seen_, other.last_seen_);
+    std::swap(exploiting_, other.exploiting_);
+    std::swap(safe_centres_, other.safe_centres_);
+    std::swap(safe_radii_, other.safe_radii_);
+    std::swap(poses_, other.poses_);
+    std::swap(quorum_, other.quorum_);
+    std::swap(areas_, other.areas_);
+    std::swap(utilities_, other.utilities_);
+}
+
+void KilobotRegistry::save(QDataStream& out) const {
+    out << (quint32)resources_count << (quint32)count;
+    for(uint i=0; i<count; i++) {
+        out << (quint16)ids_[i] << positions_[i] << orientations_[i] << (quint8)leds_[i] << (quint8)states_[i]
+            << last_sent_[i] << (quint32)last_seen_[i] << (qint8)exploiting_[i];
+        poses_[i].save(out);
+        for(uint r=0; r<resources_count; r++) {
+            out << (quint8)quorum_[i*resources_count+r] << (qint16)areas_[i*resources_count+r]
+                << utilities_[i*resources_count+r];
+        }
+    }
+}
+
+bool KilobotRegistry::load(QDataStream& in) {
+    quint32 resources, kilobots;
+    in >> resources >> kilobots;
+    if(in.status() != QDataStream::Ok || resources > MAX_RESOURCES || kilobots > 65536) {
+        return false;
+    }
+
+    // read in a new registry, swapped in if valid
+    KilobotRegistry loaded(resources);
+    for(quint32 k=0; k<kilobots; k++) {
+        quint16 id;
+        quint8 led, state;
+        quint32 last_seen;
+        qint8 exploiting;
+        in >> id;
+        if(in.status() != QDataStream::Ok || loaded.contains(id)) {
+            return false;
+        }
+        uint i = loaded.add(id);
+        in >> loaded.positions_[i] >> loaded.orientations_[i] >> led >> state >> loaded.last_sent_[i] >> last_seen >> exploiting;
+        loaded.poses_[i].load(in);
+        if(led >= LIGHT_COLOURS || exploiting < -1 || exploiting >= (int)resources) {
+            return false;
+        }
+        loaded.leds_[i] = led;
+        loaded.states_[i] = state;
+        loaded.last_seen_[i] = last_seen;
+        loaded.exploiting_[i] = exploiting;
+        for(uint r=0; r<resources; r++) {
+            quint8 quorum;
+            qint16 area;
+            in >> quorum >> area >> loaded.utilities_[i*resources+r];
+            loaded.quorum_[i*resources+r] = quorum;
+            loaded.areas_[i*resources+r] = area;
+        }
+    }
+    if(in.status() != QDataStream::Ok) {
+        return false;
+    }
+    swap(loaded);
+    return true;
+}
+
+#endif // KILOBOTREGISTRY_CPP
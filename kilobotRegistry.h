@@ -0,0 +1,113 @@
+/**
+ * Dense registry of the kilobots of the experiment.
+ *
+ * Hardware ids are sparse (any 16-bit value), the registry maps each one to a dense index
+ * 0..size()-1 in order of registration with a direct lookup table: add() and indexOf() are O(1).
+ *
+ * The state of the kilobots is kept as a structure of arrays, all carved from one contiguous
+ * block: each field is an array indexed by dense index (the per resource fields have resources()
+ * entries per kb, at index*resources()+r). A pass over one field of all kilobots (e.g. the leds
+ * for the statistics) hence reads consecutive bytes only. The block grows by doubling: the
+ * pointers returned by the field accessors are valid until the next add() or clear().
+ */
+
+#ifndef KILOBOTREGISTRY_H
+#define KILOBOTREGISTRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <QPointF>
+#include <QDataStream>
+
+#include "kilobot.h"
+#include "poseFilter.h"
+#include "resourceColours.h"
+
+// alignment of the fields in the block (as malloc)
+#define REGISTRY_ALIGNMENT 16
+// kilobots the block is first sized for, it doubles when full
+#define REGISTRY_INITIAL_CAPACITY 128
+
+class KilobotRegistry {
+public:
+    explicit KilobotRegistry(uint resources=3);
+    ~KilobotRegistry();
+
+    /* forget all kilobots, the per resource fields get resources entries per kb */
+    void clear(uint resources);
+
+    /* dense index of the kb, registered with the default state if not known yet */
+    uint add(kilobot_id id);
+
+    /* dense index of the kb, -1 if not registered */
+    int indexOf(kilobot_id id) const {
+        return id < index_of.size() ? index_of[id] : -1;
+    }
+    bool contains(kilobot_id id) const {return indexOf(id) >= 0;}
+
+    uint size() const {return count;}
+    uint resources() const {return resources_count;}
+
+    /* fields, indexed by dense index */
+    kilobot_id* ids() const {return ids_;}
+    QPointF* positions() const {return positions_;}
+    double* orientations() const {return orientations_;}      /* degrees, for the log */
+    kilobot_led* leds() const {return leds_;}                 /* led of the kb (OFF if uncommitted, see resourceColours.h) */
+    resource_mask* states() const {return states_;}           /* bit r set if over an area of resource r */
+    float* lastSent() const {return last_sent_;}              /* when the last message was sent to the kb */
+    uint32_t* lastSeen() const {return last_seen_;}           /* environment update at which the kb was last reported by the tracking */
+    int8_t* exploiting() const {return exploiting_;}          /* resource whose area counts the kb in kilobots_in_area, -1 if none */
+    QPointF* safeCentres() const {return safe_centres_;}      /* position of the last full classification of the kb */
+    double* safeRadii() const {return safe_radii_;}           /* distance to the nearest area boundary from there, -1 if not valid */
+    PoseFilter* poses() const {return poses_;}                /* filtered tracking of the kb, cleared until seen */
+    /* fields with one entry per resource, at index*resources()+r */
+    uint8_t* quorum() const {return quorum_;}                 /* times the kb was seen committed to r in the broadcast phase */
+    int16_t* areas() const {return areas_;}                   /* area of resource r under the kb (index in Resource::areas), -1 if none */
+    double* utilities() const {return utilities_;}            /* population of the area of resource r under the kb, at its last message */
+
+    /* led of the kb at index */
+    kilobot_led led(uint index) const {return leds_[index];}
+
+    /* write the kilobots in a snapshot (the safe radii are not saved) */
+    void save(QDataStream& out) const;
+    /* replace the kilobots with the ones of a snapshot, false (registry untouched) if not valid */
+    bool load(QDataStream& in);
+
+    /* exchange the kilobots with other */
+    void swap(KilobotRegistry& other);
+
+private:
+    uint count;
+    uint capacity;
+    uint resources_count;
+    char* block;                        /* all the fields, each aligned to REGISTRY_ALIGNMENT */
+    std::vector<int32_t> index_of;      /* dense index of each hardware id, -1 if not registered */
+
+    kilobot_id* ids_;
+    QPointF* positions_;
+    double* orientations_;
+    kilobot_led* leds_;
+    resource_mask* states_;
+    float* last_sent_;
+    uint32_t* last_seen_;
+    int8_t* exploiting_;
+    QPointF* safe_centres_;
+    double* safe_radii_;
+    PoseFilter* poses_;
+    uint8_t* quorum_;
+    int16_t* areas_;
+    double* utilities_;
+
+    KilobotRegistry(const KilobotRegistry&);
+    KilobotRegistry& operator=(const KilobotRegistry&);
+
+    /* move the fields to a new block for capacity kilobots */
+    void reserve(uint capacity);
+    /* place a field of per_kb entries per kb at offset in block, copying the entries of the kbs registered */
+    template<class T>
+    void relocate(T*& field, char* block, size_t& offset, uint capacity, uint per_kb);
+};
+
+#endif // KILOBOTREGISTRY_H
@@ -18,6 +18,7 @@
  * - red if committed to resource 1 (either working or not)
  * - green if committed to resource 2 (either working or not)
  * - blued if committed to resource 3 (either working or not)
+ * - yellow, magenta, cyan, orange and purple for the resources 4 to 8 (see resource_led)
  *
  * NOTE increase all ticks by a factor of 10 when dealing with real simulations
  *
@@ -34,14 +35,20 @@
 #endif
 #include "distribution_functions.c"
 #include "message_t_list.c"
+#include "resource_codec.c"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <limits.h>
 
-// define the resources to be expected in the current simulation
+// define the resources to be expected in the current simulation (must match the resources of ARK)
+#ifndef RESOURCES_SIZE
 #define RESOURCES_SIZE 3
+#endif
+#if RESOURCES_SIZE > MAX_RESOURCES
+#error "RESOURCES_SIZE must not exceed MAX_RESOURCES"
+#endif
 #ifndef M_PI
 #define M_PI 3.14159
 #endif
@@ -78,36 +85,30 @@ uint8_t rotating = 0; // variable used to cope with wall avoidance (arena border
 /* Smart Arena Variables                                             */
 /*-------------------------------------------------------------------*/
 
-/* enum for the robot states/position w.r.t. the smart arena */
-typedef enum {
-              OUTSIDE_AREA=255,
-              INSIDE_AREA_0=0,
-              INSIDE_AREA_1=1,
-              INSIDE_AREA_2=2,
-              INSIDE_AREA_01=3,
-              INSIDE_AREA_02=6,
-              INSIDE_AREA_12=7,
-              INSIDE_AREA_012=21,
-} arena_t;
-
 /* enum for keeping trace of internal kilobots decision related states */
+/* committed to resource r is r, in quorum for resource r is RESOURCES_SIZE+r */
 typedef enum {
               NOT_COMMITTED=255,
               COMMITTED_AREA_0=0,
               COMMITTED_AREA_1=1,
               COMMITTED_AREA_2=2,
-              QUORUM_AREA_0=3, // only if quorum sensing is enabled
-              QUORUM_AREA_1=4, // only if quorum sensing is enabled
-              QUORUM_AREA_2=5, // only if quorum sensing is enabled
+              QUORUM_AREA_0=RESOURCES_SIZE, // only if quorum sensing is enabled
+              QUORUM_AREA_1=RESOURCES_SIZE+1, // only if quorum sensing is enabled
+              QUORUM_AREA_2=RESOURCES_SIZE+2, // only if quorum sensing is enabled
 } decision_t;
 
 /* current state */
-arena_t current_arena_state = OUTSIDE_AREA;
+uint8_t current_arena_state = 0; // robot position w.r.t. the smart arena, bit r set if over an area of resource r
 decision_t current_decision_state = NOT_COMMITTED;
 
+/* led of the kilobots committed to each resource, same colours of the areas in ARK
+ * (the tracker of ARK only reports red, green and blue, the plugin runs up to three resources) */
+const uint8_t resource_led[MAX_RESOURCES] = {RGB(3,0,0), RGB(0,3,0), RGB(0,0,3), RGB(3,3,0),
+                                             RGB(3,0,3), RGB(0,3,3), RGB(3,1,0), RGB(1,0,3)};
+
 /* quorum sensing variables */
 float quorum_threshold = 0;
-uint8_t real_quorum[RESOURCES_SIZE]  = {255,255,255}; // keep this as > 127
+uint8_t real_quorum[RESOURCES_SIZE]; // keep this as > 127, set to 255 in setup
 
 /* variable to signal internal computation error */
 uint8_t internal_error = 0;
@@ -255,53 +256,30 @@ void parse_smart_arena_message(uint8_t data[9], uint8_t kb_position) {
   // index of first element in the data
   uint8_t shift = kb_position*3;
 
-  // get arena state by resource (at max 3 resources allowed in the simulation)
-  uint8_t ut_a = (data[0+shift] &0x01) << 4 | (data[1+shift] &0xF0) >> 4;
-  uint8_t ut_b = (data[1+shift] &0x0F) << 1 | (data[2+shift] &0x80) >> 7;
-  uint8_t ut_c = (data[2+shift] &0x7C) >> 2;
+  // get arena state and utilities by resource (see resource_codec.h for the layout)
+  uint32_t sensor = (uint32_t)data[0+shift] << 16 | (uint32_t)data[1+shift] << 8 | data[2+shift];
+  uint8_t id, over, rotation_slice;
+  uint8_t utilities[RESOURCES_SIZE];
+  sensor_unpack(sensor, RESOURCES_SIZE, &id, &over, utilities, &rotation_slice);
   /* if(kilo_uid == 0) { */
   /*   printf("data0 %d data1 %d data2 %d\n", data[0+shift], data[1+shift], data[2+shift]); */
-  /*   printf("ut_a %d ut_b %d ut_c %d\n", ut_a, ut_b, ut_c); */
+  /*   printf("over %d\n", over); */
   /*   fflush(stdout); */
   /* } */
 
-  if(ut_a+ut_b+ut_c == 0) {
-    // set this up if over no resource
-    current_arena_state = 255;
-  } else {
-    current_arena_state = 0;
-    if(ut_c) {
-      // either 0 (on a) or 2 (on c)
-      current_arena_state = 2;
-    }
-    if(ut_b) {
-      // either 0 (on a) or 1 (on b) or 7 (on b and c)
-      current_arena_state = current_arena_state*3+1;
-    }
-    if(ut_a) {
-      // either 0 (on a) 3 (on a and b) 6 (on a and c) 21 (on a and b and c)
-      current_arena_state = current_arena_state*3;
-    }
-  }
+  // 0 if over no resource
+  current_arena_state = over;
 
-  // store received utility
-  // 31 slices of means every 8
-  if(ut_a) {
-    uint8_t ut = ceil(ut_a*8.2258);
-    exponential_average(0, ut);
-  }
-  if(ut_b) {
-    uint8_t ut = ceil(ut_b*8.2258);
-    exponential_average(1, ut);
-  }
-  if(ut_c) {
-    uint8_t ut = ceil(ut_c*8.2258);
-    exponential_average(2, ut);
+  // store received utility (already scaled to 255)
+  uint8_t r;
+  for(r=0; r<RESOURCES_SIZE; r++) {
+    if(utilities[r]) {
+      exponential_average(r, utilities[r]);
+    }
   }
 
   // get rotation toward the center (if far from center)
   // avoid colliding with the wall
-  uint8_t rotation_slice = data[2+shift] &0x03;
   if(rotation_slice == 3) {
     rotation_to_center = -M_PI/2;
   } else {
@@ -355,14 +333,13 @@ void parse_interactive_message() {
 
   if(to_consider) {
     // check received message and merge info and ema
-    if(t_node->msg.data[3] > 0) {
-      exponential_average(0, t_node->msg.data[3]);
-    }
-    if(t_node->msg.data[4] > 0) {
-      exponential_average(1, t_node->msg.data[4]);
-    }
-    if(t_node->msg.data[5] > 0) {
-      exponential_average(2, t_node->msg.data[5]);
+    uint8_t pops[RESOURCES_SIZE];
+    shared_pops_unpack(t_node->msg.data, RESOURCES_SIZE, pops);
+    uint8_t r;
+    for(r=0; r<RESOURCES_SIZE; r++) {
+      if(pops[r] > 0) {
+        exponential_average(r, pops[r]);
+      }
     }
     // update umax
     umax = (uint8_t)round(((float)t_node->msg.data[8]*(ema_alpha)) + ((float)umax*(1.0-ema_alpha)));
@@ -385,6 +362,9 @@ void message_rx(message_t *msg, distance_measurement_t *d) {
     /* b(5) bits used for resource b utility           */
     /* c(5) bits used for resource c utility           */
     /* y(2) bits used for turing angle                 */
+    /* with more than 3 resources a b c are replaced   */
+    /* by the membership mask and shorter utilities    */
+    /* (see resource_codec.h)                          */
 
     /* How to interpret the data received?             */
     /* If no resource a,b,c utility is received then   */
@@ -425,11 +405,15 @@ void message_rx(message_t *msg, distance_measurement_t *d) {
     // set that is the first time that we received the signal to rebroadcast
     first_time_after_release = 1;
   } else if(msg->type == 3 && release_the_broadcast) { // only used within ARK
-    // check if ARK is communicating the quorum and store it
-    if(msg->data[0]>0 && msg->data[1]>0 && msg->data[2]>0) {
-      real_quorum[0] = msg->data[0];
-      real_quorum[1] = msg->data[1];
-      real_quorum[2] = msg->data[2];
+    // check if ARK is communicating the quorum and store it (data[r] for resource r)
+    uint8_t r, quorum = 1;
+    for(r=0; r<RESOURCES_SIZE; r++) {
+      quorum = quorum && msg->data[r]>0;
+    }
+    if(quorum) {
+      for(r=0; r<RESOURCES_SIZE; r++) {
+        real_quorum[r] = msg->data[r];
+      }
     }
     // update variables to restore the kilobot at its previous state
     last_motion_ticks = last_motion_ticks + kilo_ticks - last_release_time;
@@ -534,9 +518,9 @@ void take_decision() {
     if(recruiter_state != NOT_COMMITTED) {
       /* get the correct index in case of quorum sensing mechanism */
       resource_index = recruiter_state;
-      if(quorum_threshold > 0 && resource_index >= 3) {
-        // reduce by 3 to avoid overflow in the array if in quorum state
-        resource_index = resource_index-3;
+      if(quorum_threshold > 0 && resource_index >= RESOURCES_SIZE) {
+        // reduce by RESOURCES_SIZE to avoid overflow in the array if in quorum state
+        resource_index = resource_index-RESOURCES_SIZE;
       }
       // if over umin threshold
       if(resources_pops[resource_index] > umin) {
@@ -572,8 +556,8 @@ void take_decision() {
     if(extraction < commitment) {
       current_decision_state = random_resource;
       if(quorum_threshold > 0) {
-        // increment by 3 to set it to quorum
-        current_decision_state = current_decision_state + 3;
+        // increment by RESOURCES_SIZE to set it to quorum
+        current_decision_state = current_decision_state + RESOURCES_SIZE;
       }
       return;
     }
@@ -583,9 +567,9 @@ void take_decision() {
     // if the extracted number is less than recruitment, then recruited
     if(extraction < recruitment) {
       current_decision_state = recruiter_state;
-      if(quorum_threshold > 0 && recruiter_state < 3) {
-        // increment by 3 to set it to quorum
-        current_decision_state = current_decision_state + 3;
+      if(quorum_threshold > 0 && recruiter_state < RESOURCES_SIZE) {
+        // increment by RESOURCES_SIZE to set it to quorum
+        current_decision_state = current_decision_state + RESOURCES_SIZE;
       }
       return;
     }
@@ -598,9 +582,9 @@ void take_decision() {
 
     /* get the correct index in case of quorum sensing mechanism */
     resource_index = current_decision_state;
-    if(quorum_threshold > 0 && resource_index >= 3) {
-      // reduce by 3 to avoid overflow in the array if in quorum state
-      resource_index = resource_index-3;
+    if(quorum_threshold > 0 && resource_index >= RESOURCES_SIZE) {
+      // reduce by RESOURCES_SIZE to avoid overflow in the array if in quorum state
+      resource_index = resource_index-RESOURCES_SIZE;
     }
 
     /* leave immediately if reached the threshold */
@@ -633,13 +617,13 @@ void take_decision() {
     // if the inhibitor is committed or in quorum but not same as us
     if(inhibitor_state != NOT_COMMITTED &&
        current_decision_state != inhibitor_state &&
-       current_decision_state != inhibitor_state+3 &&
-       current_decision_state != inhibitor_state-3) {
+       current_decision_state != inhibitor_state+RESOURCES_SIZE &&
+       current_decision_state != inhibitor_state-RESOURCES_SIZE) {
       /* get the correct index in case of quorum sensing mechanism */
       resource_index = inhibitor_state;
-      if(quorum_threshold > 0 && resource_index >= 3) {
-        // reduce by 3 to avoid overflow in the array if in quorum state
-        resource_index = resource_index-3;
+      if(quorum_threshold > 0 && resource_index >= RESOURCES_SIZE) {
+        // reduce by RESOURCES_SIZE to avoid overflow in the array if in quorum state
+        resource_index = resource_index-RESOURCES_SIZE;
       }
       // if above umin threshold
       if(resources_pops[resource_index] > umin) {
@@ -780,7 +764,7 @@ void setup() {
 void quorum_sensing() {
   /* check quorum every step if in quorum state */
   if(quorum_threshold > 0 &&
-     current_decision_state > 2 &&
+     current_decision_state >= RESOURCES_SIZE &&
      current_decision_state != NOT_COMMITTED) {
 
     uint8_t neighbors = 0; // the total number of agents sensed
@@ -791,9 +775,15 @@ void quorum_sensing() {
     * and perceived quorum (i.e., as perceived by the kilobots)
     * If any of the value in the array is 255, then the latter is implemented
     */
-    if(real_quorum[0]<255 && real_quorum[1]<255 && real_quorum[2]<255) { 
-      neighbors = real_quorum[0] + real_quorum[1] + real_quorum[2];
-      friends = real_quorum[current_decision_state-3];
+    uint8_t r, real = 1;
+    for(r=0; r<RESOURCES_SIZE; r++) {
+      real = real && real_quorum[r]<255;
+    }
+    if(real) {
+      for(r=0; r<RESOURCES_SIZE; r++) {
+        neighbors = neighbors + real_quorum[r];
+      }
+      friends = real_quorum[current_decision_state-RESOURCES_SIZE];
     } else {
       // avoid considering same neighbor
       char parsed[255] = {0};
@@ -806,8 +796,8 @@ void quorum_sensing() {
           // if committed or quorum to same resource then we have a friend
           // the following works because 255 for current_decision_state is not an option
           if(temp->msg.data[1] == current_decision_state ||
-            temp->msg.data[1]-3 == current_decision_state ||
-            temp->msg.data[1]+3 == current_decision_state) {
+            temp->msg.data[1]-RESOURCES_SIZE == current_decision_state ||
+            temp->msg.data[1]+RESOURCES_SIZE == current_decision_state) {
             friends++;
           }
           // increment the number of neighbors
@@ -822,7 +812,7 @@ void quorum_sensing() {
     
     // compute quorum and eventually switch to committed
     if(neighbors > 0 && ((float)neighbors*quorum_threshold) <= friends) {
-      current_decision_state = current_decision_state-3;
+      current_decision_state = current_decision_state-RESOURCES_SIZE;
     }
   }
 }
@@ -832,33 +822,22 @@ void update_led_status() {
 #ifdef ARGOS_simulator_BUILD
   // in ARGoS a white led is used to signal quorum state
   // in ARK, due to perceptions errors, this is avoided
-  if(current_decision_state == QUORUM_AREA_0 ||
-      current_decision_state == QUORUM_AREA_1 ||
-      current_decision_state == QUORUM_AREA_2) {
+  if(current_decision_state >= QUORUM_AREA_0 &&
+      current_decision_state != NOT_COMMITTED) {
     // white for quorum
     set_color(RGB(3,3,3));
   }
 #else
   if(release_the_broadcast) {
     // turn on leds for real quorum and debug
-    if(current_decision_state==0 || current_decision_state==3) 
-      set_color(RGB(3,0,0));
-    else if(current_decision_state==1 || current_decision_state==4) 
-      set_color(RGB(0,3,0));
-    else if(current_decision_state==2 || current_decision_state==5) 
-      set_color(RGB(0,0,3));
+    if(current_decision_state != NOT_COMMITTED)
+      set_color(resource_led[current_decision_state%RESOURCES_SIZE]);
   }
 #endif
   // if over the wanted resource turn on the right led color
-  else if(current_decision_state == COMMITTED_AREA_0) {
-    // area 0 is red
-    set_color(RGB(3,0,0));
-  } else if(current_decision_state == COMMITTED_AREA_1) {
-    // area 1 is green
-    set_color(RGB(0,3,0));
-  } else if(current_decision_state == COMMITTED_AREA_2) {
-    // area 2 is blue
-    set_color(RGB(0,0,3));
+  else if(current_decision_state < RESOURCES_SIZE) {
+    // area 0 is red, 1 green, 2 blue (see resource_led)
+    set_color(resource_led[current_decision_state]);
   } else {
     // simply continue as uncommitted and explore
     set_color(RGB(0,0,0));
@@ -883,11 +862,8 @@ void send_own_state() {
     // fill up the current states
     interactive_message.data[1] = current_decision_state;
     interactive_message.data[2] = current_arena_state;
-    // share my resource pop for all resources
-    uint8_t res_index;
-    for(res_index=0; res_index<RESOURCES_SIZE; res_index++) {
-      interactive_message.data[3+res_index] = resources_pops[res_index];
-    }
+    // share my resource pop for all resources (data[3..7], see resource_codec.h)
+    shared_pops_pack(interactive_message.data, RESOURCES_SIZE, resources_pops);
 
     // last byte used for umax
     interactive_message.data[8] = umax;
@@ -939,11 +915,13 @@ void get_message_for_rebroadcast() {
 
 void update_umax(decision_t temp_decision) {
   // if I am working and was not on same area before
-  if(current_decision_state < 3 && current_decision_state != temp_decision) {
+  if(current_decision_state < RESOURCES_SIZE && current_decision_state != temp_decision) {
     // take the maximum population
     uint8_t t_max = resources_pops[0];
-    if(t_max < resources_pops[1]) t_max = resources_pops[1];
-    if(t_max < resources_pops[2]) t_max = resources_pops[2];
+    uint8_t r;
+    for(r=1; r<RESOURCES_SIZE; r++) {
+      if(t_max < resources_pops[r]) t_max = resources_pops[r];
+    }
 
     // update umax
     umax = round(t_max*ema_alpha + umax*(1.0-ema_alpha));
@@ -3,12 +3,14 @@
 
 #include <stdbool.h>
 
+#include "resource_codec.h"
+
 #ifdef __cplusplus /* If this is a C++ compiler, use C linkage */
 extern "C" {
 #endif
 
   /* struct for kilobot state */
-  typedef struct { bool resources[3]; } m_kilobotstate;
+  typedef struct { bool resources[MAX_RESOURCES]; } m_kilobotstate;
 
 #ifdef ARGOS_simulator_BUILD
 
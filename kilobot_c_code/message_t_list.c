@@ -9,7 +9,6 @@ void mtl_push_back(node_t *head, node_t* new_node) {
     current = current->next;
   }
 
-  current->next = malloc(sizeof(node_t));
   current->next = new_node;
   current->next->next = NULL;
 }
@@ -0,0 +1,134 @@
+/* see resource_codec.h */
+#include "resource_codec.h"
+
+#include <math.h>
+
+uint8_t sensor_utility_bits(uint8_t resources, uint8_t over) {
+  // original layout, one field per resource
+  if(resources <= 3) {
+    return SENSOR_UTILITY_BITS;
+  }
+  if(over == 0) {
+    return 0;
+  }
+  uint8_t bits = (SENSOR_PAYLOAD_BITS-resources)/over;
+  return bits > SENSOR_UTILITY_BITS ? SENSOR_UTILITY_BITS : bits;
+}
+
+/* number of resources in the mask */
+static uint8_t resources_in(uint8_t over) {
+  uint8_t count = 0;
+  for(; over; over >>= 1) {
+    count += over & 1;
+  }
+  return count;
+}
+
+/* utility in [0, 1] on bits bits, at least 1 (0 means not over) */
+static uint16_t quantize_utility(double utility, uint8_t bits) {
+  uint16_t max = (1 << bits)-1;
+  double q = ceil(utility*max);
+  if(q < 1) {
+    return 1;
+  }
+  return q > max ? max : (uint16_t)q;
+}
+
+uint32_t sensor_pack(uint8_t id, uint8_t resources, uint8_t over, const double* utilities, uint8_t turning) {
+  uint16_t payload = 0;
+  uint8_t r;
+  if(resources <= 3) {
+    for(r=0; r<resources; r++) {
+      if(over & (1 << r)) {
+        payload |= quantize_utility(utilities[r], SENSOR_UTILITY_BITS) << (SENSOR_PAYLOAD_BITS-SENSOR_UTILITY_BITS*(r+1));
+      }
+    }
+  } else {
+    uint8_t bits = sensor_utility_bits(resources, resources_in(over));
+    uint8_t position = SENSOR_PAYLOAD_BITS-resources;
+    for(r=0; r<resources; r++) {
+      if(over & (1 << r)) {
+        payload |= 1 << (SENSOR_PAYLOAD_BITS-1-r);
+        if(bits) {
+          position -= bits;
+          payload |= quantize_utility(utilities[r], bits) << position;
+        }
+      }
+    }
+  }
+  return ((uint32_t)(id & 0x7F) << 17) | ((uint32_t)payload << 2) | (turning & 0x03);
+}
+
+void sensor_unpack(uint32_t message, uint8_t resources, uint8_t* id, uint8_t* over, uint8_t* utilities, uint8_t* turning) {
+  uint16_t payload = (message >> 2) & 0x7FFF;
+  uint8_t r;
+  *id = (message >> 17) & 0x7F;
+  *turning = message & 0x03;
+  *over = 0;
+  if(resources <= 3) {
+    for(r=0; r<resources; r++) {
+      uint16_t q = (payload >> (SENSOR_PAYLOAD_BITS-SENSOR_UTILITY_BITS*(r+1))) & 0x1F;
+      // same rounding as the original ceil(q*8.2258)
+      utilities[r] = (q*255+30)/31;
+      if(q) {
+        *over |= 1 << r;
+      }
+    }
+  } else {
+    for(r=0; r<resources; r++) {
+      if(payload & (1 << (SENSOR_PAYLOAD_BITS-1-r))) {
+        *over |= 1 << r;
+      }
+    }
+    uint8_t bits = sensor_utility_bits(resources, resources_in(*over));
+    uint16_t max = (1 << bits)-1;
+    uint8_t position = SENSOR_PAYLOAD_BITS-resources;
+    for(r=0; r<resources; r++) {
+      utilities[r] = 0;
+      if((*over & (1 << r)) && bits) {
+        position -= bits;
+        utilities[r] = (((payload >> position) & max)*255+max-1)/max;
+      }
+    }
+  }
+}
+
+uint8_t shared_pops_bits(uint8_t resources) {
+  if(resources <= SHARED_POPS_BITS/8) {
+    return 8;
+  }
+  return SHARED_POPS_BITS/resources;
+}
+
+void shared_pops_pack(uint8_t* data, uint8_t resources, const uint8_t* pops) {
+  uint8_t bits = shared_pops_bits(resources);
+  uint16_t max = (1 << bits)-1;
+  uint8_t r, b;
+  for(b=0; b<SHARED_POPS_BITS/8; b++) {
+    data[3+b] = 0;
+  }
+  for(r=0; r<resources; r++) {
+    uint16_t q = bits == 8 ? pops[r] : ((uint16_t)pops[r]*max+127)/255;
+    // most significant bit first, from bit r*bits of data[3..7]
+    for(b=0; b<bits; b++) {
+      if(q & (1 << (bits-1-b))) {
+        uint8_t bit = r*bits+b;
+        data[3+bit/8] |= 0x80 >> (bit%8);
+      }
+    }
+  }
+}
+
+void shared_pops_unpack(const uint8_t* data, uint8_t resources, uint8_t* pops) {
+  uint8_t bits = shared_pops_bits(resources);
+  uint16_t max = (1 << bits)-1;
+  uint8_t r, b;
+  for(r=0; r<resources; r++) {
+    uint16_t q = 0;
+    for(b=0; b<bits; b++) {
+      uint8_t bit = r*bits+b;
+      q = (q << 1) | ((data[3+bit/8] >> (7-bit%8)) & 1);
+    }
+    pops[r] = bits == 8 ? q : (q*255+max/2)/max;
+  }
+}
@@ -0,0 +1,61 @@
+/*
+ * Encoding of the resources in the messages, shared by the controller (complexity.c) and
+ * the ARK plugin (complexityEnvironment.cpp).
+ *
+ * Sensor message, 24 bits sent by ARK to each kilobot (most significant bit first):
+ * - up to 3 resources (original layout):  id(7) u0(5) u1(5) u2(5) turning(2)
+ *   a 0 utility means that the kilobot is not over an area of the resource
+ * - more resources:                       id(7) mask(N) utilities padding turning(2)
+ *   bit r of the mask (most significant first) is set if the kilobot is over an area of
+ *   resource r, the utilities of the resources in the mask follow in order with
+ *   sensor_utility_bits(N, resources in the mask) bits each (0 bits: only the membership)
+ *
+ * Interactive message between kilobots: the estimated populations of the resources are in
+ * data[3..7] (40 bits), shared_pops_bits(N) bits each (8 up to 5 resources, as the original).
+ */
+
+#ifndef RESOURCE_CODEC_H
+#define RESOURCE_CODEC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus /* If this is a C++ compiler, use C linkage */
+extern "C" {
+#endif
+
+/* the membership of a kilobot is one bit per resource */
+#define MAX_RESOURCES 8
+/* bits of the payload of the sensor message (24 - 7 id - 2 turning) */
+#define SENSOR_PAYLOAD_BITS 15
+/* maximum bits of a utility in the sensor message */
+#define SENSOR_UTILITY_BITS 5
+/* bits of data[3..7] in the interactive message */
+#define SHARED_POPS_BITS 40
+
+  /* bits of each utility in the sensor message, over is the number of resources in the mask */
+  uint8_t sensor_utility_bits(uint8_t resources, uint8_t over);
+
+  /*
+   * pack the sensor message (24 bits), utilities[r] in [0, 1] is only read for the resources in
+   * the mask (bit r of over set if over an area of resource r)
+   */
+  uint32_t sensor_pack(uint8_t id, uint8_t resources, uint8_t over, const double* utilities, uint8_t turning);
+
+  /*
+   * unpack the sensor message, utilities[r] is the utility scaled to 255 (0 if not over the
+   * resource or not sent)
+   */
+  void sensor_unpack(uint32_t message, uint8_t resources, uint8_t* id, uint8_t* over, uint8_t* utilities, uint8_t* turning);
+
+  /* bits of each population in the interactive message */
+  uint8_t shared_pops_bits(uint8_t resources);
+
+  /* write / read the populations (0..255) in data[3..7] of the interactive message */
+  void shared_pops_pack(uint8_t* data, uint8_t resources, const uint8_t* pops);
+  void shared_pops_unpack(const uint8_t* data, uint8_t resources, uint8_t* pops);
+
+#ifdef __cplusplus /* If this is a C++ compiler, use C linkage */
+}
+#endif
+
+#endif /* RESOURCE_CODEC_H */
@@ -0,0 +1,266 @@
+#ifndef KINEMATICS_CPP
+#define KINEMATICS_CPP
+
+#include "kinematics.h"
+
+#include <math.h>
+#include <algorithm>
+
+KilobotKinematics::KilobotKinematics(uint32_t robots, double robot_radius, double linear_speed, double angular_speed, unsigned int seed,
+                                     double arena_center_x, double arena_center_y, double arena_radius) :
+    robot_radius(robot_radius), linear_speed(linear_speed), angular_speed(angular_speed),
+    arena_center_x(arena_center_x), arena_center_y(arena_center_y), arena_radius(arena_radius) {
+    this->std_motion_steps = 10*31;
+    this->max_turning_ticks = 80;
+
+    x.assign(robots, arena_center_x);
+    y.assign(robots, arena_center_y);
+    hx.assign(robots, 1);
+    hy.assign(robots, 0);
+    vx.assign(robots, 0);
+    vy.assign(robots, 0);
+    px.assign(robots, arena_center_x);
+    py.assign(robots, arena_center_y);
+    cx.assign(robots, 0);
+    cy.assign(robots, 0);
+    motion.assign(robots, STOP);
+    motion_ticks.assign(robots, 0);
+    frozen.assign(robots, 0);
+
+    // cell list covering the whole arena, one cell is a robot diameter
+    this->cell_size = 2*robot_radius;
+    this->grid_origin_x = arena_center_x-arena_radius;
+    this->grid_origin_y = arena_center_y-arena_radius;
+    this->grid_width = (uint32_t)ceil(2*arena_radius/cell_size)+1;
+    this->grid_height = this->grid_width;
+    // padded to allow ranges past the last cell
+    cell_start.resize(grid_width*grid_height+grid_width+3);
+
+    re.seed(seed);
+    robot_re.resize(robots);
+    for(uint32_t i=0; i<robots; i++) {
+        robot_re[i].seed(seed*2654435761u+i+1);
+    }
+}
+
+void KilobotKinematics::setPose(uint32_t robot, double px, double py, double theta) {
+    this->x[robot] = px;
+    this->y[robot] = py;
+    this->px[robot] = px;
+    this->py[robot] = py;
+    this->hx[robot] = cos(theta);
+    this->hy[robot] = sin(theta);
+    this->vx[robot] = 0;
+    this->vy[robot] = 0;
+}
+
+void KilobotKinematics::scatter() {
+    std::uniform_real_distribution<double> urd(-1, 1);
+    std::uniform_real_distribution<double> angle(-M_PI, M_PI);
+    double free_radius = arena_radius-robot_radius;
+    for(uint32_t i=0; i<size(); i++) {
+        double rx = 0, ry = 0;
+        // rejection sampling inside the circle
+        do {
+            rx = urd(re);
+            ry = urd(re);
+        } while(rx*rx+ry*ry > 1);
+        setPose(i, arena_center_x+rx*free_radius, arena_center_y+ry*free_radius, angle(re));
+    }
+    // separate the robots that have been placed over each other
+    for(uint8_t iteration=0; iteration<10; iteration++) {
+        resolveCollisions();
+        constrainToArena(0, size());
+    }
+    for(uint32_t i=0; i<size(); i++) {
+        this->px[i] = x[i];
+        this->py[i] = y[i];
+    }
+}
+
+void KilobotKinematics::step() {
+    randomWalk(0, size());
+    integrate(0, size());
+    resolveCollisions();
+    constrainToArena(0, size());
+}
+
+void KilobotKinematics::randomWalk(uint32_t from, uint32_t to) {
+    // same as random_walk() in complexity.c: levy (gaussian with alpha=2) straight motion
+    // followed by a turn of a uniform random angle in [0, pi] on a random side
+    // (distributions are local to a robot draw, normal_distribution caches values between calls)
+    for(uint32_t i=from; i<to; i++) {
+        if(frozen[i]) {
+            continue;
+        }
+        if(motion_ticks[i] > 0) {
+            motion_ticks[i]--;
+            continue;
+        }
+        if(motion[i] == FORWARD) {
+            std::uniform_real_distribution<double> turn(0, M_PI);
+            motion[i] = (robot_re[i]() % 2) ? TURN_LEFT : TURN_RIGHT;
+            motion_ticks[i] = (uint32_t)((turn(robot_re[i])/M_PI)*max_turning_ticks);
+        } else {
+            std::normal_distribution<double> straight(0, sqrt(2)*std_motion_steps);
+            motion[i] = FORWARD;
+            motion_ticks[i] = (uint32_t)fabs(straight(robot_re[i]));
+        }
+    }
+}
+
+void KilobotKinematics::integrate(uint32_t from, uint32_t to) {
+    const float v = linear_speed;
+    const float c = cos(angular_speed);
+    const float s = sin(angular_speed);
+
+    float* __restrict__ rx = x.data();
+    float* __restrict__ ry = y.data();
+    float* __restrict__ rhx = hx.data();
+    float* __restrict__ rhy = hy.data();
+    float* __restrict__ rpx = px.data();
+    float* __restrict__ rpy = py.data();
+    const uint8_t* __restrict__ rmotion = motion.data();
+    const uint8_t* __restrict__ rfrozen = frozen.data();
+
+    // branch free so that the loop gets vectorized
+#pragma omp simd
+    for(uint32_t i=from; i<to; i++) {
+        float moving = rfrozen[i] ? 0.0f : 1.0f;
+        float forward = (rmotion[i] == FORWARD) ? moving : 0.0f;
+        // +1 turn left (counter clockwise), -1 turn right, 0 otherwise
+        float side = (rmotion[i] == TURN_LEFT) ? moving : ((rmotion[i] == TURN_RIGHT) ? -moving : 0.0f);
+        float turning = side*side;
+        // rotate the heading by +-angular_speed
+        float rs = side*s;
+        float rc = 1.0f+turning*(c-1.0f);
+        float nhx = rhx[i]*rc - rhy[i]*rs;
+        float nhy = rhx[i]*rs + rhy[i]*rc;
+        rhx[i] = nhx;
+        rhy[i] = nhy;
+        rpx[i] = rx[i];
+        rpy[i] = ry[i];
+        rx[i] += forward*v*nhx;
+        ry[i] += forward*v*nhy;
+    }
+
+    // repeated rotations slowly denormalize the heading
+#pragma omp simd
+    for(uint32_t i=from; i<to; i++) {
+        float inv = 1.0f/sqrtf(rhx[i]*rhx[i]+rhy[i]*rhy[i]);
+        rhx[i] *= inv;
+        rhy[i] *= inv;
+    }
+}
+
+void KilobotKinematics::buildCells() {
+    uint32_t robots = size();
+    robot_cell.resize(robots);
+    cell_robots.resize(robots);
+    std::fill(cell_start.begin(), cell_start.end(), 0);
+    for(uint32_t i=0; i<robots; i++) {
+        int32_t gx = (int32_t)((x[i]-grid_origin_x)/cell_size);
+        int32_t gy = (int32_t)((y[i]-grid_origin_y)/cell_size);
+        gx = std::min(std::max(gx, 0), (int32_t)grid_width-1);
+        gy = std::min(std::max(gy, 0), (int32_t)grid_height-1);
+        robot_cell[i] = gy*grid_width+gx;
+        cell_start[robot_cell[i]+1]++;
+    }
+    for(uint32_t c=0; c+1<cell_start.size(); c++) {
+        cell_start[c+1] += cell_start[c];
+    }
+    cell_fill.assign(cell_start.begin(), cell_start.end()-1);
+    for(uint32_t i=0; i<robots; i++) {
+        cell_robots[cell_fill[robot_cell[i]]++] = i;
+    }
+}
+
+inline void KilobotKinematics::pushApart(uint32_t a, uint32_t b) {
+    float dx = sx[b]-sx[a];
+    float dy = sy[b]-sy[a];
+    float d2 = dx*dx+dy*dy;
+    float min_d = 2*robot_radius;
+    if(d2 >= min_d*min_d) {
+        return;
+    }
+    float d = sqrtf(d2);
+    if(d < 1e-6f) {
+        // exactly on top of each other, separate along x
+        dx = 1;
+        dy = 0;
+        d = 1;
+    }
+    // each robot moves half of the overlap
+    float push = 0.5f*(min_d-d)/d;
+    cx[a] -= dx*push;
+    cy[a] -= dy*push;
+    cx[b] += dx*push;
+    cy[b] += dy*push;
+}
+
+void KilobotKinematics::resolveCollisions() {
+    buildCells();
+
+    // work on positions sorted by cell, neighbours are then close in memory
+    uint32_t robots = size();
+    sx.resize(robots);
+    sy.resize(robots);
+    for(uint32_t a=0; a<robots; a++) {
+        sx[a] = x[cell_robots[a]];
+        sy[a] = y[cell_robots[a]];
+    }
+    std::fill(cx.begin(), cx.end(), 0);
+    std::fill(cy.begin(), cy.end(), 0);
+
+    // half stencil: each pair of neighbouring cells is visited once
+    // cells are sorted row by row, the current and right cell as well as the three cells
+    // of the next row are then contiguous ranges of robots
+    // (at the border of a row the range wraps to a far away cell and the distance check fails)
+    for(uint32_t a=0; a<robots; a++) {
+        uint32_t c = robot_cell[cell_robots[a]];
+        // pairs in the same cell and in the right one
+        for(uint32_t b=a+1; b<cell_start[c+2]; b++) {
+            pushApart(a, b);
+        }
+        // pairs with the cells in the next row
+        if(c/grid_width+1 < grid_height) {
+            for(uint32_t b=cell_start[c+grid_width-1]; b<cell_start[c+grid_width+2]; b++) {
+                pushApart(a, b);
+            }
+        }
+    }
+
+    // apply all displacements at once (order independent)
+    for(uint32_t a=0; a<robots; a++) {
+        x[cell_robots[a]] += cx[a];
+        y[cell_robots[a]] += cy[a];
+    }
+}
+
+void KilobotKinematics::constrainToArena(uint32_t from, uint32_t to) {
+    const float ox = arena_center_x;
+    const float oy = arena_center_y;
+    const float free_radius = arena_radius-robot_radius;
+
+    float* __restrict__ rx = x.data();
+    float* __restrict__ ry = y.data();
+    float* __restrict__ rvx = vx.data();
+    float* __restrict__ rvy = vy.data();
+    const float* __restrict__ rpx = px.data();
+    const float* __restrict__ rpy = py.data();
+
+#pragma omp simd
+    for(uint32_t i=from; i<to; i++) {
+        float dx = rx[i]-ox;
+        float dy = ry[i]-oy;
+        float d = sqrtf(dx*dx+dy*dy);
+        // project back on the wall if outside, scale is 1 if inside
+        float scale = (d > free_radius) ? free_radius/d : 1.0f;
+        rx[i] = ox+dx*scale;
+        ry[i] = oy+dy*scale;
+        rvx[i] = rx[i]-rpx[i];
+        rvy[i] = ry[i]-rpy[i];
+    }
+}
+
+#endif // KINEMATICS_CPP
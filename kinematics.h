@@ -0,0 +1,112 @@
+/**
+ * Headless kinematics of a swarm of kilobots, used to simulate the random walk of
+ * kilobot_c_code/complexity.c at scale.
+ *
+ * The robot state is stored as structure of arrays so that the integration loops run over
+ * contiguous floats and are vectorized by the compiler (see QMAKE_CXXFLAGS in Experiment1.pro).
+ * The heading is kept as a unit vector and rotated by a constant matrix while turning,
+ * this way no trigonometric function is evaluated per robot per tick.
+ *
+ * Each tick:
+ * - the random walk state machine (as random_walk in complexity.c) selects the motion of each robot
+ * - poses are advanced forward at linear_speed or rotated at angular_speed (pi/5 rad/s on the kilobot)
+ * - overlapping robots are pushed apart, neighbours are found through a cell list of robot diameter cells
+ * - robots are kept inside the circular arena (ARENA_CENTER, ARENA_SIZE of experimentConfig.h)
+ *
+ * Positions and velocities (displacement over the last tick) are in the same form
+ * used by mykilobotenvironment::updateVirtualSensor (pixels of the tracking image).
+ */
+
+#ifndef KINEMATICS_H
+#define KINEMATICS_H
+
+#include <stdint.h>
+#include <vector>
+#include <random>
+
+#include <QPointF>
+
+#include "experimentConfig.h"
+
+class KilobotKinematics {
+public:
+    /* motion types, same as motion_t in complexity.c */
+    typedef enum {
+        FORWARD = 0,
+        TURN_LEFT = 1,
+        TURN_RIGHT = 2,
+        STOP = 3,
+    } motion_t;
+
+    /************************************/
+    /* robot state (structure of arrays)*/
+    /************************************/
+    std::vector<float> x, y;    /* position */
+    std::vector<float> hx, hy;  /* heading as unit vector */
+    std::vector<float> vx, vy;  /* displacement during last tick */
+    std::vector<uint8_t> motion; /* current motion_t */
+    std::vector<uint32_t> motion_ticks; /* ticks left in the current motion */
+    std::vector<uint8_t> frozen; /* if not 0 the robot stands still (e.g. during communication time) */
+
+    /************************************/
+    /* parameters                       */
+    /************************************/
+    double robot_radius;    /* kilobot radius in pixels */
+    double linear_speed;    /* forward speed in pixels per tick */
+    double angular_speed;   /* turning speed in radians per tick */
+    double arena_center_x, arena_center_y, arena_radius;
+
+    /* random walk, same values of complexity.c */
+    double std_motion_steps;    /* sigma of the levy (gaussian) distribution for the forward motion in ticks */
+    uint32_t max_turning_ticks; /* ticks needed to turn of pi */
+
+    /* constructor */
+    KilobotKinematics(uint32_t robots, double robot_radius, double linear_speed, double angular_speed, unsigned int seed=0,
+                      double arena_center_x=ARENA_CENTER, double arena_center_y=ARENA_CENTER, double arena_radius=ARENA_SIZE);
+
+    uint32_t size() const {return (uint32_t)x.size();}
+
+    /* place the robots uniformly at random inside the arena, without overlaps when possible */
+    void scatter();
+
+    /* place a robot */
+    void setPose(uint32_t robot, double px, double py, double theta);
+
+    /* simulate one tick: random walk, integration, robot-robot and wall collisions */
+    void step();
+
+    /* split of step, exposed for tile based stepping */
+    void randomWalk(uint32_t from, uint32_t to);
+    void integrate(uint32_t from, uint32_t to);
+    void resolveCollisions();
+    void constrainToArena(uint32_t from, uint32_t to);
+
+    /* as used by updateVirtualSensor */
+    QPointF getPosition(uint32_t robot) const {return QPointF(x[robot], y[robot]);}
+    QPointF getVelocity(uint32_t robot) const {return QPointF(vx[robot], vy[robot]);}
+
+protected:
+    std::default_random_engine re;  /* used to scatter the robots */
+    std::vector<std::minstd_rand> robot_re; /* one stream per robot, independent of the stepping order */
+
+    /* previous position used to compute velocities */
+    std::vector<float> px, py;
+
+    /* positions sorted by cell and collision displacements accumulated before being applied */
+    std::vector<float> sx, sy;
+    std::vector<float> cx, cy;
+
+    /* cell list */
+    float cell_size;
+    float grid_origin_x, grid_origin_y;
+    uint32_t grid_width, grid_height;
+    std::vector<uint32_t> cell_start;
+    std::vector<uint32_t> cell_robots;
+    std::vector<uint32_t> robot_cell;
+    std::vector<uint32_t> cell_fill;
+
+    void buildCells();
+    void pushApart(uint32_t a, uint32_t b);
+};
+
+#endif // KINEMATICS_H
@@ -0,0 +1,50 @@
+#ifndef LATENCYPREDICTOR_CPP
+#define LATENCYPREDICTOR_CPP
+
+#include "latencyPredictor.h"
+
+#include <algorithm>
+
+LatencyPredictor::LatencyPredictor() {
+    reset();
+}
+
+void LatencyPredictor::reset() {
+    clock.start();
+    received.assign(KILOBOT_MAX_ID, -1);
+    frame_period = 0;
+    pipeline_delay = 0;
+    sensing_age = 0;
+}
+
+void LatencyPredictor::sensed(kilobot_id id) {
+    if(id >= received.size()) {
+        return;
+    }
+    int64_t now = std::max<int64_t>(clock.nsecsElapsed()-sensing_age, 0);
+    if(received[id] >= 0) {
+        double period = (now-received[id])*1e-9;
+        if(period > 0 && period < MAX_FRAME_PERIOD) {
+            // the first measurement is taken as is
+            frame_period = frame_period > 0 ? frame_period+LATENCY_SMOOTHING*(period-frame_period) : period;
+        }
+    }
+    received[id] = now;
+}
+
+void LatencyPredictor::sent(kilobot_id id) {
+    if(id >= received.size() || received[id] < 0) {
+        return;
+    }
+    double delay = (clock.nsecsElapsed()-received[id])*1e-9;
+    pipeline_delay += LATENCY_SMOOTHING*(delay-pipeline_delay);
+}
+
+double LatencyPredictor::horizon(double delivery_latency) const {
+    if(frame_period <= 0) {
+        return 0;
+    }
+    return (pipeline_delay+delivery_latency)/frame_period;
+}
+
+#endif // LATENCYPREDICTOR_CPP
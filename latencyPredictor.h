@@ -0,0 +1,61 @@
+/**
+ * Time between the tracking of a kilobot and the kilobot acting on its virtual sensor message.
+ *
+ * A message is built from a position that is already old when the kb reads it: the sensor update
+ * waits in the queued signals and, with parallel sensing, until the next update of the
+ * environment, then the message waits in the overhead controller and takes an IR frame. A fast kb
+ * can hence be told that it is over an area it has already left.
+ *
+ * The predictor measures on the wall clock the period of the tracking frames (between two sensor
+ * updates of the same kb) and the delay from a sensor update to the emission of the message, both
+ * smoothed over the swarm. Adding the delivery latency after the emission (configured, it cannot
+ * be observed from here) gives the horizon: the tracking frames between the position and the
+ * delivery, by which the environment extrapolates the velocity filtered from the tracking (see
+ * PoseFilter and mykilobotenvironment::classifyKilobot). The number of messages is not changed.
+ */
+
+#ifndef LATENCYPREDICTOR_H
+#define LATENCYPREDICTOR_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <QElapsedTimer>
+
+#include "kilobot.h"
+
+// weight of a new measurement in the smoothed frame period and delay
+#define LATENCY_SMOOTHING 0.05
+// gaps between two sensor updates of a kb longer than this (seconds) are not frame periods
+#define MAX_FRAME_PERIOD 1.0
+
+class LatencyPredictor {
+public:
+    LatencyPredictor();
+
+    /* forget the measurements */
+    void reset();
+
+    /* a sensor update of the kb reached the environment */
+    void sensed(kilobot_id id);
+    /* the next sensor updates were tracked seconds before reaching the environment (see TrackingHandoff) */
+    void setSensingAge(double seconds) {sensing_age = (int64_t)(seconds*1e9);}
+    /* the message built from the last sensor update of the kb was emitted */
+    void sent(kilobot_id id);
+
+    /* smoothed measurements, seconds (0 until measured) */
+    double framePeriod() const {return frame_period;}
+    double pipelineDelay() const {return pipeline_delay;}
+
+    /* tracking frames from a sensor update to the delivery of its message, delivery_latency seconds after the emission */
+    double horizon(double delivery_latency) const;
+
+private:
+    QElapsedTimer clock;
+    std::vector<int64_t> received;  /* clock of the last sensor update of each kb id (ns), -1 if none */
+    double frame_period;
+    double pipeline_delay;
+    int64_t sensing_age;            /* ns, subtracted from the clock at the sensor updates */
+};
+
+#endif // LATENCYPREDICTOR_H
@@ -0,0 +1,302 @@
+#ifndef MEANFIELDMODEL_CPP
+#define MEANFIELDMODEL_CPP
+
+#include "meanFieldModel.h"
+
+#include <math.h>
+#include <algorithm>
+
+// Dormand-Prince 5(4) tableau
+static const double DP_A[7][6] = {
+    {0, 0, 0, 0, 0, 0},
+    {1.0/5, 0, 0, 0, 0, 0},
+    {3.0/40, 9.0/40, 0, 0, 0, 0},
+    {44.0/45, -56.0/15, 32.0/9, 0, 0, 0},
+    {19372.0/6561, -25360.0/2187, 64448.0/6561, -212.0/729, 0, 0},
+    {9017.0/3168, -355.0/33, 46732.0/5247, 49.0/176, -5103.0/18656, 0},
+    {35.0/384, 0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84}
+};
+// difference between the 5th and the 4th order solutions
+static const double DP_E[7] = {71.0/57600, 0, -71.0/16695, 71.0/1920, -17253.0/339200, 22.0/525, -1.0/40};
+
+// the areas are never let below this population (see Area::doStep)
+#define MEAN_FIELD_MIN_POPULATION 0.001
+// resolution of the populations sent to the kilobots
+#define MEAN_FIELD_UTILITY_STEP (1.0/255)
+// parameter sets integrated together
+#define MEAN_FIELD_BLOCK 32
+
+MeanFieldModel::MeanFieldModel(uint resources) :
+    rtol(1e-5), atol(1e-8), accepted_steps(0), rejected_steps(0), resources(resources), sets(0), variables(3*resources) {
+}
+
+MeanFieldModel::parameters MeanFieldModel::fromResources(const QVector<Resource*>& resources, uint robots, double arena_radius,
+                                                         double exploration_time, double communication_time) {
+    parameters p;
+    p.robots = robots;
+    p.eta = 0.008424878;
+    p.lambda = 0.005;
+    p.exponent = 2;
+    p.areas = 0;
+    p.coverage = 0;
+    p.umin = 0.6;
+    p.umax = 1;
+    p.h = MEAN_FIELD_H;
+    p.k = MEAN_FIELD_K;
+    // a decision is taken at the end of every communication time
+    p.decision_period = exploration_time+communication_time;
+    // the areas are stepped every tick (0.1 s) but frozen during the communication time
+    p.step_rate = 10*exploration_time/(exploration_time+communication_time);
+
+    for(const Resource* r : resources) {
+        p.population.push_back(r->population);
+        p.committed.push_back(0);
+    }
+    if(!resources.isEmpty() && !resources[0]->areas.empty()) {
+        const Resource* r = resources[0];
+        const Area* a = r->areas[0];
+        p.eta = a->eta;
+        p.lambda = a->lambda;
+        p.exponent = a->exploitation_type == "cubic" ? 3 : (a->exploitation_type == "quadratic" ? 2 : 1);
+        p.areas = r->areas.size();
+        p.coverage = p.areas*a->radius*a->radius/(arena_radius*arena_radius);
+        p.umin = r->umin;
+    }
+    return p;
+}
+
+uint MeanFieldModel::add(const parameters& p, double start) {
+    // insert the new set as the last column of every variable
+    uint set = sets;
+    std::vector<double> grown((sets+1)*variables);
+    for(uint v=0; v<variables; v++) {
+        std::copy(y.begin()+v*sets, y.begin()+(v+1)*sets, grown.begin()+v*(sets+1));
+    }
+    for(uint r=0; r<resources; r++) {
+        grown[(3*r)*(sets+1)+set] = r < p.population.size() ? p.population[r] : 1;
+        grown[(3*r+1)*(sets+1)+set] = r < p.committed.size() ? p.committed[r] : 0;
+        grown[(3*r+2)*(sets+1)+set] = 0;
+    }
+    y.swap(grown);
+    sets++;
+
+    robots.push_back(p.robots);
+    eta.push_back(p.eta);
+    lambda.push_back(p.lambda);
+    exponent.push_back(p.exponent);
+    areas.push_back(std::max(p.areas, 1.0));
+    coverage.push_back(p.coverage);
+    umin.push_back(p.umin);
+    umax.push_back(p.umax);
+    h.push_back(p.h);
+    k.push_back(p.k);
+    decision_period.push_back(p.decision_period);
+    step_rate.push_back(p.step_rate);
+    t.push_back(start);
+    dt.push_back(0.1);
+
+    for(std::vector<double>& s : stages) {
+        s.resize(sets*variables);
+    }
+    ytmp.resize(sets*variables);
+    ynew.resize(sets*variables);
+    utility.resize(sets*resources);
+    pressure.resize(2*sets);
+    step.resize(sets);
+    error.resize(sets);
+    return set;
+}
+
+void MeanFieldModel::clear() {
+    sets = 0;
+    std::vector<double>* vectors[] = {&robots, &eta, &lambda, &exponent, &areas, &coverage, &umin, &umax, &h, &k,
+                                      &decision_period, &step_rate, &y, &t, &dt};
+    for(std::vector<double>* v : vectors) {
+        v->clear();
+    }
+    accepted_steps = 0;
+    rejected_steps = 0;
+}
+
+void MeanFieldModel::derivatives(const double* __restrict__ state, double* __restrict__ dydt, uint first, uint last) {
+    const uint n = sets;
+    double* __restrict__ total_pressure = pressure.data();
+    double* __restrict__ total_committed = pressure.data()+n;
+    double* __restrict__ s_utility = utility.data();
+    const double* __restrict__ p_umin = umin.data();
+    const double* __restrict__ p_umax = umax.data();
+
+    // scaled utility of every resource (getScaledUtility) and cross-inhibition pressure of the committed kilobots
+    std::fill(total_pressure+first, total_pressure+last, 0.0);
+    std::fill(total_committed+first, total_committed+last, 0.0);
+    for(uint r=0; r<resources; r++) {
+        const double* __restrict__ population = state+(3*r)*n;
+        const double* __restrict__ committed = state+(3*r+1)*n;
+        double* __restrict__ su = s_utility+r*n;
+#pragma omp simd
+        for(uint s=first; s<last; s++) {
+            double range = std::max(p_umax[s]-p_umin[s], 1e-12);
+            double scaled = std::min(std::max((population[s]-p_umin[s])/range, 0.0), 1.0);
+            su[s] = scaled;
+            total_pressure[s] += committed[s]*scaled;
+            total_committed[s] += committed[s];
+        }
+    }
+
+    const double* __restrict__ p_robots = robots.data();
+    const double* __restrict__ p_eta = eta.data();
+    const double* __restrict__ p_lambda = lambda.data();
+    const double* __restrict__ p_exponent = exponent.data();
+    const double* __restrict__ p_areas = areas.data();
+    const double* __restrict__ p_coverage = coverage.data();
+    const double* __restrict__ p_h = h.data();
+    const double* __restrict__ p_k = k.data();
+    const double* __restrict__ p_period = decision_period.data();
+    const double* __restrict__ p_rate = step_rate.data();
+    const double inverse_resources = 1.0/resources;
+
+    // branch free so that the loop gets vectorized
+    for(uint r=0; r<resources; r++) {
+        const double* __restrict__ population = state+(3*r)*n;
+        const double* __restrict__ committed = state+(3*r+1)*n;
+        const double* __restrict__ su = s_utility+r*n;
+        double* __restrict__ d_population = dydt+(3*r)*n;
+        double* __restrict__ d_committed = dydt+(3*r+1)*n;
+        double* __restrict__ d_exploitation = dydt+(3*r+2)*n;
+#pragma omp simd
+        for(uint s=first; s<last; s++) {
+            double P = population[s];
+            double x = committed[s];
+            double uncommitted = std::max(1.0-total_committed[s], 0.0);
+
+            // take_decision: discovery and recruitment from uncommitted, abandon and cross-inhibition from committed
+            double joining = uncommitted*(p_h[s]*su[s]*inverse_resources + p_k[s]*x*su[s]);
+            // the kilobots perceive the population in 1/255 steps, abandon is ramped over one step so that
+            // the derivatives are continuous and the step size does not collapse when P stays at umin
+            double below = (p_umin[s]+MEAN_FIELD_UTILITY_STEP-P)/MEAN_FIELD_UTILITY_STEP;
+            double abandon = p_h[s]*std::min(std::max(below, 0.0), 1.0);
+            double leaving = x*(abandon + p_k[s]*(total_pressure[s]-x*su[s]));
+            d_committed[s] = (joining-leaving)/p_period[s];
+
+            // Area::doStep with the committed kilobots over the areas as a Poisson variable of mean m
+            double m = p_robots[s]*x*p_coverage[s]/p_areas[s];
+            double m2 = m*m;
+            double moment = m + (p_exponent[s] >= 2 ? m2 : 0.0) + (p_exponent[s] >= 3 ? m2*m+2*m2 : 0.0);
+            double exploitation = p_lambda[s]*P*moment;
+            double growth = p_eta[s]*P*(1-P);
+            double d = p_rate[s]*(growth-exploitation);
+            // the decrease vanishes approaching the minimum population (continuous, as above)
+            double room = std::min(std::max((P-MEAN_FIELD_MIN_POPULATION)/MEAN_FIELD_MIN_POPULATION, 0.0), 1.0);
+            d_population[s] = d < 0 ? d*room : d;
+            d_exploitation[s] = p_rate[s]*p_areas[s]*exploitation;
+        }
+    }
+}
+
+void MeanFieldModel::advanceTo(double end) {
+    // the sets are integrated in blocks, so that a set needing many small steps only slows down its block
+    for(uint first=0; first<sets; first+=MEAN_FIELD_BLOCK) {
+        advanceBlock(end, first, std::min(first+MEAN_FIELD_BLOCK, sets));
+    }
+}
+
+void MeanFieldModel::advanceBlock(double end, uint first, uint last) {
+    const uint n = sets;
+    double* __restrict__ s_step = step.data();
+    double* __restrict__ s_error = error.data();
+
+    // first stage at the start, then the last stage of the accepted steps (FSAL): a rejected set
+    // keeps its state, and its first stage
+    derivatives(y.data(), stages[0].data(), first, last);
+    while(true) {
+        // step of every set, 0 for the sets that reached the end
+        uint active = 0;
+        for(uint s=first; s<last; s++) {
+            double left = end-t[s];
+            s_step[s] = left > 1e-12 ? std::min(dt[s], left) : 0.0;
+            active += s_step[s] > 0;
+        }
+        if(active == 0) {
+            break;
+        }
+
+        // stages
+        for(uint stage=1; stage<7; stage++) {
+            for(uint v=0; v<variables; v++) {
+                const double* __restrict__ yv = y.data()+v*n;
+                double* __restrict__ out = (stage == 6 ? ynew.data() : ytmp.data())+v*n;
+#pragma omp simd
+                for(uint s=first; s<last; s++) {
+                    out[s] = yv[s];
+                }
+                for(uint j=0; j<stage; j++) {
+                    if(DP_A[stage][j] == 0) {
+                        continue;
+                    }
+                    const double a = DP_A[stage][j];
+                    const double* __restrict__ kv = stages[j].data()+v*n;
+#pragma omp simd
+                    for(uint s=first; s<last; s++) {
+                        out[s] += s_step[s]*a*kv[s];
+                    }
+                }
+            }
+            // the last stage is evaluated at the 5th order solution (FSAL)
+            derivatives(stage == 6 ? ynew.data() : ytmp.data(), stages[stage].data(), first, last);
+        }
+
+        // error of every set, as the max over the variables of the scaled local error
+        std::fill(s_error+first, s_error+last, 0.0);
+        for(uint v=0; v<variables; v++) {
+            const double* __restrict__ yv = y.data()+v*n;
+            const double* __restrict__ nv = ynew.data()+v*n;
+            double* __restrict__ ev = ytmp.data()+v*n;
+#pragma omp simd
+            for(uint s=first; s<last; s++) {
+                ev[s] = 0;
+            }
+            for(uint j=0; j<7; j++) {
+                if(DP_E[j] == 0) {
+                    continue;
+                }
+                const double e = DP_E[j];
+                const double* __restrict__ kv = stages[j].data()+v*n;
+#pragma omp simd
+                for(uint s=first; s<last; s++) {
+                    ev[s] += s_step[s]*e*kv[s];
+                }
+            }
+#pragma omp simd
+            for(uint s=first; s<last; s++) {
+                double scale = atol + rtol*std::max(fabs(yv[s]), fabs(nv[s]));
+                double scaled = fabs(ev[s])/scale;
+                s_error[s] = scaled > s_error[s] ? scaled : s_error[s];
+            }
+        }
+
+        // accept or reject per set and adapt the step size
+        for(uint s=first; s<last; s++) {
+            if(s_step[s] == 0) {
+                continue;
+            }
+            double factor = s_error[s] > 0 ? 0.9*pow(s_error[s], -0.2) : 5.0;
+            factor = std::min(std::max(factor, 0.2), 5.0);
+            // steps too small to be controlled are always accepted (e.g. at the umin discontinuity)
+            if(s_error[s] <= 1 || s_step[s] < 1e-9) {
+                for(uint v=0; v<variables; v++) {
+                    y[v*n+s] = ynew[v*n+s];
+                    stages[0][v*n+s] = stages[6][v*n+s];
+                }
+                t[s] += s_step[s];
+                // a step shortened to reach the end does not shrink the next one
+                dt[s] = s_step[s] < dt[s] ? std::max(dt[s], s_step[s]*factor) : s_step[s]*factor;
+                accepted_steps++;
+            } else {
+                dt[s] = s_step[s]*factor;
+                rejected_steps++;
+            }
+        }
+    }
+}
+
+#endif // MEANFIELDMODEL_CPP
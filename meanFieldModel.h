@@ -0,0 +1,107 @@
+/**
+ * Macroscopic (mean-field) prediction of the complexity experiment.
+ *
+ * For each resource i the model follows the mean population of its areas P_i, the fraction
+ * of kilobots committed to it x_i and its cumulative exploitation E_i (as Resource::totalExploitation).
+ * The decision rates are the ones of take_decision in kilobot_c_code/complexity.c, applied once
+ * per decision period (x_u = 1 - sum x_j are the uncommitted kilobots, S the scaled utility):
+ *
+ *   dx_i/dt = [ x_u (h S(P_i)/R + k x_i S(P_i)) - x_i (h [P_i <= umin] + k sum_{j!=i} x_j S(P_j)) ] / decision_period
+ *
+ * i.e. discovery, recruitment, abandon and cross-inhibition. The areas follow Area::doStep
+ * step_rate times per second, with the committed kilobots spread over the areas of the resource
+ * as a Poisson variable of mean m_i = robots x_i coverage / areas:
+ *
+ *   dP_i/dt = step_rate (eta P_i (1-P_i) - lambda P_i E[n^a])     (a = 1, 2, 3 for linear, quadratic, cubic)
+ *   dE_i/dt = step_rate areas lambda P_i E[n^a]
+ *
+ * Quorum sensing is not modelled (quorum_threshold is 0 in the controller).
+ *
+ * Many parameter sets are integrated together: the state is stored as structure of arrays
+ * (variable major, parameter set minor) so that the derivatives are vectorized across the
+ * sets. Each set has its own step size, adapted with the embedded error estimate of the
+ * Dormand-Prince 5(4) method; sets whose step is rejected keep their state. The sets are
+ * advanced in blocks of MEAN_FIELD_BLOCK, so a stiff set only slows down its own block.
+ */
+
+#ifndef MEANFIELDMODEL_H
+#define MEANFIELDMODEL_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <QVector>
+
+#include "resources.h"
+
+// weights of the decision processes, as h, k and tau in complexity.c
+#define MEAN_FIELD_H 0.1111111
+#define MEAN_FIELD_K 0.8888889
+
+class MeanFieldModel {
+public:
+    /* parameters and initial state of one prediction */
+    struct parameters {
+        double robots;          /* kilobots in the arena */
+        double eta;             /* area growth per step */
+        double lambda;          /* exploitation coefficient per step */
+        double exponent;        /* exploitation law: 1 linear, 2 quadratic, 3 cubic */
+        double areas;           /* areas per resource */
+        double coverage;        /* fraction of the arena covered by the areas of a resource */
+        double umin, umax;      /* utility thresholds (as fraction of the population) */
+        double h, k;            /* spontaneous and interactive weights */
+        double decision_period; /* seconds between two decisions of a kilobot */
+        double step_rate;       /* area steps per second */
+        std::vector<double> population; /* initial population of each resource */
+        std::vector<double> committed;  /* initial fraction of committed kilobots of each resource */
+    };
+
+    /* relative and absolute tolerance of the step size control */
+    double rtol, atol;
+    /* accepted and rejected steps of all sets */
+    uint64_t accepted_steps, rejected_steps;
+
+    explicit MeanFieldModel(uint resources=3);
+
+    /* parameters of the experiment as set up by the plugin, for the given resources and kilobots */
+    static parameters fromResources(const QVector<Resource*>& resources, uint robots, double arena_radius,
+                                    double exploration_time, double communication_time);
+
+    /* add a parameter set starting at time start, return its index */
+    uint add(const parameters& p, double start=0);
+    void clear();
+
+    uint size() const {return sets;}
+    uint resourcesCount() const {return resources;}
+
+    /* integrate all sets up to time t (seconds), sets already past t are left untouched */
+    void advanceTo(double t);
+
+    double time(uint set) const {return t[set];}
+    double population(uint set, uint resource) const {return y[(3*resource)*sets+set];}
+    double committed(uint set, uint resource) const {return y[(3*resource+1)*sets+set];}
+    double exploitation(uint set, uint resource) const {return y[(3*resource+2)*sets+set];}
+    double robotsOf(uint set) const {return robots[set];}
+
+private:
+    uint resources;
+    uint sets;
+    uint variables;
+
+    /* per set parameters, one entry per set */
+    std::vector<double> robots, eta, lambda, exponent, areas, coverage, umin, umax, h, k, decision_period, step_rate;
+
+    /* state (variable*sets+set), time and step size of each set */
+    std::vector<double> y, t, dt;
+
+    /* Dormand-Prince stages and scratch space */
+    std::vector<double> stages[7];
+    std::vector<double> ytmp, ynew, utility, pressure, step, error;
+
+    /* derivatives of the sets [first, last), dydt has variables*sets entries */
+    void derivatives(const double* state, double* dydt, uint first, uint last);
+    /* integrate the sets [first, last) up to end */
+    void advanceBlock(double end, uint first, uint last);
+};
+
+#endif // MEANFIELDMODEL_H
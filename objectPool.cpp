@@ -0,0 +1,63 @@
+#ifndef OBJECTPOOL_CPP
+#define OBJECTPOOL_CPP
+
+#include "objectPool.h"
+
+#include <stdlib.h>
+
+ObjectPool::ObjectPool(size_t block_size) :
+    block_size(block_size), current(0), offset(0), objects(0) {
+}
+
+ObjectPool::~ObjectPool() {
+    rewind();
+    for(block& b : blocks) {
+        free(b.data);
+    }
+}
+
+void ObjectPool::rewind() {
+    for(size_t i=destructors.size(); i>0; i--) {
+        destructors[i-1].destroy(destructors[i-1].object);
+    }
+    // the vectors keep their capacity, nothing is freed
+    destructors.clear();
+    objects = 0;
+    current = 0;
+    offset = 0;
+}
+
+size_t ObjectPool::capacity() const {
+    size_t bytes = 0;
+    for(const block& b : blocks) {
+        bytes += b.size;
+    }
+    return bytes;
+}
+
+void* ObjectPool::allocate(size_t size, size_t alignment) {
+    for(; current<blocks.size(); current++, offset=0) {
+        // the blocks are aligned to max_align_t, align the offset
+        size_t start = (offset+alignment-1)/alignment*alignment;
+        if(start+size <= blocks[current].size) {
+            offset = start+size;
+            objects++;
+            return blocks[current].data+start;
+        }
+    }
+
+    // all blocks are full: a new one, large enough for objects bigger than a block
+    block b;
+    b.size = size > block_size ? size : block_size;
+    b.data = (char*)malloc(b.size);
+    if(b.data == NULL) {
+        throw std::bad_alloc();
+    }
+    blocks.push_back(b);
+    current = blocks.size()-1;
+    offset = size;
+    objects++;
+    return b.data;
+}
+
+#endif // OBJECTPOOL_CPP
@@ -0,0 +1,80 @@
+/**
+ * Arena allocator for the objects of the environment (resources and areas).
+ *
+ * Objects are constructed with create<T>(...) in contiguous blocks, with a bump pointer. They
+ * are never freed one by one: rewind() destroys all of them (in reverse order of creation)
+ * and moves the bump pointer back to the first block, the blocks are kept and reused by the
+ * next objects. The memory of a pool hence only grows with the largest set of objects alive
+ * at the same time, not with the number of resets.
+ *
+ * Objects must not be deleted, their destructor is run by rewind() or by the destructor of
+ * the pool.
+ */
+
+#ifndef OBJECTPOOL_H
+#define OBJECTPOOL_H
+
+#include <stddef.h>
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+// default size of the blocks (bytes), the whole arena of the experiment fits in one
+#define OBJECT_POOL_BLOCK 65536
+
+class ObjectPool {
+public:
+    explicit ObjectPool(size_t block_size=OBJECT_POOL_BLOCK);
+
+    /* destructor, destroys the objects and frees the blocks */
+    ~ObjectPool();
+
+    /* construct a T in the pool */
+    template<class T, class... Args>
+    T* create(Args&&... args) {
+        T* object = new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if(!std::is_trivially_destructible<T>::value) {
+            destructors.push_back(destructor{object, &destroy<T>});
+        }
+        return object;
+    }
+
+    /* destroy all objects and reuse the blocks from the start */
+    void rewind();
+
+    /* objects alive */
+    size_t size() const {return objects;}
+    /* bytes reserved by the blocks */
+    size_t capacity() const;
+
+private:
+    struct block {
+        char* data;
+        size_t size;
+    };
+    struct destructor {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    size_t block_size;
+    std::vector<block> blocks;
+    size_t current;     /* block being filled */
+    size_t offset;      /* first free byte of the current block */
+    size_t objects;
+    std::vector<destructor> destructors;
+
+    ObjectPool(const ObjectPool&);
+    ObjectPool& operator=(const ObjectPool&);
+
+    /* aligned memory for one object, a new block is added when the current ones are full */
+    void* allocate(size_t size, size_t alignment);
+
+    template<class T>
+    static void destroy(void* object) {
+        static_cast<T*>(object)->~T();
+    }
+};
+
+#endif // OBJECTPOOL_H
@@ -0,0 +1,252 @@
+#ifndef PARALLELSTEPPER_CPP
+#define PARALLELSTEPPER_CPP
+
+#include "parallelStepper.h"
+
+#include <math.h>
+#include <string.h>
+#include <chrono>
+
+ParallelStepper::ParallelStepper(WorkStealingPool& pool, uint32_t robots, double robot_radius, double linear_speed, double angular_speed,
+                                 unsigned int seed, uint32_t tile_cells,
+                                 double arena_center_x, double arena_center_y, double arena_radius) :
+    KilobotKinematics(robots, robot_radius, linear_speed, angular_speed, seed, arena_center_x, arena_center_y, arena_radius),
+    pool(pool), channel(NULL), tile_cells(tile_cells) {
+    committed.assign(robots, 255);
+    if(this->tile_cells == 0)
+        this->tile_cells = 1;
+    this->tiles_x = (grid_width+this->tile_cells-1)/this->tile_cells;
+    this->tiles_y = (grid_height+this->tile_cells-1)/this->tile_cells;
+    this->robots_per_block = 1024;
+
+    tile_deliveries.resize(tilesCount());
+    tile_counters.resize(tilesCount());
+    worker_counters.resize(pool.size());
+}
+
+void ParallelStepper::setResources(const QVector<Resource*>& resources) {
+    areas.clear();
+    areas_of_type.clear();
+    for(Resource* r : resources) {
+        if(areas_of_type.size() <= r->type) {
+            areas_of_type.resize(r->type+1);
+        }
+        for(Area* a : r->areas) {
+            areas_of_type[r->type].push_back(areas.size());
+            areas.push_back(a);
+        }
+    }
+    for(std::vector<uint32_t>& counters : worker_counters) {
+        counters.assign(areas.size(), 0);
+    }
+}
+
+void ParallelStepper::step() {
+    // move the robots, blocks of contiguous robots
+    uint32_t blocks = (size()+robots_per_block-1)/robots_per_block;
+    pool.parallelFor(blocks, [this](uint32_t block, uint32_t) {
+        moveBlock(block);
+    });
+
+    // halo exchange: sort by cell and snapshot the positions read by the neighbouring tiles
+    buildCells();
+    sx.resize(size());
+    sy.resize(size());
+    for(uint32_t a=0; a<size(); a++) {
+        sx[a] = x[cell_robots[a]];
+        sy[a] = y[cell_robots[a]];
+    }
+
+    // collisions, wall and occupancy by tile
+    pool.parallelFor(tilesCount(), [this](uint32_t tile, uint32_t worker) {
+        collideTile(tile, worker);
+    });
+
+    // reduce the per thread occupancy counters (sum of integers, order does not matter),
+    // the whole swarm is recounted at every step
+    for(Area* a : areas) {
+        a->kilobots_in_area = 0;
+    }
+    for(std::vector<uint32_t>& counters : worker_counters) {
+        for(uint32_t i=0; i<areas.size(); i++) {
+            areas[i]->kilobots_in_area += counters[i];
+            counters[i] = 0;
+        }
+    }
+
+    // communication
+    if(channel) {
+        channel->prepare(x.data(), y.data(), size());
+        pool.parallelFor(tilesCount(), [this](uint32_t tile, uint32_t) {
+            listenTile(tile);
+        });
+        // dispatch in tile order to keep the reception order deterministic
+        for(uint32_t t=0; t<tilesCount(); t++) {
+            channel->merge(tile_counters[t]);
+            channel->dispatch(tile_deliveries[t]);
+        }
+        channel->notifyTransmitters();
+    }
+}
+
+void ParallelStepper::moveBlock(uint32_t block) {
+    uint32_t from = block*robots_per_block;
+    uint32_t to = std::min(from+robots_per_block, size());
+    randomWalk(from, to);
+    integrate(from, to);
+}
+
+void ParallelStepper::collideTile(uint32_t tile, uint32_t worker) {
+    uint32_t tx = tile%tiles_x;
+    uint32_t ty = tile/tiles_x;
+    uint32_t gx_end = std::min((tx+1)*tile_cells, grid_width);
+    uint32_t gy_end = std::min((ty+1)*tile_cells, grid_height);
+    const float min_d = 2*robot_radius;
+    const float free_radius = arena_radius-robot_radius;
+
+    for(uint32_t gy=ty*tile_cells; gy<gy_end; gy++) {
+        for(uint32_t gx=tx*tile_cells; gx<gx_end; gx++) {
+            uint32_t c = gy*grid_width+gx;
+            for(uint32_t a=cell_start[c]; a<cell_start[c+1]; a++) {
+                // full stencil, cells outside the tile are the halo (read only snapshot)
+                float push_x = 0, push_y = 0;
+                for(int32_t ngy=(int32_t)gy-1; ngy<=(int32_t)gy+1; ngy++) {
+                    if(ngy < 0 || ngy >= (int32_t)grid_height)
+                        continue;
+                    for(int32_t ngx=(int32_t)gx-1; ngx<=(int32_t)gx+1; ngx++) {
+                        if(ngx < 0 || ngx >= (int32_t)grid_width)
+                            continue;
+                        uint32_t nc = ngy*grid_width+ngx;
+                        for(uint32_t b=cell_start[nc]; b<cell_start[nc+1]; b++) {
+                            if(b == a)
+                                continue;
+                            float dx = sx[b]-sx[a];
+                            float dy = sy[b]-sy[a];
+                            float d2 = dx*dx+dy*dy;
+                            if(d2 >= min_d*min_d)
+                                continue;
+                            float d = sqrtf(d2);
+                            if(d < 1e-6f) {
+                                // exactly on top of each other, separate along x
+                                dx = (a < b) ? 1 : -1;
+                                dy = 0;
+                                d = 1;
+                            }
+                            // each robot moves half of the overlap
+                            float push = 0.5f*(min_d-d)/d;
+                            push_x -= dx*push;
+                            push_y -= dy*push;
+                        }
+                    }
+                }
+
+                // apply, keep inside the arena and update the velocity
+                uint32_t i = cell_robots[a];
+                float nx = sx[a]+push_x-arena_center_x;
+                float ny = sy[a]+push_y-arena_center_y;
+                float d = sqrtf(nx*nx+ny*ny);
+                float scale = (d > free_radius) ? free_radius/d : 1.0f;
+                x[i] = arena_center_x+nx*scale;
+                y[i] = arena_center_y+ny*scale;
+                vx[i] = x[i]-px[i];
+                vy[i] = y[i]-py[i];
+
+                countOccupancy(i, worker);
+            }
+        }
+    }
+}
+
+void ParallelStepper::countOccupancy(uint32_t robot, uint32_t worker) {
+    uint8_t type = committed[robot];
+    if(type >= areas_of_type.size())
+        return;
+    // same rule as updateVirtualSensor: committed robots count on the first area of their resource
+    QPointF position(x[robot], y[robot]);
+    for(uint32_t a : areas_of_type[type]) {
+        if(areas[a]->isInside(position)) {
+            worker_counters[worker][a]++;
+            break;
+        }
+    }
+}
+
+void ParallelStepper::listenTile(uint32_t tile) {
+    uint32_t tx = tile%tiles_x;
+    uint32_t ty = tile/tiles_x;
+    uint32_t gx_end = std::min((tx+1)*tile_cells, grid_width);
+    uint32_t gy_end = std::min((ty+1)*tile_cells, grid_height);
+
+    tile_deliveries[tile].clear();
+    tile_counters[tile] = IrChannel::listen_counters();
+    for(uint32_t gy=ty*tile_cells; gy<gy_end; gy++) {
+        for(uint32_t gx=tx*tile_cells; gx<gx_end; gx++) {
+            uint32_t c = gy*grid_width+gx;
+            for(uint32_t a=cell_start[c]; a<cell_start[c+1]; a++) {
+                channel->listen(cell_robots[a], tile_deliveries[tile], tile_counters[tile]);
+            }
+        }
+    }
+}
+
+uint64_t ParallelStepper::checksum() const {
+    // FNV-1a over the bit patterns
+    uint64_t hash = 14695981039346656037ull;
+    for(uint32_t i=0; i<size(); i++) {
+        float values[4] = {x[i], y[i], hx[i], hy[i]};
+        uint32_t bits[4];
+        memcpy(bits, values, sizeof(bits));
+        for(uint8_t v=0; v<4; v++) {
+            hash = (hash ^ bits[v])*1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+QString ParallelStepper::scalingReport(uint32_t max_threads, uint32_t robots, uint32_t ticks, unsigned int seed) {
+    // same environment for all runs
+    qsrand(seed);
+    QVector<Area> oth_areas;
+    QVector<Resource*> resources;
+    for(uint type=0; type<3; type++) {
+        resources.push_back(new Resource(type, ARENA_CENTER, 146, 1, oth_areas));
+    }
+
+    QString report = "threads ticks/s speedup checksum\n";
+    double single_thread = 0;
+    for(uint32_t threads=1; threads<=max_threads; threads++) {
+        WorkStealingPool pool(threads);
+        // kilobot: ~1 cm/s at 31 ticks per second and pi/5 rad/s, 5 px of radius
+        ParallelStepper stepper(pool, robots, 5, 0.3, M_PI/5/31, seed);
+        IrChannel channel(60, 8, 0.9, seed);
+        std::vector<kilobot_ir_message> messages(robots);
+        channel.setTxCallback([&messages](uint16_t robot) {
+            return (robot%4 == 0) ? &messages[robot] : (kilobot_ir_message*)NULL;
+        });
+        stepper.setChannel(&channel);
+        stepper.setResources(resources);
+        stepper.scatter();
+        for(uint32_t i=0; i<robots; i++) {
+            stepper.committed[i] = i%4;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for(uint32_t t=0; t<ticks; t++) {
+            stepper.step();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        double ticks_per_second = ticks/seconds;
+        if(threads == 1)
+            single_thread = ticks_per_second;
+
+        report = report + QString("%1 %2 %3 %4\n").arg(threads).arg(ticks_per_second, 0, 'f', 1)
+                .arg(ticks_per_second/single_thread, 0, 'f', 2).arg(stepper.checksum(), 16, 16, QChar('0'));
+    }
+
+    for(Resource* r : resources) {
+        delete r;
+    }
+    return report;
+}
+
+#endif // PARALLELSTEPPER_CPP
@@ -0,0 +1,88 @@
+/**
+ * Multi-threaded stepping of large simulated swarms.
+ *
+ * The arena is partitioned in square tiles of tile_cells x tile_cells cells of the kinematics
+ * cell list. Every tick:
+ * - random walk and integration run on blocks of robots (independent per robot)
+ * - the cell list is rebuilt and the sorted positions are snapshot; this is the halo exchange,
+ *   the robots of a tile read the snapshot of the neighbouring tiles but only write their own state
+ * - every tile resolves the collisions and the wall of its robots and counts the committed robots
+ *   over the areas in per-thread counters, summed into Area::kilobots_in_area (replacing
+ *   it) after the pass
+ * - if a channel is set, every tile computes the messages received by its robots, the deliveries
+ *   are then dispatched in tile order
+ *
+ * Tiles are the work units of a WorkStealingPool. They depend only on the arena geometry and
+ * all random draws are per robot (or per receiver in IrChannel), hence the results are the
+ * same regardless of the number of threads (see scalingReport).
+ */
+
+#ifndef PARALLELSTEPPER_H
+#define PARALLELSTEPPER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <QString>
+#include <QVector>
+
+#include "kinematics.h"
+#include "workStealingPool.h"
+#include "irChannel.h"
+#include "resources.h"
+#include "area.h"
+
+class ParallelStepper : public KilobotKinematics {
+public:
+    /* resource each robot is committed to (as the led colour, 0 red, 1 green, 2 blue), 255 if not committed */
+    std::vector<uint8_t> committed;
+
+    /* constructor */
+    ParallelStepper(WorkStealingPool& pool, uint32_t robots, double robot_radius, double linear_speed, double angular_speed,
+                    unsigned int seed=0, uint32_t tile_cells=16,
+                    double arena_center_x=ARENA_CENTER, double arena_center_y=ARENA_CENTER, double arena_radius=ARENA_SIZE);
+
+    /* areas whose kilobots_in_area is updated at every step */
+    void setResources(const QVector<Resource*>& resources);
+
+    /* channel used to exchange messages at every step, NULL to disable communication */
+    void setChannel(IrChannel* channel) {this->channel = channel;}
+
+    uint32_t tilesCount() const {return tiles_x*tiles_y;}
+
+    /* simulate one tick */
+    void step();
+
+    /* hash of positions and headings, used to check that runs are identical */
+    uint64_t checksum() const;
+
+    /*
+     * step the same swarm with 1 to max_threads threads and report ticks per second,
+     * speed up and checksum (that must be the same on all lines)
+     */
+    static QString scalingReport(uint32_t max_threads, uint32_t robots=10000, uint32_t ticks=500, unsigned int seed=0);
+
+private:
+    WorkStealingPool& pool;
+    IrChannel* channel;
+
+    uint32_t tile_cells, tiles_x, tiles_y;
+    uint32_t robots_per_block;
+
+    /* areas and, for each resource type, the indexes of its areas */
+    std::vector<Area*> areas;
+    std::vector<std::vector<uint32_t>> areas_of_type;
+    /* per worker occupancy counters, reduced into the areas */
+    std::vector<std::vector<uint32_t>> worker_counters;
+
+    /* per tile deliveries and counters of the channel */
+    std::vector<std::vector<IrChannel::delivery>> tile_deliveries;
+    std::vector<IrChannel::listen_counters> tile_counters;
+
+    void moveBlock(uint32_t block);
+    void collideTile(uint32_t tile, uint32_t worker);
+    void listenTile(uint32_t tile);
+    void countOccupancy(uint32_t robot, uint32_t worker);
+};
+
+#endif // PARALLELSTEPPER_H
@@ -0,0 +1,150 @@
+/**
+ * Constant velocity Kalman filter of the tracked position of a kilobot.
+ *
+ * ARK estimates the heading of a kb from the first and last of its 6 buffered positions
+ * (PositionBuffer) and then averages 5 of those with linear weights (OrientationBuffer), so
+ * after a turn the heading lags by several frames. The filter instead weighs every new position
+ * against the motion predicted so far, by their uncertainties: on a straight line the tracking
+ * noise is smoothed out over more frames than the buffers, and a position too far from the
+ * predicted one (a turn or a stop) makes the velocity uncertain again, so that it follows the
+ * turn within two or three frames.
+ *
+ * The state is position and velocity; time is in tracking frames (each sensor update of the kb is
+ * one frame), so the velocity is in pixels per frame as ARK's. The two axes are independent (the
+ * noises are isotropic), each one has a 2x2 covariance: the filter is a fixed block of plain
+ * values, with no allocation, and is kept by the registry for every kb (see KilobotRegistry).
+ */
+
+#ifndef POSEFILTER_H
+#define POSEFILTER_H
+
+#include <stdint.h>
+#include <math.h>
+
+#include <QPointF>
+#include <QDataStream>
+
+// noises of the model, can be set at build time: only their ratio changes the estimates, a larger
+// acceleration follows slow turns sooner and smooths the tracking noise less; the measurement
+// noise must not be below the one of the tracking, or every frame would look like a turn
+// standard deviation of the tracked positions, pixels
+#ifndef POSE_MEASUREMENT_NOISE
+#define POSE_MEASUREMENT_NOISE 0.5
+#endif
+// standard deviation of the change of velocity in a frame, pixels per frame (turns and stops)
+#ifndef POSE_ACCELERATION_NOISE
+#define POSE_ACCELERATION_NOISE 0.05
+#endif
+// standard deviation of the velocity before the second position, pixels per frame
+#define POSE_INITIAL_SPEED 2.0
+// squared distance of a tracked position from the predicted one, in standard deviations, beyond
+// which the kb is turning (99% of the positions of a straight line are within it, chi-square 2)
+#ifndef POSE_MANEUVER_GATE
+#define POSE_MANEUVER_GATE 9.21
+#endif
+
+struct PoseFilter {
+    /* one axis: position, velocity and their covariance */
+    struct axis {
+        double p, v;
+        double pp, pv, vv;
+    };
+    axis x, y;
+    uint32_t updates; /* positions filtered, 0 before the first one */
+
+    /* no position yet, the next update starts the filter there */
+    void clear() {
+        updates = 0;
+        x = y = axis{0, 0, 0, 0, 0};
+    }
+
+    /* filter the position tracked one frame after the previous one */
+    void update(QPointF position) {
+        if(updates++ == 0) {
+            start(x, position.x());
+            start(y, position.y());
+            return;
+        }
+        predict(x, 1);
+        predict(y, 1);
+        // a position too far from the predicted one for the noises is a turn or a stop: the
+        // uncertainty of the velocity grows by the one before the second position
+        double dx = position.x()-x.p, dy = position.y()-y.p;
+        double r = POSE_MEASUREMENT_NOISE*POSE_MEASUREMENT_NOISE;
+        if(dx*dx/(x.pp+r) + dy*dy/(y.pp+r) > POSE_MANEUVER_GATE) {
+            maneuver(x);
+            maneuver(y);
+        }
+        correct(x, position.x());
+        correct(y, position.y());
+    }
+
+    /* position t frames after the last update, velocity and heading (radians, image coordinates) */
+    QPointF positionAt(double t) const {return QPointF(x.p+x.v*t, y.p+y.v*t);}
+    QPointF velocity() const {return QPointF(x.v, y.v);}
+    double heading() const {return atan2(y.v, x.v);}
+
+    /* covariance of x, y, vx, vy t frames after the last update, row major 4x4 */
+    void covarianceAt(double t, double* covariance) const {
+        axis ax = x, ay = y;
+        predict(ax, t);
+        predict(ay, t);
+        for(int i=0; i<16; i++) {
+            covariance[i] = 0;
+        }
+        covariance[0*4+0] = ax.pp; covariance[0*4+2] = covariance[2*4+0] = ax.pv; covariance[2*4+2] = ax.vv;
+        covariance[1*4+1] = ay.pp; covariance[1*4+3] = covariance[3*4+1] = ay.pv; covariance[3*4+3] = ay.vv;
+    }
+
+    void save(QDataStream& out) const {
+        out << (quint32)updates;
+        for(const axis* a : {&x, &y}) {
+            out << a->p << a->v << a->pp << a->pv << a->vv;
+        }
+    }
+    void load(QDataStream& in) {
+        quint32 updates;
+        in >> updates;
+        this->updates = updates;
+        for(axis* a : {&x, &y}) {
+            in >> a->p >> a->v >> a->pp >> a->pv >> a->vv;
+        }
+    }
+
+private:
+    static void start(axis& a, double position) {
+        a.p = position;
+        a.v = 0;
+        a.pp = POSE_MEASUREMENT_NOISE*POSE_MEASUREMENT_NOISE;
+        a.pv = 0;
+        a.vv = POSE_INITIAL_SPEED*POSE_INITIAL_SPEED;
+    }
+
+    /* the velocity changed more than the acceleration noise allows, add the initial uncertainty */
+    static void maneuver(axis& a) {
+        a.vv += POSE_INITIAL_SPEED*POSE_INITIAL_SPEED;
+    }
+
+    /* t frames of constant velocity, with white noise acceleration */
+    static void predict(axis& a, double t) {
+        const double q = POSE_ACCELERATION_NOISE*POSE_ACCELERATION_NOISE;
+        a.p += a.v*t;
+        a.pp += 2*t*a.pv + t*t*a.vv + q*t*t*t/3;
+        a.pv += t*a.vv + q*t*t/2;
+        a.vv += q*t;
+    }
+
+    /* weigh the tracked position against the predicted one */
+    static void correct(axis& a, double position) {
+        double s = a.pp + POSE_MEASUREMENT_NOISE*POSE_MEASUREMENT_NOISE;
+        double kp = a.pp/s, kv = a.pv/s;
+        double innovation = position-a.p;
+        a.p += kp*innovation;
+        a.v += kv*innovation;
+        a.vv -= kv*a.pv;
+        a.pv -= kp*a.pv;
+        a.pp -= kp*a.pp;
+    }
+};
+
+#endif // POSEFILTER_H
@@ -0,0 +1,112 @@
+#ifndef COMPLEXITYREPLAY_CPP
+#define COMPLEXITYREPLAY_CPP
+
+#include "complexityReplay.h"
+
+#include <stdio.h>
+
+#include <QDebug>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+ComplexityReplay::ComplexityReplay() : seed(0), sensor_updates(0), updates(0) {
+    // only the state is replayed, no message is sent to the kilobots
+    environment.ongoingRuntimeIdentification = true;
+}
+
+bool ComplexityReplay::open(const QString& filename) {
+    return reader.open(filename);
+}
+
+bool ComplexityReplay::step() {
+    while(true) {
+        switch(reader.next()) {
+        case ReplayLogReader::STATE:
+            // start or resume of the experiment
+            if(!environment.restoreState(reader.environment_state)) {
+                qDebug() << "ERROR restoring the environment after" << updates << "updates";
+                return false;
+            }
+            seed = reader.seed;
+            break;
+        case ReplayLogReader::SENSOR:
+            // the environment registers a kilobot identified after the start
+            kilobot.setID(reader.id);
+            kilobot.updateState(reader.position, reader.velocity, reader.colour);
+            environment.updateVirtualSensor(kilobot);
+            sensor_updates++;
+            break;
+        case ReplayLogReader::UPDATE:
+            environment.time = reader.time;
+            environment.isCommunicationTime = reader.isCommunicationTime;
+            environment.lastTransitionTime = reader.lastTransitionTime;
+            // the horizon measured by the run, the replay has no predictor
+            environment.predictionHorizon = reader.predictionHorizon;
+            environment.update();
+            updates++;
+            return true;
+        case ReplayLogReader::CORRUPTED:
+            qDebug() << "Replay log corrupted after" << updates << "updates";
+            return false;
+        case ReplayLogReader::END:
+            return false;
+        }
+    }
+}
+
+uint32_t ComplexityReplay::committed(int type) const {
+    const KilobotRegistry& kilobots = environment.kilobots;
+    uint8_t led = resourceLed(type);
+    uint32_t count = 0;
+    for(uint k=0; k<kilobots.size(); k++) {
+        count += kilobots.leds()[k] == led;
+    }
+    return count;
+}
+
+static cv::Scalar toScalar(const QColor& colour) {
+    return cv::Scalar(colour.blue(), colour.green(), colour.red());
+}
+
+static void drawCircle(cv::Mat& image, QPointF pos, float r, QColor colour, int thickness, const char* text) {
+    cv::Point center(qRound(pos.x()), qRound(pos.y()));
+    cv::circle(image, center, qMax(1, qRound(r)), toScalar(colour), qMax(1, thickness));
+    if(text[0]) {
+        cv::putText(image, text, center, cv::FONT_HERSHEY_SIMPLEX, 1, toScalar(colour), 2);
+    }
+}
+
+void ComplexityReplay::render(cv::Mat& image) const {
+    // the tracking image is 1500x1500 pixels, centered on the arena
+    image.create(2*ARENA_CENTER, 2*ARENA_CENTER, CV_8UC3);
+    image.setTo(cv::Scalar(255, 255, 255));
+
+    QPointF centre(environment.configuration().arena_center_x, environment.configuration().arena_center_y);
+    drawCircle(image, centre, 13, QColor(Qt::yellow), 25, "");
+    drawCircle(image, centre, 735, QColor(Qt::yellow), 25, "");
+    uint8_t size = 10;
+    for(Resource* r : environment.resources) {
+        // bring the areas without kilobots up to date
+        r->catchUp();
+        for(const Area* a : r->areas) {
+            if(!a->active)
+                continue;
+            char apop[4];
+            sprintf(apop, "%d", (int)(a->population*100));
+            // a patch of the mask is marked at its centroid
+            double radius = a->mask ? 30 : a->radius;
+            // draw a inner gray circle if below umin
+            if(a->population < 0.6) {
+                drawCircle(image, a->position, radius-(size*a->population/2), Qt::gray, 5, apop);
+            }
+            drawCircle(image, a->position, radius, r->colour, size*a->population, apop);
+        }
+    }
+
+    const KilobotRegistry& kilobots = environment.kilobots;
+    for(uint k=0; k<kilobots.size(); k++) {
+        drawCircle(image, kilobots.positions()[k], 5, ledColour(kilobots.led(k)), 5, "");
+    }
+}
+
+#endif // COMPLEXITYREPLAY_CPP
@@ -0,0 +1,50 @@
+/**
+ * Offline replay of a recorded complexity experiment.
+ *
+ * The replay log written by the experiment (log_complexity_*.txt.replay, see replayLog.h) holds
+ * the initial environment and every sensor update and environment update of the run. The
+ * replay restores the environment and feeds the records to the same updateVirtualSensor/update
+ * code used in the arena, hence populations and exploitation are re-derived exactly, without
+ * timers and without sending messages.
+ */
+
+#ifndef COMPLEXITYREPLAY_H
+#define COMPLEXITYREPLAY_H
+
+#include <stdint.h>
+
+#include <QString>
+
+#include <opencv2/core/core.hpp>
+
+#include "complexityEnvironment.h"
+#include "replayLog.h"
+#include "kilobot.h"
+
+class ComplexityReplay {
+public:
+    mykilobotenvironment environment;
+    uint32_t seed;              /* qrand seed of the recorded run */
+    uint64_t sensor_updates;    /* records replayed */
+    uint64_t updates;
+
+    ComplexityReplay();
+
+    /* false if the file is not a replay log */
+    bool open(const QString& filename);
+
+    /* replay the sensor updates up to the next environment update included, false at the end of the log */
+    bool step();
+
+    /* kilobots whose led shows a commitment to the resource type, uncommitted ones if type is -1 */
+    uint32_t committed(int type) const;
+
+    /* draw the arena, the areas and the kilobots as plotEnvironment does on the recorded image */
+    void render(cv::Mat& image) const;
+
+private:
+    ReplayLogReader reader;
+    Kilobot kilobot; /* reused for all the sensor updates */
+};
+
+#endif // COMPLEXITYREPLAY_H
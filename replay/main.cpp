@@ -0,0 +1,123 @@
+/**
+ * Replays a recorded complexity experiment as fast as possible.
+ *
+ * Prints on stdout, every N environment updates, the populations, the total exploitation and
+ * the kilobots committed to each resource, and optionally renders the frames as images.
+ * With --predict the mean-field prediction (see meanFieldModel.h), started from the first
+ * printed state, is printed next to the observed values.
+ *
+ * usage: complexityReplay log_complexity_*.txt.replay [--every=N] [--render=directory] [--predict]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include <QString>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "complexityReplay.h"
+#include "meanFieldModel.h"
+
+int main(int argc, char** argv) {
+    QString log_file;
+    QString render_directory;
+    uint32_t every = 5; // as SAVE_LOG_EVERY
+    bool predict = false;
+    for(int i=1; i<argc; i++) {
+        if(strncmp(argv[i], "--every=", 8) == 0) {
+            every = qMax(1, atoi(argv[i]+8));
+        } else if(strncmp(argv[i], "--render=", 9) == 0) {
+            render_directory = argv[i]+9;
+        } else if(strcmp(argv[i], "--predict") == 0) {
+            predict = true;
+        } else if(argv[i][0] != '-' && log_file.isEmpty()) {
+            log_file = argv[i];
+        } else {
+            log_file.clear();
+            break;
+        }
+    }
+    if(log_file.isEmpty()) {
+        fprintf(stderr, "usage: %s replay_log [--every=N] [--render=directory] [--predict]\n", argv[0]);
+        return 1;
+    }
+
+    ComplexityReplay replay;
+    if(!replay.open(log_file)) {
+        fprintf(stderr, "cannot open %s\n", qPrintable(log_file));
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool header = false;
+    uint32_t frames = 0;
+    cv::Mat image;
+    MeanFieldModel prediction;
+    std::vector<double> exploitation_offset; // observed exploitation when the prediction starts
+    while(replay.step()) {
+        if(replay.updates%every != 0) {
+            continue;
+        }
+        const QVector<Resource*>& resources = replay.environment.resources;
+        if(!header) {
+            printf("time communication");
+            for(int r=0; r<resources.size(); r++) {
+                printf(" population%d exploitation%d committed%d", r, r, r);
+            }
+            printf(" uncommitted");
+            if(predict) {
+                // the prediction starts from the first printed state
+                uint32_t robots = replay.committed(-1);
+                // with the configuration of the run, restored with the environment
+                const ExperimentConfig& config = replay.environment.configuration();
+                MeanFieldModel::parameters parameters = MeanFieldModel::fromResources(resources, 0, config.arena_size,
+                                                                                      config.exploration_time, config.communication_time);
+                for(int r=0; r<resources.size(); r++) {
+                    robots += replay.committed(resources[r]->type);
+                }
+                parameters.robots = robots;
+                for(int r=0; r<resources.size(); r++) {
+                    parameters.committed[r] = robots ? (double)replay.committed(resources[r]->type)/robots : 0;
+                    printf(" predicted_population%d predicted_exploitation%d predicted_committed%d", r, r, r);
+                }
+                prediction.add(parameters, replay.environment.time);
+                exploitation_offset.clear();
+                for(int r=0; r<resources.size(); r++) {
+                    exploitation_offset.push_back(resources[r]->totalExploitation);
+                }
+            }
+            printf("\n");
+            header = true;
+        }
+        printf("%.1f %d", replay.environment.time, replay.environment.isCommunicationTime);
+        for(int r=0; r<resources.size(); r++) {
+            printf(" %f %f %u", resources[r]->getPopulation(), resources[r]->totalExploitation, replay.committed(resources[r]->type));
+        }
+        printf(" %u", replay.committed(-1));
+        if(predict) {
+            prediction.advanceTo(replay.environment.time);
+            for(uint r=0; r<prediction.resourcesCount() && r<exploitation_offset.size(); r++) {
+                printf(" %f %f %.1f", prediction.population(0, r), exploitation_offset[r]+prediction.exploitation(0, r),
+                       prediction.committed(0, r)*prediction.robotsOf(0));
+            }
+        }
+        printf("\n");
+
+        if(!render_directory.isEmpty()) {
+            replay.render(image);
+            QString filename = render_directory + QString("/complexity_%1.png").arg(frames++, 5, 10, QChar('0'));
+            cv::imwrite(filename.toStdString(), image);
+        }
+    }
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+    // run() advances the experiment by 0.1 s at every update
+    fprintf(stderr, "seed %u updates %llu sensor_updates %llu frames %u wall_s %.3f speedup %.0fx\n",
+            replay.seed, (unsigned long long)replay.updates, (unsigned long long)replay.sensor_updates, frames,
+            wall_seconds, wall_seconds > 0 ? replay.updates*0.1/wall_seconds : 0);
+    return 0;
+}
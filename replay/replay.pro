@@ -0,0 +1,60 @@
+#-------------------------------------------------
+#
+# Offline replay of recorded experiments (the .replay files written next to the logs)
+# run: ./complexityReplay log_complexity_*.txt.replay [--every=N] [--render=directory] [--predict]
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = complexityReplay
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -fopenmp-simd
+
+INCLUDEPATH += .. .
+
+SOURCES += \
+    main.cpp \
+    complexityReplay.cpp \
+    ../kilobot.cpp \
+    ../complexityEnvironment.cpp \
+    ../kilobotRegistry.cpp \
+    ../experimentConfig.cpp \
+    ../areaMask.cpp \
+    ../objectPool.cpp \
+    ../workStealingPool.cpp \
+    ../tickProfiler.cpp \
+    ../replayLog.cpp \
+    ../latencyPredictor.cpp \
+    ../meanFieldModel.cpp \
+    ../kilobot_c_code/resource_codec.c
+
+HEADERS += \
+    complexityReplay.h \
+    ../kilobot.h \
+    ../kilobotenvironment.h \
+    ../complexityEnvironment.h \
+    ../kilobotRegistry.h \
+    ../poseFilter.h \
+    ../experimentConfig.h \
+    ../objectPool.h \
+    ../workStealingPool.h \
+    ../tickProfiler.h \
+    ../replayLog.h \
+    ../latencyPredictor.h \
+    ../meanFieldModel.h \
+    ../resources.h \
+    ../area.h \
+    ../areaMask.h \
+    ../resourceColours.h \
+    ../kilobot_c_code/resource_codec.h
+
+INCLUDEPATH += /usr/local/include/
+LIBS += -L/usr/local/lib \
+        -lopencv_core \
+        -lopencv_imgproc \
+        -lopencv_imgcodecs
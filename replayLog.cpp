@@ -0,0 +1,104 @@
+#ifndef REPLAYLOG_CPP
+#define REPLAYLOG_CPP
+
+#include "replayLog.h"
+
+#include <QDebug>
+
+#define REPLAY_LOG_MAGIC 0x434d5052 // "CMPR"
+#define REPLAY_LOG_VERSION 2
+
+bool ReplayLogWriter::open(const QString& filename, bool append) {
+    close();
+    file.setFileName(filename);
+    bool header = !append || !file.exists() || file.size() == 0;
+    if(!file.open(append ? QIODevice::WriteOnly | QIODevice::Append : QIODevice::WriteOnly)) {
+        qDebug() << "ERROR opening replay log" << filename;
+        return false;
+    }
+    stream.setDevice(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    if(header) {
+        stream << (quint32)REPLAY_LOG_MAGIC << (quint32)REPLAY_LOG_VERSION;
+    }
+    return true;
+}
+
+void ReplayLogWriter::close() {
+    if(file.isOpen()) {
+        stream.setDevice(NULL);
+        file.close();
+    }
+}
+
+void ReplayLogWriter::recordState(uint32_t seed, const QByteArray& environment_state) {
+    stream << (quint8)ReplayLogReader::STATE << (quint32)seed << environment_state;
+}
+
+void ReplayLogWriter::recordSensor(kilobot_id id, QPointF position, QPointF velocity, kilobot_colour colour) {
+    // single precision is enough for pixels
+    stream << (quint8)ReplayLogReader::SENSOR << (quint16)id << (float)position.x() << (float)position.y()
+           << (float)velocity.x() << (float)velocity.y() << (quint8)colour;
+}
+
+void ReplayLogWriter::recordUpdate(double time, bool isCommunicationTime, double lastTransitionTime, double predictionHorizon) {
+    // times are kept in double precision as in the environment
+    stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+    stream << (quint8)ReplayLogReader::UPDATE << time << isCommunicationTime << lastTransitionTime << predictionHorizon;
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+}
+
+bool ReplayLogReader::open(const QString& filename) {
+    file.setFileName(filename);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    stream.setDevice(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic, version;
+    stream >> magic >> version;
+    if(stream.status() != QDataStream::Ok || magic != REPLAY_LOG_MAGIC || version != REPLAY_LOG_VERSION) {
+        qDebug() << filename << "is not a replay log of this experiment";
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+ReplayLogReader::record_t ReplayLogReader::next() {
+    if(stream.atEnd()) {
+        return END;
+    }
+    quint8 type;
+    stream >> type;
+    switch(type) {
+    case STATE: {
+        quint32 seed;
+        stream >> seed >> environment_state;
+        this->seed = seed;
+        break;
+    }
+    case SENSOR: {
+        quint16 id;
+        float x, y, vx, vy;
+        quint8 colour;
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+        stream >> id >> x >> y >> vx >> vy >> colour;
+        this->id = id;
+        this->position = QPointF(x, y);
+        this->velocity = QPointF(vx, vy);
+        this->colour = (kilobot_colour)colour;
+        break;
+    }
+    case UPDATE:
+        stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+        stream >> time >> isCommunicationTime >> lastTransitionTime >> predictionHorizon;
+        break;
+    default:
+        return CORRUPTED;
+    }
+    return stream.status() == QDataStream::Ok ? (record_t)type : CORRUPTED;
+}
+
+#endif // REPLAYLOG_CPP
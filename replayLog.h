@@ -0,0 +1,82 @@
+/**
+ * Binary log of what the environment perceived, used to replay an experiment offline.
+ *
+ * The file starts with a magic number and a version, followed by records:
+ * - STATE:  seed of qrand and the whole environment (mykilobotenvironment::saveState),
+ *           written when the experiment starts or resumes
+ * - SENSOR: id, position, velocity and led colour of a kilobot as received by updateVirtualSensor
+ * - UPDATE: time, phase and prediction horizon at every mykilobotenvironment::update
+ * Feeding the SENSOR records to updateVirtualSensor and calling update at every UPDATE record
+ * reproduces populations and exploitation of the resources (see replay/).
+ *
+ * A sensor record takes 20 bytes, about 70 MB per hour with 100 kilobots tracked at 10 Hz.
+ */
+
+#ifndef REPLAYLOG_H
+#define REPLAYLOG_H
+
+#include <stdint.h>
+
+#include <QFile>
+#include <QDataStream>
+#include <QByteArray>
+#include <QPointF>
+#include <QString>
+
+#include "kilobot.h"
+
+class ReplayLogWriter {
+public:
+    ReplayLogWriter() {}
+    ~ReplayLogWriter() {close();}
+
+    /* open the log, when appending (e.g. resuming) the records are added to the existing file */
+    bool open(const QString& filename, bool append);
+    bool isOpen() const {return file.isOpen();}
+    void close();
+
+    void recordState(uint32_t seed, const QByteArray& environment_state);
+    void recordSensor(kilobot_id id, QPointF position, QPointF velocity, kilobot_colour colour);
+    void recordUpdate(double time, bool isCommunicationTime, double lastTransitionTime, double predictionHorizon);
+
+private:
+    QFile file;
+    QDataStream stream;
+};
+
+class ReplayLogReader {
+public:
+    typedef enum {
+        END = 0,        /* end of the log */
+        CORRUPTED = 1,  /* unknown or truncated record */
+        STATE = 'H',
+        SENSOR = 'S',
+        UPDATE = 'U',
+    } record_t;
+
+    /* values of the last record read */
+    uint32_t seed;
+    QByteArray environment_state;
+    kilobot_id id;
+    QPointF position;
+    QPointF velocity;
+    kilobot_colour colour;
+    double time;
+    bool isCommunicationTime;
+    double lastTransitionTime;
+    double predictionHorizon;
+
+    ReplayLogReader() {}
+
+    /* false if the file can not be opened or is not a replay log */
+    bool open(const QString& filename);
+
+    /* read the next record */
+    record_t next();
+
+private:
+    QFile file;
+    QDataStream stream;
+};
+
+#endif // REPLAYLOG_H
@@ -0,0 +1,80 @@
+/**
+ * Colours of the resources, shared by the environment, the statistics and the replay.
+ *
+ * Resource r is drawn with resourceColour(r) and a kilobot committed to it lights resourceLed(r),
+ * the original red, green and blue. The commitment is only observed through the led reported by
+ * the tracker of ARK (lightColour of kilobot.h), so the environment runs up to TRACKED_RESOURCES
+ * resources. The controller, its message encoding and the headless models go up to MAX_RESOURCES;
+ * the areas of the resources beyond the third are drawn with secondary colours (yellow, magenta,
+ * cyan, orange, purple).
+ */
+
+#ifndef RESOURCECOLOURS_H
+#define RESOURCECOLOURS_H
+
+#include <QColor>
+
+#include "kilobot.h"
+#include "kilobot_c_code/resource_codec.h"
+
+/* membership of a kilobot, bit r set if over an area of resource r */
+typedef uint8_t resource_mask;
+
+/* led of a kilobot, a lightColour as stored in the registry */
+typedef uint8_t kilobot_led;
+#define LIGHT_COLOURS (BLUE+1)
+
+// resources told apart by the led of the committed kilobots (RED, GREEN and BLUE)
+#define TRACKED_RESOURCES 3
+
+/* colour of the areas of resource r, and of the kilobots committed to it */
+inline QColor resourceColour(int r) {
+    switch(r) {
+    case 0: return QColor(Qt::red);
+    case 1: return QColor(Qt::green);
+    case 2: return QColor(Qt::blue);
+    case 3: return QColor(Qt::yellow);
+    case 4: return QColor(Qt::magenta);
+    case 5: return QColor(Qt::cyan);
+    case 6: return QColor(255, 85, 0);
+    case 7: return QColor(85, 0, 255);
+    }
+    return QColor(Qt::black);
+}
+
+/* led of the kilobots committed to resource r, OFF from TRACKED_RESOURCES */
+inline kilobot_led resourceLed(int r) {
+    switch(r) {
+    case 0: return RED;
+    case 1: return GREEN;
+    case 2: return BLUE;
+    }
+    return OFF;
+}
+
+/* resource a kilobot with the led is committed to, -1 if uncommitted */
+inline int resourceOfLed(kilobot_led led) {
+    for(int r=0; r<TRACKED_RESOURCES; r++) {
+        if(resourceLed(r) == led) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+/* resource of the colour (see resourceColour), -1 if none */
+inline int resourceOfColour(const QColor& colour) {
+    for(int r=0; r<MAX_RESOURCES; r++) {
+        if(resourceColour(r) == colour) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+/* colour of a kilobot with the led, black if uncommitted */
+inline QColor ledColour(kilobot_led led) {
+    return resourceColour(resourceOfLed(led));
+}
+
+#endif // RESOURCECOLOURS_H
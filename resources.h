@@ -12,6 +12,8 @@
 #define RESOURCES_H
 
 #include "area.h"
+#include "objectPool.h"
+#include "experimentConfig.h"
 #include "kilobot.h"
 #include "kilobotenvironment.h"
 
@@ -19,9 +21,12 @@
 #include <stdlib.h>
 #include <random>
 #include <iostream>
+#include <sstream>
 
 #include <QPointF>
 #include <QtMath>
+#include <QDataStream>
+#include <QString>
 
 class Resource {
 
@@ -38,71 +43,86 @@ public:
     /* virtual environment visualization*/
     /************************************/
     uint8_t type; // resource type
-    QColor colour; // resource colour associated to the type, red green and blue
+    QColor colour; // resource colour associated to the type (see resourceColour)
     double area_radius;   // the radius of the circle
+    QPointF arena_centre; // the areas are placed in the circle arena_centre, arena_radius
+    double arena_radius;
     uint seq_areas_id; // used to sequentially assign ids to areas
     std::vector<Area*> areas; /* areas of the resource */
-    double population; /* Total resource population from 0 to 1 */
+    double population; /* Total resource population from 0 to 1, read it with getPopulation */
+    quint32 steps; /* steps done, the areas without kilobots are caught up lazily (see doStep) */
 
     /************************************/
     /* area exploitation function       */
     /************************************/
     std::string exploitation; /* single area exploitation */
     double totalExploitation; /* total exploitation over the whole simulation */
-    /* constructor */
-    Resource() {
+    /* constructor, the areas are created in pool (NULL to use new and delete) */
+    explicit Resource(ObjectPool* pool=NULL) {
+        this->pool = pool;
        this->type = 0;
         this->colour = QColor(Qt::red);
         this->population = 0.0;
+        this->population_sum = 0;
         this->eta = 0.008424878;
         this->k = 10;
         this->umin = 0.6;
         this->area_radius = 150;
+        // the arena of the default configuration (load replaces it)
+        this->arena_centre = QPointF(ARENA_CENTER,ARENA_CENTER);
+        this->arena_radius = ARENA_SIZE;
         this->seq_areas_id = 0;
+        this->totalExploitation = 0;
+        this->steps = 0;
+        this->population_step = 0;
 
         re.seed(qrand());
     }
 
-    Resource(uint type, double arena_radius, double area_radius, double population, QVector<Area>& oth_areas) {
+    Resource(uint type, double arena_radius, double area_radius, double population, QVector<Area>& oth_areas,
+             ObjectPool* pool=NULL, QPointF arena_centre=QPointF(ARENA_CENTER,ARENA_CENTER)) {
+        this->pool = pool;
         this->type = type;
         this->population = population;
         this->eta = 0.008424878;
         this->k = 10;
         this->umin = 0.6;
         this->area_radius = area_radius;
+        this->arena_centre = arena_centre;
+        this->arena_radius = arena_radius;
         this->seq_areas_id = 0; // not used anywhere (remove?)
         this->exploitation = "quadratic";
+        this->totalExploitation = 0;
+        this->steps = 0;
+        this->population_step = 0;
         re.seed(qrand());
 
-        if(type==0)
-            this->colour = QColor(Qt::red);
-        else if(type==1)
-            this->colour = QColor(Qt::green);
-        else if(type==2)
-            this->colour = QColor(Qt::blue);
+        this->colour = resourceColour(type);
 
-        this->generate(oth_areas, arena_radius, this->k*this->population);
+        this->generate(oth_areas, arena_centre, arena_radius, this->k*this->population);
     }
 
-    /* destructor */
-    ~Resource() {}
+    /* destructor, the areas created in a pool are destroyed by the pool */
+    ~Resource() {
+        clearAreas();
+    }
 
    /*
    * generate areas for the resource by taking into account all other areas positions
    */
-    void generate(QVector<Area>& oth_areas, double arena_radius, uint num_of_areas) {
+    void generate(QVector<Area>& oth_areas, QPointF arena_centre, double arena_radius, uint num_of_areas) {
         uint tries = 0;         // placement tries
         uint maxTries = 9999;   // max placement tries
 
         for(uint i=0; i<num_of_areas; i++) {
             for(tries=0; tries <= maxTries; tries++) {
                 QPointF pos;
-                // find a possible placement inside the arena (750 is the center of the image)
-                pos.setX(getRandDouble(750-arena_radius,750+arena_radius));
-                pos.setY(getRandDouble(750-arena_radius,750+arena_radius));
+                // find a possible placement inside the arena (by default centered in the image)
+                pos.setX(getRandDouble(arena_centre.x()-arena_radius,arena_centre.x()+arena_radius));
+                pos.setY(getRandDouble(arena_centre.y()-arena_radius,arena_centre.y()+arena_radius));
 
                 // if not within the circle break
-                if(pow(pos.x()-750,2)+pow(pos.y()-750,2) < pow(arena_radius-area_radius,2)) {
+                if(pow(pos.x()-arena_centre.x(),2)+pow(pos.y()-arena_centre.y(),2) < pow(arena_radius-area_radius,2)) {
                     bool overlaps = false;
                     // check if overlaps with an area in the same resource
                     for(Area* my_area : this->areas) {
@@ -115,7 +135,7 @@ public:
 
                     if(!overlaps){
                         // create the area
-                        Area* new_area = new Area(this->type, seq_areas_id, pos, area_radius, exploitation);
+                        Area* new_area = createArea(this->type, seq_areas_id, pos, area_radius, exploitation);
                         seq_areas_id++;
                         // save new area for simulation
                         areas.push_back(new_area);
@@ -126,6 +146,29 @@ public:
                 }
             }
         }
+        restartPopulation();
+    }
+
+    /*
+   * replace the areas with the patches of the mask painted with the colour of the resource, all full
+   * @return the number of patches
+   */
+    uint generate(const AreaMask& mask) {
+        clearAreas();
+        for(uint label=1; label<=mask.regionsCount(); label++) {
+            const AreaMask::region& patch = mask.regionOf(label);
+            if(patch.type == this->type) {
+                Area* new_area = createArea(this->type, seq_areas_id, patch.centroid, patch.bounding_radius, exploitation);
+                new_area->mask = &mask;
+                new_area->label = label;
+                seq_areas_id++;
+                areas.push_back(new_area);
+            }
+        }
+        this->k = areas.size();
+        this->population = 1;
+        restartPopulation();
+        return areas.size();
     }
 
     /*
@@ -133,25 +176,282 @@ public:
    * - the population is increased according to a logistic function
    * - the population is exploited according to the kilobots over it
    *
-   * @return TODO
+   * Only the areas with kilobots over them are stepped: the others just grow (Area::grow) and
+   * are caught up when read (getPopulation, catchUp, Area::populationAt), hence the cost of a
+   * step scales with the occupied areas. The result is the same as stepping every area.
+   * The resource population is a running sum of the populations of the areas: getPopulation
+   * only catches up the areas stepped since they were last full (see regrowing).
+   *
+   * An exploited area whose population falls to depletion or below (never if 0) is not removed
+   * here, its index is appended to depleted: the caller removes it (see remove).
+   *
+   * @return true if an area was depleted
    */
-    bool doStep() {
-        // reset before update
-        this->population = 0;
+    bool doStep(double depletion=0, std::vector<uint>* depleted=NULL) {
+        bool any_depleted = false;
         // after the update of the areas then apply exploitation
-        for(Area* a : areas) {
-            this->totalExploitation += a->doStep();
-            this->population += a->population;
+        for(uint i=0; i<areas.size(); i++) {
+            Area* a = areas[i];
+            if(a->kilobots_in_area > 0 && a->active) {
+                double before = a->population;
+                a->catchUp(this->steps);
+                this->totalExploitation += a->doStep();
+                this->population_sum += a->population-before;
+                if(!a->regrowing) {
+                    a->regrowing = true;
+                    regrowing.push_back(i);
+                }
+                // only the exploited areas lose population
+                if(a->population <= depletion) {
+                    any_depleted = true;
+                    if(depleted)
+                        depleted->push_back(i);
+                }
+            }
         }
-        // normalize between 0 and 1
-        this->population = this->population/this->areas.size();
+        this->steps++;
+
+        return any_depleted;
+    }
+
+    /*
+     * remove the area at index at time (environment time): it stays in its slot, inactive, and
+     * counts as empty in the resource population. The kbs over it are not updated here.
+     */
+    void remove(uint index, double time) {
+        Area* a = areas[index];
+        a->active = false;
+        a->removed_time = time;
+        this->population_sum -= a->population;
+        a->population = 0;
+        a->last_step = this->steps;
+        // the resource population is recomputed at the next read
+        this->population_step = this->steps-1;
+    }
 
+    /*
+     * bring the removed area at index back, full, at a random position of the arena not overlapping
+     * the other areas of the resource (a patch of a mask comes back in place)
+     * @return false (area still removed) if no position was found
+     */
+    bool respawn(uint index) {
+        Area* a = areas[index];
+        if(a->mask) {
+            a->population = 1;
+            this->population_sum += 1;
+            a->last_step = this->steps;
+            a->active = true;
+            // the resource population is recomputed at the next read
+            this->population_step = this->steps-1;
+            return true;
+        }
+        for(uint tries=0; tries <= 9999; tries++) {
+            QPointF pos(getRandDouble(arena_centre.x()-arena_radius,arena_centre.x()+arena_radius),
+                        getRandDouble(arena_centre.y()-arena_radius,arena_centre.y()+arena_radius));
+            if(pow(pos.x()-arena_centre.x(),2)+pow(pos.y()-arena_centre.y(),2) >= pow(arena_radius-area_radius,2)) {
+                continue;
+            }
+            bool overlaps = false;
+            for(const Area* other : this->areas) {
+                if(other != a && other->active &&
+                        pow(other->position.x()-pos.x(),2)+pow(other->position.y()-pos.y(),2) <= pow(area_radius*2,2)) {
+                    overlaps = true;
+                    break;
+                }
+            }
+            if(!overlaps) {
+                // kilobots_in_area is kept: the kbs still counted on the slot leave it when classified again
+                a->position = pos;
+                a->population = 1;
+                this->population_sum += 1;
+                a->last_step = this->steps;
+                a->active = true;
+                // the resource population is recomputed at the next read
+                this->population_step = this->steps-1;
+                return true;
+            }
+        }
         return false;
     }
 
+    /*
+     * move the area at index, the population is untouched (a patch of a mask does not move)
+     */
+    void move(uint index, QPointF position) {
+        if(!areas[index]->mask)
+            areas[index]->position = position;
+    }
+
+    /*
+     * bring all the areas up to date and recompute the resource population
+     */
+    void catchUp() {
+        for(Area* a : areas) {
+            if(a->active)
+                a->catchUp(this->steps);
+        }
+        // the running sum is recomputed, without the rounding of its updates
+        this->population_sum = 0;
+        for(const Area* a : areas) {
+            if(a->active)
+                this->population_sum += a->population;
+        }
+        this->population = meanPopulation();
+        this->population_step = this->steps;
+    }
+
+    /*
+     * population of the area at index after the last step, the area keeps the steps caught up
+     */
+    double getAreaPopulation(uint index) {
+        Area* a = areas[index];
+        if(a->active && a->last_step != this->steps) {
+            double before = a->population;
+            a->catchUp(this->steps);
+            this->population_sum += a->population-before;
+        }
+        return a->population;
+    }
+
+    /*
+     * resource population after the last step, from 0 to 1
+     * only the regrowing areas are caught up, the others are full or were stepped
+     */
+    double getPopulation() {
+        if(this->population_step != this->steps) {
+            for(uint i=0; i<regrowing.size(); ) {
+                Area* a = areas[regrowing[i]];
+                if(a->active) {
+                    double before = a->population;
+                    a->catchUp(this->steps);
+                    this->population_sum += a->population-before;
+                }
+                if(!a->active || a->settled()) {
+                    a->regrowing = false;
+                    regrowing[i] = regrowing.back();
+                    regrowing.pop_back();
+                } else {
+                    i++;
+                }
+            }
+            this->population = areas.empty() ? 0 : this->population_sum/areas.size();
+            this->population_step = this->steps;
+        }
+        return this->population;
+    }
+
+    /*
+     * write the whole state of the resource and of its areas in a snapshot
+     */
+    void save(QDataStream& out) const {
+        // the snapshot holds the up to date populations (the step counts are not saved)
+        double population = 0;
+        for(const Area* a : areas) {
+            if(a->active)
+                population += a->populationAt(this->steps);
+        }
+        population = areas.empty() ? 0 : population/areas.size();
+        out << (quint32)type << colour << umin << eta << (quint32)k << area_radius << arena_centre << arena_radius << (quint32)seq_areas_id
+            << population << QString::fromStdString(exploitation) << totalExploitation;
+        // the generator of the respawn positions, a resumed or replayed run respawns the areas in the same places
+        std::ostringstream engine;
+        engine << re;
+        out << QString::fromStdString(engine.str());
+        out << (quint32)areas.size();
+        for(const Area* a : areas) {
+            a->save(out, this->steps);
+        }
+    }
+
+    /*
+     * read the state written by save, the current areas are replaced
+     * @return false if the stream is corrupted
+     */
+    bool load(QDataStream& in) {
+        quint32 type, k, seq_areas_id, areas_count;
+        QString exploitation, engine_state;
+        in >> type >> colour >> umin >> eta >> k >> area_radius >> arena_centre >> arena_radius >> seq_areas_id
+           >> population >> exploitation >> totalExploitation >> engine_state >> areas_count;
+        // an arena holds few tens of areas
+        if(in.status() != QDataStream::Ok || areas_count > 10000) {
+            return false;
+        }
+        std::istringstream engine(engine_state.toStdString());
+        engine >> re;
+        if(engine.fail()) {
+            return false;
+        }
+        this->type = type;
+        this->k = k;
+        this->seq_areas_id = seq_areas_id;
+        this->exploitation = exploitation.toStdString();
+        this->steps = 0;
+        this->population_step = 0;
+
+        clearAreas();
+        for(quint32 i=0; i<areas_count; i++) {
+            Area* a = createArea();
+            a->load(in);
+            areas.push_back(a);
+        }
+        restartPopulation();
+        return in.status() == QDataStream::Ok;
+    }
+
 private:
+    ObjectPool* pool; /* where the areas are created, NULL if they are owned */
     unsigned int seed;
     std::default_random_engine re;
+    quint32 population_step; /* step at which population was computed */
+    double population_sum; /* populations of the active areas, as last updated */
+    std::vector<uint> regrowing; /* areas that can change without kilobots, i.e. stepped and not full since */
+
+    Resource(const Resource&);
+    Resource& operator=(const Resource&);
+
+    template<class... Args>
+    Area* createArea(Args&&... args) {
+        if(this->pool)
+            return this->pool->create<Area>(std::forward<Args>(args)...);
+        return new Area(std::forward<Args>(args)...);
+    }
+
+    void clearAreas() {
+        if(!this->pool) {
+            for(Area* a : areas) {
+                delete a;
+            }
+        }
+        areas.clear();
+    }
+
+    /* sum the populations and list the regrowing areas again, after the areas are replaced */
+    void restartPopulation() {
+        this->population_sum = 0;
+        regrowing.clear();
+        for(uint i=0; i<areas.size(); i++) {
+            Area* a = areas[i];
+            a->regrowing = a->active && !a->settled();
+            if(a->regrowing)
+                regrowing.push_back(i);
+            if(a->active)
+                this->population_sum += a->population;
+        }
+        // computed at the next read
+        this->population_step = this->steps-1;
+    }
+
+    /* mean population of the areas, they must be up to date */
+    double meanPopulation() const {
+        double population = 0;
+        // a removed area counts as empty
+        for(const Area* a : areas) {
+            if(a->active)
+                population += a->population;
+        }
+        // normalize between 0 and 1
+        return population/this->areas.size();
+    }
 
     int getRandInt(int min, int max) {
         std::uniform_int_distribution<> uid(min, max);
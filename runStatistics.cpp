@@ -0,0 +1,185 @@
+#ifndef RUNSTATISTICS_CPP
+#define RUNSTATISTICS_CPP
+
+#include "runStatistics.h"
+
+#include <limits>
+
+#include "resourceColours.h"
+
+void RunStatistics::reset(uint resources_count, double time) {
+    resource_statistics empty;
+    empty.population_mean = 0;
+    empty.population_min = std::numeric_limits<double>::max();
+    empty.population_max = 0;
+    empty.commitment_mean = 0;
+    empty.committed = 0;
+    empty.exploitation = 0;
+    resources.fill(empty, resources_count);
+    exploitation_offset.fill(-1, resources_count);
+
+    uncommitted = 0;
+    uncommitted_mean = 0;
+    robots = 0;
+    samples = 0;
+    start_time = time;
+    last_time = time;
+    consensus_time = -1;
+    consensus_resource = -1;
+    switches = 0;
+    resource_switches = 0;
+    commitments.clear();
+}
+
+int RunStatistics::commitmentOf(kilobot_led led) {
+    // same mapping of mykilobotenvironment::classifyKilobot
+    return resourceOfLed(led);
+}
+
+void RunStatistics::update(double time, const QVector<Resource*>& resources, const KilobotRegistry& kilobots) {
+    if(this->resources.size() != resources.size()) {
+        reset(resources.size(), time);
+    }
+
+    // count the commitments and the switches since the last update
+    QVector<uint32_t> committed(resources.size(), 0);
+    uncommitted = 0;
+    const kilobot_id* ids = kilobots.ids();
+    const uint8_t* leds = kilobots.leds();
+    for(uint k=0; k<kilobots.size(); k++) {
+        kilobot_id k_id = ids[k];
+        if(k_id >= commitments.size()) {
+            int seen = commitments.size();
+            commitments.resize(k_id+1);
+            for(int i=seen; i<commitments.size(); i++) {
+                commitments[i] = -2;
+            }
+        }
+        int commitment = commitmentOf(leds[k]);
+        if(commitment < 0) {
+            uncommitted++;
+        } else if(commitment < resources.size()) {
+            committed[commitment]++;
+        }
+        qint8 previous = commitments[k_id];
+        if(previous != -2 && previous != commitment) {
+            switches++;
+            if(previous >= 0 && commitment >= 0) {
+                resource_switches++;
+            }
+        }
+        commitments[k_id] = commitment;
+    }
+    robots = kilobots.size();
+    samples++;
+    last_time = time;
+
+    // running means, min and max
+    double n = samples;
+    for(int r=0; r<resources.size(); r++) {
+        resource_statistics& s = this->resources[r];
+        double population = resources[r]->getPopulation();
+        double fraction = robots ? (double)committed[r]/robots : 0;
+        s.population_mean += (population-s.population_mean)/n;
+        s.population_min = qMin(s.population_min, population);
+        s.population_max = qMax(s.population_max, population);
+        s.commitment_mean += (fraction-s.commitment_mean)/n;
+        s.committed = committed[r];
+        if(exploitation_offset[r] < 0) {
+            exploitation_offset[r] = resources[r]->totalExploitation;
+        }
+        s.exploitation = resources[r]->totalExploitation-exploitation_offset[r];
+
+        if(consensus_time < 0 && robots && fraction >= CONSENSUS_QUORUM) {
+            consensus_time = time-start_time;
+            consensus_resource = r;
+        }
+    }
+    uncommitted_mean += ((robots ? (double)uncommitted/robots : 0)-uncommitted_mean)/n;
+}
+
+double RunStatistics::switchingRate() const {
+    double minutes = (last_time-start_time)/60.0;
+    if(robots == 0 || minutes <= 0) {
+        return 0;
+    }
+    return switches/(robots*minutes);
+}
+
+QString RunStatistics::summary() const {
+    QString summary = QString("duration_s %1\nsamples %2\nrobots %3\n")
+            .arg(last_time-start_time, 0, 'f', 1).arg(samples).arg(robots);
+    summary = summary + QString("consensus_time_s %1\nconsensus_resource %2\n")
+            .arg(consensus_time, 0, 'f', 1).arg(consensus_resource);
+    summary = summary + QString("switches %1\nresource_switches %2\nswitches_per_robot_min %3\n")
+            .arg(switches).arg(resource_switches).arg(switchingRate(), 0, 'f', 3);
+    summary = summary + QString("uncommitted_mean %1\nuncommitted %2\n")
+            .arg(uncommitted_mean, 0, 'f', 3).arg(uncommitted);
+
+    summary = summary + "resource population_mean population_min population_max commitment_mean committed exploitation\n";
+    for(int r=0; r<resources.size(); r++) {
+        const resource_statistics& s = resources[r];
+        summary = summary + QString("%1 %2 %3 %4 %5 %6 %7\n").arg(r)
+                .arg(s.population_mean, 0, 'f', 4).arg(samples ? s.population_min : 0, 0, 'f', 4)
+                .arg(s.population_max, 0, 'f', 4).arg(s.commitment_mean, 0, 'f', 3)
+                .arg(s.committed).arg(s.exploitation, 0, 'f', 3);
+    }
+    return summary;
+}
+
+void RunStatistics::save(QDataStream& out) const {
+    out << (quint32)resources.size();
+    for(int r=0; r<resources.size(); r++) {
+        const resource_statistics& s = resources[r];
+        out << s.population_mean << s.population_min << s.population_max << s.commitment_mean
+            << (quint32)s.committed << s.exploitation << exploitation_offset[r];
+    }
+    out << (quint32)uncommitted << uncommitted_mean << (quint32)robots << (quint64)samples << start_time << last_time
+        << consensus_time << (qint32)consensus_resource << (quint64)switches << (quint64)resource_switches;
+    out << commitments;
+}
+
+bool RunStatistics::load(QDataStream& in) {
+    quint32 resources_count;
+    in >> resources_count;
+    if(in.status() != QDataStream::Ok || resources_count > 255) {
+        return false;
+    }
+    QVector<resource_statistics> resources(resources_count);
+    QVector<double> exploitation_offset(resources_count);
+    for(quint32 r=0; r<resources_count; r++) {
+        resource_statistics& s = resources[r];
+        quint32 committed;
+        in >> s.population_mean >> s.population_min >> s.population_max >> s.commitment_mean
+           >> committed >> s.exploitation >> exploitation_offset[r];
+        s.committed = committed;
+    }
+    quint32 uncommitted, robots;
+    double uncommitted_mean, start_time, last_time, consensus_time;
+    quint64 samples, switches, resource_switches;
+    qint32 consensus_resource;
+    QVector<qint8> commitments;
+    in >> uncommitted >> uncommitted_mean >> robots >> samples >> start_time >> last_time
+       >> consensus_time >> consensus_resource >> switches >> resource_switches;
+    in >> commitments;
+    if(in.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    this->resources = resources;
+    this->exploitation_offset = exploitation_offset;
+    this->uncommitted = uncommitted;
+    this->uncommitted_mean = uncommitted_mean;
+    this->robots = robots;
+    this->samples = samples;
+    this->start_time = start_time;
+    this->last_time = last_time;
+    this->consensus_time = consensus_time;
+    this->consensus_resource = consensus_resource;
+    this->switches = switches;
+    this->resource_switches = resource_switches;
+    this->commitments = commitments;
+    return true;
+}
+
+#endif // RUNSTATISTICS_CPP
@@ -0,0 +1,82 @@
+/**
+ * Statistics of a run of the complexity experiment, accumulated while the experiment runs.
+ *
+ * update() is called once per tick and folds the current populations, exploitation and
+ * commitments of the kilobots in running accumulators (constant memory, no pass over the
+ * logs), hence the summary is available as soon as the experiment stops:
+ * - per resource: population mean/min/max, mean fraction of committed kilobots and
+ *   cumulative exploitation
+ * - fraction of uncommitted kilobots
+ * - time to consensus, i.e. the first time CONSENSUS_QUORUM of the kilobots is committed
+ *   to the same resource
+ * - commitment switches, i.e. changes of the led colour of a kilobot between two ticks
+ */
+
+#ifndef RUNSTATISTICS_H
+#define RUNSTATISTICS_H
+
+#include <stdint.h>
+
+#include <QVector>
+#include <QColor>
+#include <QString>
+#include <QDataStream>
+
+#include "kilobot.h"
+#include "resources.h"
+#include "kilobotRegistry.h"
+
+#define CONSENSUS_QUORUM 0.9 // fraction of the kilobots committed to the same resource
+
+class RunStatistics {
+public:
+    struct resource_statistics {
+        double population_mean;
+        double population_min;
+        double population_max;
+        double commitment_mean;     /* mean fraction of the kilobots committed to the resource */
+        uint32_t committed;         /* kilobots committed to the resource at the last update */
+        double exploitation;        /* exploitation since the start of the run */
+    };
+
+    QVector<resource_statistics> resources;
+    uint32_t uncommitted;           /* uncommitted kilobots at the last update */
+    double uncommitted_mean;        /* mean fraction of uncommitted kilobots */
+    uint32_t robots;                /* kilobots at the last update */
+
+    uint64_t samples;               /* updates since the start of the run */
+    double start_time;
+    double last_time;
+
+    double consensus_time;          /* seconds from the start, -1 if never reached */
+    int consensus_resource;         /* -1 if never reached */
+    uint64_t switches;              /* commitment changes of all kilobots */
+    uint64_t resource_switches;     /* changes from a resource directly to another one */
+
+    RunStatistics() {reset(0, 0);}
+
+    /* forget everything, the run starts at time */
+    void reset(uint resources_count, double time);
+
+    /* resource to which a kb is committed given its led, -1 if uncommitted */
+    static int commitmentOf(kilobot_led led);
+
+    /* add one sample with the leds of all the kilobots of the registry */
+    void update(double time, const QVector<Resource*>& resources, const KilobotRegistry& kilobots);
+
+    /* commitment changes per kilobot per minute */
+    double switchingRate() const;
+
+    /* compact "key value" report of the run */
+    QString summary() const;
+
+    /* accumulators, to continue the statistics when resuming from a snapshot */
+    void save(QDataStream& out) const;
+    bool load(QDataStream& in);
+
+private:
+    QVector<qint8> commitments;     /* last commitment of each kb by id, -2 if never seen */
+    QVector<double> exploitation_offset; /* totalExploitation of the resources at the start of the run */
+};
+
+#endif // RUNSTATISTICS_H
@@ -0,0 +1,87 @@
+#ifndef SNAPSHOTWRITER_CPP
+#define SNAPSHOTWRITER_CPP
+
+#include "snapshotWriter.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <QDebug>
+#include <QFile>
+
+SnapshotWriter::SnapshotWriter() : pending(false), writing(false), stopping(false) {
+    thread = std::thread(&SnapshotWriter::writerLoop, this);
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+void SnapshotWriter::write(const QString& filename, const QByteArray& snapshot) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // an older snapshot not yet written is dropped
+        pending_filename = filename.toStdString();
+        pending_snapshot = snapshot;
+        pending = true;
+    }
+    wake.notify_all();
+}
+
+void SnapshotWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] {return !pending && !writing;});
+}
+
+void SnapshotWriter::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true) {
+        wake.wait(lock, [this] {return pending || stopping;});
+        if(!pending) {
+            // stopping and nothing left to write
+            return;
+        }
+        std::string filename = pending_filename;
+        QByteArray snapshot = pending_snapshot;
+        pending = false;
+        writing = true;
+
+        lock.unlock();
+        if(!writeFile(filename, snapshot)) {
+            qDebug() << "ERROR writing snapshot" << QString::fromStdString(filename);
+        }
+        lock.lock();
+
+        writing = false;
+        idle.notify_all();
+    }
+}
+
+bool SnapshotWriter::writeFile(const std::string& filename, const QByteArray& snapshot) {
+    std::string tmp_filename = filename + ".tmp";
+    FILE* file = fopen(tmp_filename.c_str(), "wb");
+    if(file == NULL) {
+        return false;
+    }
+    bool ok = fwrite(snapshot.constData(), 1, snapshot.size(), file) == (size_t)snapshot.size();
+    ok = (fflush(file) == 0) && ok;
+    ok = (fsync(fileno(file)) == 0) && ok;
+    ok = (fclose(file) == 0) && ok;
+    // atomically replace the previous snapshot
+    return ok && rename(tmp_filename.c_str(), filename.c_str()) == 0;
+}
+
+QByteArray SnapshotWriter::readFile(const QString& filename) {
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+#endif // SNAPSHOTWRITER_CPP
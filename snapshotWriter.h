@@ -0,0 +1,54 @@
+/**
+ * Writes experiment snapshots to disk on a background thread.
+ *
+ * write() only stores the snapshot and wakes the writer thread, hence the experiment tick
+ * never waits for the disk. If the previous snapshot is still being written only the most
+ * recent pending one is kept. Each snapshot is written to filename.tmp, flushed and then
+ * renamed over filename, so a crash while writing leaves the previous snapshot intact.
+ */
+
+#ifndef SNAPSHOTWRITER_H
+#define SNAPSHOTWRITER_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <QByteArray>
+#include <QString>
+
+class SnapshotWriter {
+public:
+    /* constructor, starts the writer thread */
+    SnapshotWriter();
+
+    /* destructor, writes the pending snapshot and joins the writer thread */
+    ~SnapshotWriter();
+
+    /* queue the snapshot for writing and return immediately */
+    void write(const QString& filename, const QByteArray& snapshot);
+
+    /* wait until the queued snapshot is on disk */
+    void flush();
+
+    /* write a snapshot synchronously, false on error */
+    static bool writeFile(const std::string& filename, const QByteArray& snapshot);
+
+    /* read a whole snapshot, empty if the file does not exist */
+    static QByteArray readFile(const QString& filename);
+
+private:
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;   /* signal the writer that a snapshot is pending or that it must stop */
+    std::condition_variable idle;   /* signal flush that nothing is pending */
+
+    bool pending, writing, stopping;
+    std::string pending_filename;
+    QByteArray pending_snapshot;
+
+    void writerLoop();
+};
+
+#endif // SNAPSHOTWRITER_H
@@ -0,0 +1,94 @@
+/**
+ * Bounded single producer / single consumer queue, lock free.
+ *
+ * One thread pushes and one other thread pops. Each index is written by one side only and read by
+ * the other with acquire / release ordering, so neither side ever waits or takes a lock; each side
+ * also keeps a copy of the index of the other one and reloads it only when the ring looks full
+ * (or empty). The two sides are kept on separate cache lines. The entries are allocated once, at
+ * construction, and never move.
+ *
+ * The producer stages records with push() and makes them visible with publish(): the consumer
+ * sees all the records of a publish() at once, so a group of records is handed over whole (see
+ * TrackingHandoff). discard() drops the records staged since the last publish().
+ */
+
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <stdint.h>
+#include <vector>
+#include <atomic>
+
+// bytes between the indexes of the two sides
+#define RING_CACHE_LINE 64
+
+template<class T>
+class SpscRing {
+public:
+    /* ring of capacity records, rounded up to a power of two */
+    explicit SpscRing(uint32_t capacity) : tail(0), staged(0), head_seen(0), head(0), tail_seen(0) {
+        uint32_t size = 1;
+        while(size < capacity) {
+            size *= 2;
+        }
+        entries.resize(size);
+        mask = size-1;
+    }
+
+    uint32_t capacity() const {return mask+1;}
+
+    /* producer: stage a record, false if the ring is full */
+    bool push(const T& record) {
+        if(staged-head_seen == capacity()) {
+            head_seen = head.load(std::memory_order_acquire);
+            if(staged-head_seen == capacity()) {
+                return false;
+            }
+        }
+        entries[staged & mask] = record;
+        staged++;
+        return true;
+    }
+    /* producer: make the staged records visible to the consumer */
+    void publish() {tail.store(staged, std::memory_order_release);}
+    /* producer: drop the records staged since the last publish */
+    void discard() {staged = tail.load(std::memory_order_relaxed);}
+    /* producer: records staged since the last publish */
+    uint32_t stagedCount() const {return staged-tail.load(std::memory_order_relaxed);}
+
+    /* consumer: take the oldest published record, false if there is none */
+    bool pop(T& record) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if(h == tail_seen) {
+            tail_seen = tail.load(std::memory_order_acquire);
+            if(h == tail_seen) {
+                return false;
+            }
+        }
+        record = entries[h & mask];
+        head.store(h+1, std::memory_order_release);
+        return true;
+    }
+    /* consumer: published records not taken yet */
+    uint32_t size() const {return tail.load(std::memory_order_acquire)-head.load(std::memory_order_relaxed);}
+
+private:
+    std::vector<T> entries;
+    uint32_t mask;
+    char shared_padding[RING_CACHE_LINE];
+
+    // written by the producer (indexes grow forever, wrapping, and are masked at the access)
+    std::atomic<uint32_t> tail;     /* records published */
+    uint32_t staged;                /* records pushed, published or not */
+    uint32_t head_seen;             /* head at the last check */
+    char producer_padding[RING_CACHE_LINE];
+    // written by the consumer
+    std::atomic<uint32_t> head;     /* records popped */
+    uint32_t tail_seen;             /* tail at the last check */
+    char consumer_padding[RING_CACHE_LINE];
+
+    SpscRing(const SpscRing&);
+    SpscRing& operator=(const SpscRing&);
+};
+
+#endif // SPSCRING_H
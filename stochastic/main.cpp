@@ -0,0 +1,117 @@
+/**
+ * Distributions of consensus time and exploitation of finite swarms (see stochasticSwarm.h).
+ *
+ * The parameters are the ones of the plugin (areas generated as in the experiment), the
+ * replicas are simulated on all cores. Prints one line per replica with --replicas-out and
+ * the summary of the distributions on stdout.
+ *
+ * usage: complexityStochastic [--robots=N] [--replicas=N] [--duration=seconds] [--seed=N]
+ *                             [--threads=N] [--exact] [--lambda=x] [--exploitation=linear|quadratic|cubic]
+ *                             [--replicas-out]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include <QtGlobal>
+
+#include "complexityEnvironment.h"
+#include "stochasticSwarm.h"
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [--robots=N] [--replicas=N] [--duration=seconds] [--seed=N]\n"
+                    "          [--threads=N] [--exact] [--lambda=x] [--exploitation=linear|quadratic|cubic]\n"
+                    "          [--replicas-out]\n", name);
+}
+
+int main(int argc, char** argv) {
+    uint32_t robots = 50;
+    uint32_t replicas = 1000;
+    double duration = 3600;
+    unsigned int seed = 0;
+    uint32_t threads = 0;
+    bool exact = false, replicas_out = false;
+    double lambda = -1;
+    double exponent = -1;
+    for(int i=1; i<argc; i++) {
+        if(strncmp(argv[i], "--robots=", 9) == 0) {
+            robots = atoi(argv[i]+9);
+        } else if(strncmp(argv[i], "--replicas=", 11) == 0) {
+            replicas = atoi(argv[i]+11);
+        } else if(strncmp(argv[i], "--duration=", 11) == 0) {
+            duration = atof(argv[i]+11);
+        } else if(strncmp(argv[i], "--seed=", 7) == 0) {
+            seed = atoi(argv[i]+7);
+        } else if(strncmp(argv[i], "--threads=", 10) == 0) {
+            threads = atoi(argv[i]+10);
+        } else if(strcmp(argv[i], "--exact") == 0) {
+            exact = true;
+        } else if(strncmp(argv[i], "--lambda=", 9) == 0) {
+            lambda = atof(argv[i]+9);
+        } else if(strcmp(argv[i], "--exploitation=linear") == 0) {
+            exponent = 1;
+        } else if(strcmp(argv[i], "--exploitation=quadratic") == 0) {
+            exponent = 2;
+        } else if(strcmp(argv[i], "--exploitation=cubic") == 0) {
+            exponent = 3;
+        } else if(strcmp(argv[i], "--replicas-out") == 0) {
+            replicas_out = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(robots == 0 || replicas == 0 || duration <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // the resources of the experiment
+    qsrand(seed);
+    QVector<Area> oth_areas;
+    QVector<Resource*> resources;
+    for(uint type=0; type<3; type++) {
+        resources.push_back(new Resource(type, ARENA_CENTER, 146, 1, oth_areas));
+    }
+    MeanFieldModel::parameters parameters = MeanFieldModel::fromResources(resources, robots, ARENA_SIZE,
+                                                                          EXPLORATION_TIME, COMMUNICATION_TIME);
+    for(Resource* r : resources) {
+        delete r;
+    }
+    if(lambda >= 0) {
+        parameters.lambda = lambda;
+    }
+    if(exponent > 0) {
+        parameters.exponent = exponent;
+    }
+
+    StochasticSwarm swarm(parameters, exact ? StochasticSwarm::EXACT : StochasticSwarm::TAU_LEAPING);
+    WorkStealingPool pool(threads);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<StochasticSwarm::replica_result> results = swarm.simulateReplicas(pool, replicas, duration, seed);
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+    if(replicas_out) {
+        printf("replica consensus_time consensus_resource");
+        for(uint r=0; r<parameters.population.size(); r++) {
+            printf(" exploitation%u population%u committed%u", r, r, r);
+        }
+        printf(" events\n");
+        for(uint32_t i=0; i<results.size(); i++) {
+            const StochasticSwarm::replica_result& result = results[i];
+            printf("%u %.1f %d", i, result.consensus_time, result.consensus_resource);
+            for(uint r=0; r<result.exploitation.size(); r++) {
+                printf(" %f %f %u", result.exploitation[r], result.population[r], result.committed[r]);
+            }
+            printf(" %llu\n", (unsigned long long)result.events);
+        }
+    }
+    printf("%s", qPrintable(StochasticSwarm::summary(results)));
+    printf("method %s\nrobots %u\nduration_s %.0f\nthreads %u\nwall_s %.3f\ncpu_ms_per_replica %.3f\n",
+           exact ? "exact" : "tau_leaping", robots, duration, pool.size(), wall_seconds,
+           wall_seconds*1000*pool.size()/replicas);
+    return 0;
+}
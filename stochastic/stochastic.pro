@@ -0,0 +1,43 @@
+#-------------------------------------------------
+#
+# Stochastic simulation of finite swarms (consensus time and exploitation distributions)
+# run: ./complexityStochastic [--robots=N] [--replicas=N] [--duration=seconds] [--exact]
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = complexityStochastic
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -fopenmp-simd
+
+INCLUDEPATH += .. .
+
+SOURCES += \
+    main.cpp \
+    ../stochasticSwarm.cpp \
+    ../meanFieldModel.cpp \
+    ../workStealingPool.cpp \
+    ../objectPool.cpp
+
+HEADERS += \
+    ../stochasticSwarm.h \
+    ../meanFieldModel.h \
+    ../workStealingPool.h \
+    ../runStatistics.h \
+    ../kilobotRegistry.h \
+    ../poseFilter.h \
+    ../experimentConfig.h \
+    ../resources.h \
+    ../area.h \
+    ../areaMask.h \
+    ../resourceColours.h \
+    ../objectPool.h
+
+INCLUDEPATH += /usr/local/include/
+LIBS += -L/usr/local/lib \
+        -lopencv_core
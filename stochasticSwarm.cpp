@@ -0,0 +1,322 @@
+#ifndef STOCHASTICSWARM_CPP
+#define STOCHASTICSWARM_CPP
+
+#include "stochasticSwarm.h"
+#include "runStatistics.h"
+
+#include <math.h>
+#include <algorithm>
+
+// the areas are never let below this population (see Area::doStep)
+#define STOCHASTIC_MIN_POPULATION 0.001
+
+StochasticSwarm::StochasticSwarm(const MeanFieldModel::parameters& p, method_t method) :
+    method(method), quorum(CONSENSUS_QUORUM), p(p) {
+    robots = (uint32_t)std::max(round(p.robots), 1.0);
+    resources = std::max((uint32_t)p.population.size(), 1u);
+    areas = (uint32_t)std::max(round(p.areas), 1.0);
+}
+
+// binomial draw, by inversion for small means (most area occupancies), std::binomial_distribution otherwise
+static uint32_t binomial(uint32_t n, double p, std::mt19937_64& re) {
+    if(n == 0 || p <= 0) {
+        return 0;
+    }
+    if(p >= 1) {
+        return n;
+    }
+    if(p > 0.5) {
+        return n-binomial(n, 1-p, re);
+    }
+    if(n*p > 16) {
+        return std::binomial_distribution<uint32_t>(n, p)(re);
+    }
+    // walk the cumulative distribution, P(k+1) = P(k) (n-k)/(k+1) p/(1-p)
+    double u = (re() >> 11)*(1.0/9007199254740992.0);
+    double odds = p/(1-p);
+    double probability = pow(1-p, n);
+    uint32_t k = 0;
+    while(u > probability && k < n) {
+        u -= probability;
+        probability *= odds*(n-k)/(k+1);
+        k++;
+    }
+    return k;
+}
+
+void StochasticSwarm::updatePopulations(replica_state& s) const {
+    for(uint32_t r=0; r<resources; r++) {
+        double population = 0;
+        for(uint32_t a=0; a<areas; a++) {
+            population += s.population[r*areas+a];
+        }
+        s.resource_population[r] = population/areas;
+    }
+}
+
+void StochasticSwarm::updateRates(replica_state& s) const {
+    // getScaledUtility of the resources as perceived by the kilobots
+    double range = std::max(p.umax-p.umin, 1e-12);
+    double pressure = 0;
+    for(uint32_t r=0; r<resources; r++) {
+        s.utility[r] = std::min(std::max((s.resource_population[r]-p.umin)/range, 0.0), 1.0);
+        pressure += s.utility[r]*s.committed[r];
+    }
+
+    // the recruiter or inhibitor is one of the other kilobots
+    double others = robots > 1 ? robots-1 : 1;
+    for(uint32_t r=0; r<resources; r++) {
+        s.join[r] = (p.h*s.utility[r]/resources + p.k*s.utility[r]*s.committed[r]/others)/p.decision_period;
+        double abandon = s.resource_population[r] <= p.umin ? p.h : 0.0;
+        double inhibition = p.k*(pressure-s.utility[r]*s.committed[r])/others;
+        s.leave[r] = (abandon+inhibition)/p.decision_period;
+    }
+}
+
+void StochasticSwarm::stepAreas(replica_state& s, std::vector<double>& exploitation) const {
+    // each committed kilobot is over one of the areas of its resource with probability coverage,
+    // all areas equally likely
+    double over_area = std::min(std::max(p.coverage, 0.0), 1.0);
+    int exponent = (int)round(p.exponent);
+    std::vector<uint32_t>& occupancy = s.occupancy;
+    for(uint32_t r=0; r<resources; r++) {
+        std::fill(occupancy.begin(), occupancy.end(), 0);
+        uint32_t on_areas = binomial(s.committed[r], over_area, s.re);
+        if(on_areas <= 2*areas) {
+            // few kilobots, each one picks its area
+            for(uint32_t i=0; i<on_areas; i++) {
+                occupancy[(uint32_t)(((s.re() >> 32)*areas) >> 32)]++;
+            }
+        } else {
+            // multinomial as a sequence of conditional binomials, area a gets 1/(areas-a) of the ones left
+            uint32_t left = on_areas;
+            for(uint32_t a=0; a<areas-1 && left>0; a++) {
+                occupancy[a] = binomial(left, 1.0/(areas-a), s.re);
+                left -= occupancy[a];
+            }
+            occupancy[areas-1] += left;
+        }
+
+        for(uint32_t a=0; a<areas; a++) {
+            // Area::doStep
+            double& population = s.population[r*areas+a];
+            double n = occupancy[a];
+            double step_exploitation = population*p.lambda*(exponent == 3 ? n*n*n : (exponent == 2 ? n*n : n));
+            double growth = population*p.eta*(1-population);
+            population = population-step_exploitation+growth;
+            if(population <= STOCHASTIC_MIN_POPULATION) {
+                population = STOCHASTIC_MIN_POPULATION;
+            }
+            exploitation[r] += step_exploitation;
+        }
+    }
+    updatePopulations(s);
+}
+
+void StochasticSwarm::checkConsensus(const replica_state& s, replica_result& result) const {
+    if(result.consensus_resource >= 0) {
+        return;
+    }
+    for(uint32_t r=0; r<resources; r++) {
+        if(s.committed[r] >= quorum*robots) {
+            result.consensus_time = s.time;
+            result.consensus_resource = r;
+            return;
+        }
+    }
+}
+
+StochasticSwarm::replica_result StochasticSwarm::simulate(double duration, uint64_t seed, uint32_t replica) const {
+    // splitmix64 of seed and replica, so that every replica has its own stream
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull*((uint64_t)replica+1);
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBull;
+    z = z ^ (z >> 31);
+
+    replica_state s;
+    s.re.seed(z);
+    s.time = 0;
+    s.committed.assign(resources, 0);
+    s.utility.assign(resources, 0);
+    s.join.assign(resources, 0);
+    s.leave.assign(resources, 0);
+    s.leaving.assign(resources, 0);
+    s.occupancy.assign(areas, 0);
+    s.population.assign(resources*areas, 1);
+    s.resource_population.assign(resources, 1);
+    uint32_t committed = 0;
+    for(uint32_t r=0; r<resources; r++) {
+        double fraction = r < p.committed.size() ? p.committed[r] : 0;
+        s.committed[r] = std::min((uint32_t)round(fraction*robots), robots-committed);
+        committed += s.committed[r];
+        double population = r < p.population.size() ? p.population[r] : 1;
+        std::fill(s.population.begin()+r*areas, s.population.begin()+(r+1)*areas, population);
+    }
+    s.uncommitted = robots-committed;
+    updatePopulations(s);
+
+    replica_result result;
+    result.consensus_time = -1;
+    result.consensus_resource = -1;
+    result.exploitation.assign(resources, 0);
+    result.events = 0;
+    checkConsensus(s, result);
+
+    const double step_interval = p.step_rate > 0 ? 1.0/p.step_rate : duration;
+    double next_step = step_interval;
+    updateRates(s);
+
+    std::uniform_real_distribution<double> unit(0, 1);
+    while(s.time < duration) {
+        if(method == EXACT) {
+            // Gillespie direct method, the rates are constant until the next event or area step
+            double total = 0;
+            for(uint32_t r=0; r<resources; r++) {
+                total += s.uncommitted*s.join[r] + s.committed[r]*s.leave[r];
+            }
+            double wait = total > 0 ? -log(1.0-unit(s.re))/total : duration;
+            if(s.time+wait >= next_step || s.time+wait >= duration) {
+                // the step comes first, the wait is drawn again afterwards (memoryless)
+                s.time = std::min(next_step, duration);
+                if(next_step <= duration) {
+                    stepAreas(s, result.exploitation);
+                    next_step += step_interval;
+                }
+                updateRates(s);
+                continue;
+            }
+            s.time += wait;
+
+            // pick the event proportionally to its rate
+            double pick = unit(s.re)*total;
+            for(uint32_t r=0; r<resources; r++) {
+                double join = s.uncommitted*s.join[r];
+                if(pick < join) {
+                    s.uncommitted--;
+                    s.committed[r]++;
+                    break;
+                }
+                pick -= join;
+                double leave = s.committed[r]*s.leave[r];
+                // (the last resource also takes the rounding errors of pick)
+                if((pick < leave || r == resources-1) && s.committed[r] > 0) {
+                    s.committed[r]--;
+                    s.uncommitted++;
+                    break;
+                }
+                pick -= leave;
+            }
+            result.events++;
+            checkConsensus(s, result);
+            updateRates(s);
+        } else {
+            // all decisions until the next area step at once, from the counts at the start of the leap
+            double tau = std::min(next_step, duration)-s.time;
+            double join_total = 0;
+            for(uint32_t r=0; r<resources; r++) {
+                join_total += s.join[r];
+            }
+            uint32_t joining = 0;
+            if(s.uncommitted > 0 && join_total > 0) {
+                joining = binomial(s.uncommitted, 1.0-exp(-join_total*tau), s.re);
+            }
+            std::vector<uint32_t>& leaving = s.leaving;
+            for(uint32_t r=0; r<resources; r++) {
+                leaving[r] = 0;
+                if(s.committed[r] > 0 && s.leave[r] > 0) {
+                    leaving[r] = binomial(s.committed[r], 1.0-exp(-s.leave[r]*tau), s.re);
+                }
+            }
+            // the joining kilobots are split among the resources proportionally to the rates
+            uint32_t left = joining;
+            double left_rate = join_total;
+            for(uint32_t r=0; r<resources && left>0; r++) {
+                uint32_t to_r = left;
+                if(r < resources-1 && left_rate > 0) {
+                    to_r = binomial(left, s.join[r]/left_rate, s.re);
+                }
+                s.committed[r] += to_r;
+                left -= to_r;
+                left_rate -= s.join[r];
+            }
+            s.uncommitted -= joining;
+            for(uint32_t r=0; r<resources; r++) {
+                s.committed[r] -= leaving[r];
+                s.uncommitted += leaving[r];
+            }
+
+            s.time += tau;
+            if(next_step <= duration) {
+                stepAreas(s, result.exploitation);
+                next_step += step_interval;
+            }
+            result.events++;
+            checkConsensus(s, result);
+            updateRates(s);
+        }
+    }
+
+    result.population = s.resource_population;
+    result.committed = s.committed;
+    return result;
+}
+
+std::vector<StochasticSwarm::replica_result> StochasticSwarm::simulateReplicas(WorkStealingPool& pool, uint32_t replicas,
+                                                                               double duration, uint64_t seed) const {
+    std::vector<replica_result> results(replicas);
+    pool.parallelFor(replicas, [&](uint32_t replica, uint32_t) {
+        results[replica] = simulate(duration, seed, replica);
+    });
+    return results;
+}
+
+QString StochasticSwarm::summary(const std::vector<replica_result>& results) {
+    std::vector<double> consensus_times;
+    std::vector<double> exploitations;
+    std::vector<uint32_t> winners;
+    for(const replica_result& result : results) {
+        if(result.consensus_resource >= 0) {
+            consensus_times.push_back(result.consensus_time);
+            if(winners.size() <= (size_t)result.consensus_resource) {
+                winners.resize(result.consensus_resource+1, 0);
+            }
+            winners[result.consensus_resource]++;
+        }
+        double exploitation = 0;
+        for(double e : result.exploitation) {
+            exploitation += e;
+        }
+        exploitations.push_back(exploitation);
+    }
+
+    // value at quantile q of sorted values
+    auto quantile = [](const std::vector<double>& sorted, double q) {
+        return sorted.empty() ? -1.0 : sorted[std::min((size_t)(q*sorted.size()), sorted.size()-1)];
+    };
+    std::sort(consensus_times.begin(), consensus_times.end());
+    std::sort(exploitations.begin(), exploitations.end());
+    double mean = 0;
+    for(double e : exploitations) {
+        mean += e;
+    }
+    mean = exploitations.empty() ? 0 : mean/exploitations.size();
+    double variance = 0;
+    for(double e : exploitations) {
+        variance += (e-mean)*(e-mean);
+    }
+    variance = exploitations.size() > 1 ? variance/(exploitations.size()-1) : 0;
+
+    QString summary = QString("replicas %1\nconsensus_reached %2\n").arg(results.size()).arg(consensus_times.size());
+    for(size_t r=0; r<winners.size(); r++) {
+        summary = summary + QString("consensus_resource_%1 %2\n").arg(r).arg(winners[r]);
+    }
+    summary = summary + QString("consensus_time_p10 %1\nconsensus_time_p50 %2\nconsensus_time_p90 %3\n")
+            .arg(quantile(consensus_times, 0.1), 0, 'f', 1).arg(quantile(consensus_times, 0.5), 0, 'f', 1)
+            .arg(quantile(consensus_times, 0.9), 0, 'f', 1);
+    summary = summary + QString("exploitation_mean %1\nexploitation_sd %2\nexploitation_p10 %3\nexploitation_p50 %4\nexploitation_p90 %5\n")
+            .arg(mean, 0, 'f', 3).arg(sqrt(variance), 0, 'f', 3).arg(quantile(exploitations, 0.1), 0, 'f', 3)
+            .arg(quantile(exploitations, 0.5), 0, 'f', 3).arg(quantile(exploitations, 0.9), 0, 'f', 3);
+    return summary;
+}
+
+#endif // STOCHASTICSWARM_CPP
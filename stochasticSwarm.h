@@ -0,0 +1,100 @@
+/**
+ * Stochastic (finite swarm) model of the complexity experiment.
+ *
+ * The kilobots are not placed in space: the swarm is the number of kilobots committed to
+ * each resource and the uncommitted ones, the resources are their areas. The model is the
+ * one of MeanFieldModel (same parameters) without the large swarm limit:
+ * - every kilobot takes a decision as take_decision in kilobot_c_code/complexity.c, as a
+ *   continuous time Markov chain with rates (probabilities per decision period):
+ *   discovery h S_i/R, recruitment k S_i n_i/(N-1), abandon h if P_i <= umin and
+ *   cross-inhibition k sum_{j!=i} S_j n_j/(N-1)
+ * - every 1/step_rate seconds each area is stepped as Area::doStep, with the committed kilobots
+ *   spread at random over the areas of their resource (each one is over an area with
+ *   probability coverage)
+ *
+ * The rates only change when a kilobot changes its commitment or at an area step, hence the
+ * EXACT method is Gillespie's direct method with the area steps as scheduled events. With
+ * TAU_LEAPING the decisions of a whole area step are drawn at once (binomial leaping, the
+ * counts never go negative), the cost no longer grows with the size of the swarm.
+ *
+ * Replicas are independent and are simulated in parallel on a WorkStealingPool; the random
+ * stream of a replica only depends on the seed and on the replica index, hence the results
+ * do not depend on the number of threads.
+ */
+
+#ifndef STOCHASTICSWARM_H
+#define STOCHASTICSWARM_H
+
+#include <stdint.h>
+#include <vector>
+#include <random>
+
+#include <QString>
+
+#include "meanFieldModel.h"
+#include "workStealingPool.h"
+
+class StochasticSwarm {
+public:
+    typedef enum {
+        EXACT = 0,      /* one event per decision (Gillespie direct method) */
+        TAU_LEAPING     /* all decisions of an area step at once */
+    } method_t;
+
+    /* outcome of one replica */
+    struct replica_result {
+        double consensus_time;          /* first time quorum of the kilobots is committed to one resource, -1 if never */
+        int consensus_resource;         /* -1 if never */
+        std::vector<double> exploitation;   /* total exploitation of each resource */
+        std::vector<double> population;     /* final population of each resource */
+        std::vector<uint32_t> committed;    /* final committed kilobots of each resource */
+        uint64_t events;                /* decisions changing the state (EXACT) or leaps (TAU_LEAPING) */
+    };
+
+    method_t method;
+    double quorum;  /* fraction of the kilobots defining the consensus, CONSENSUS_QUORUM by default */
+
+    /* robots, areas and initial committed fractions are rounded to integers */
+    explicit StochasticSwarm(const MeanFieldModel::parameters& p, method_t method=TAU_LEAPING);
+
+    /* simulate one replica for duration seconds */
+    replica_result simulate(double duration, uint64_t seed, uint32_t replica=0) const;
+
+    /* simulate replicas [0, replicas) in parallel */
+    std::vector<replica_result> simulateReplicas(WorkStealingPool& pool, uint32_t replicas, double duration, uint64_t seed) const;
+
+    /* distribution of consensus time and exploitation over the replicas, as "key value" lines */
+    static QString summary(const std::vector<replica_result>& results);
+
+private:
+    MeanFieldModel::parameters p;
+    uint32_t robots;
+    uint32_t resources;
+    uint32_t areas;
+
+    /* state of one replica */
+    struct replica_state {
+        std::mt19937_64 re;
+        double time;
+        std::vector<uint32_t> committed;    /* per resource */
+        uint32_t uncommitted;
+        std::vector<double> population;     /* per area, resource major */
+        std::vector<double> resource_population; /* mean population of the areas of each resource */
+        std::vector<double> utility;        /* scaled utility of each resource */
+        std::vector<double> join;           /* rate of an uncommitted kilobot joining each resource */
+        std::vector<double> leave;          /* rate of a committed kilobot leaving each resource */
+        std::vector<uint32_t> leaving;      /* kilobots leaving each resource during a leap */
+        std::vector<uint32_t> occupancy;    /* kilobots over each area of a resource during an area step */
+    };
+
+    /* mean population of the areas of each resource */
+    void updatePopulations(replica_state& s) const;
+    /* recompute utilities and per kilobot rates from the current state */
+    void updateRates(replica_state& s) const;
+    /* Area::doStep for every area, the exploitation is added to exploitation */
+    void stepAreas(replica_state& s, std::vector<double>& exploitation) const;
+    /* check consensus and set it in result */
+    void checkConsensus(const replica_state& s, replica_result& result) const;
+};
+
+#endif // STOCHASTICSWARM_H
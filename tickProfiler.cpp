@@ -0,0 +1,109 @@
+#ifndef TICKPROFILER_CPP
+#define TICKPROFILER_CPP
+
+#include "tickProfiler.h"
+
+#include <math.h>
+
+void LatencyHistogram::reset() {
+    for(uint32_t b=0; b<POWERS*SUB_BUCKETS; b++) {
+        buckets[b].store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    maximum.store(0, std::memory_order_relaxed);
+}
+
+uint32_t LatencyHistogram::bucketOf(uint64_t ns) {
+    // values below SUB_BUCKETS are stored exactly in the first power
+    if(ns < SUB_BUCKETS) {
+        return (uint32_t)ns;
+    }
+    // position of the highest bit, then the next 4 bits select the linear sub bucket
+    uint32_t msb = 63-__builtin_clzll(ns);
+    uint32_t power = msb-3;
+    if(power >= POWERS) {
+        return POWERS*SUB_BUCKETS-1;
+    }
+    uint32_t sub = (uint32_t)(ns >> (msb-4)) & (SUB_BUCKETS-1);
+    return power*SUB_BUCKETS+sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(uint32_t bucket) {
+    uint32_t power = bucket/SUB_BUCKETS;
+    uint32_t sub = bucket%SUB_BUCKETS;
+    if(power == 0) {
+        return sub;
+    }
+    uint32_t msb = power+3;
+    return (((uint64_t)(SUB_BUCKETS+sub)) << (msb-4)) + (1ull << (msb-4)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t current = maximum.load(std::memory_order_relaxed);
+    while(ns > current && !maximum.compare_exchange_weak(current, ns, std::memory_order_relaxed)) {}
+}
+
+double LatencyHistogram::mean() const {
+    uint64_t n = count();
+    return n ? (double)sum.load(std::memory_order_relaxed)/n : 0;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    uint64_t n = count();
+    if(n == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)ceil(p/100.0*n);
+    if(rank == 0)
+        rank = 1;
+    uint64_t seen = 0;
+    for(uint32_t b=0; b<POWERS*SUB_BUCKETS; b++) {
+        seen += buckets[b].load(std::memory_order_relaxed);
+        if(seen >= rank) {
+            // never report more than the observed maximum
+            uint64_t bound = bucketUpperBound(b);
+            return bound < max() ? bound : max();
+        }
+    }
+    return max();
+}
+
+void TickProfiler::reset() {
+    for(uint8_t s=0; s<STAGES_COUNT; s++) {
+        histograms[s].reset();
+    }
+}
+
+const char* TickProfiler::stageName(stage_t stage) {
+    switch(stage) {
+    case RUN_TOTAL: return "run_total";
+    case PHASE_SWITCH: return "phase_switch";
+    case ENVIRONMENT_UPDATE: return "environment_update";
+    case STATE_REQUEST: return "state_request";
+    case STATISTICS: return "statistics";
+    case PLOT: return "plot";
+    case SAVE_IMAGE: return "save_image";
+    case LOG: return "log";
+    case SNAPSHOT: return "snapshot";
+    case SENSOR_UPDATE: return "sensor_update";
+    case TRACKING_HANDOFF: return "tracking_handoff";
+    default: return "unknown";
+    }
+}
+
+QString TickProfiler::report() const {
+    QString report = "stage count p50_us p99_us max_us mean_us\n";
+    for(uint8_t s=0; s<STAGES_COUNT; s++) {
+        const LatencyHistogram& h = histograms[s];
+        report = report + QString("%1 %2 %3 %4 %5 %6\n").arg(stageName((stage_t)s)).arg(h.count())
+                .arg(h.percentile(50)/1000.0, 0, 'f', 1).arg(h.percentile(99)/1000.0, 0, 'f', 1)
+                .arg(h.max()/1000.0, 0, 'f', 1).arg(h.mean()/1000.0, 0, 'f', 1);
+    }
+    return report;
+}
+
+#endif // TICKPROFILER_CPP
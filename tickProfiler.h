@@ -0,0 +1,111 @@
+/**
+ * Instrumentation of the experiment tick.
+ *
+ * Each stage of mykilobotexperiment::run() and each updateVirtualSensor call is timed
+ * and recorded in a log-linear (HDR style) histogram: values are grouped by power of two
+ * and each power of two is split in SUB_BUCKETS linear buckets, so the relative error of
+ * the reported percentiles is below 1/SUB_BUCKETS. Counters are atomics updated with relaxed
+ * operations, hence the sensor slots can record from any thread without locks.
+ *
+ * When the profiler is disabled a ScopedStageTimer costs a single branch; defining
+ * NO_TICK_PROFILING removes the timers at compile time.
+ */
+
+#ifndef TICKPROFILER_H
+#define TICKPROFILER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+#include <QString>
+
+class LatencyHistogram {
+public:
+    static const uint32_t SUB_BUCKETS = 16; /* linear buckets per power of two */
+    static const uint32_t POWERS = 40;      /* values up to 2^43 ns (~2.4 hours) */
+
+    LatencyHistogram() {reset();}
+
+    void reset();
+
+    /* record a value in nanoseconds (thread safe, lock free) */
+    void record(uint64_t ns);
+
+    uint64_t count() const {return total.load(std::memory_order_relaxed);}
+    uint64_t max() const {return maximum.load(std::memory_order_relaxed);}
+    double mean() const;
+
+    /* value at percentile p (0-100) in nanoseconds, upper bound of the bucket */
+    uint64_t percentile(double p) const;
+
+private:
+    std::atomic<uint64_t> buckets[POWERS*SUB_BUCKETS];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> maximum;
+
+    static uint32_t bucketOf(uint64_t ns);
+    static uint64_t bucketUpperBound(uint32_t bucket);
+};
+
+class TickProfiler {
+public:
+    /* stages of the experiment tick */
+    typedef enum {
+        RUN_TOTAL = 0,      /* whole mykilobotexperiment::run() */
+        PHASE_SWITCH,       /* exploration/communication switch and broadcasts */
+        ENVIRONMENT_UPDATE, /* mykilobotenvironment::update() */
+        STATE_REQUEST,      /* emit updateKilobotStates() */
+        STATISTICS,         /* update of the run statistics */
+        PLOT,               /* clear drawings and plotEnvironment() */
+        SAVE_IMAGE,         /* emit saveImage() */
+        LOG,                /* writing the log */
+        SNAPSHOT,           /* serializing the state for the snapshot writer */
+        SENSOR_UPDATE,      /* a single updateVirtualSensor call */
+        TRACKING_HANDOFF,   /* draining the frames of the tracking handoff and sensing them */
+        STAGES_COUNT
+    } stage_t;
+
+    bool enabled;
+
+    TickProfiler() : enabled(false) {}
+
+    void record(stage_t stage, uint64_t ns) {histograms[stage].record(ns);}
+    void reset();
+
+    /* one line per stage with count, p50, p99 and max in microseconds */
+    QString report() const;
+
+    static const char* stageName(stage_t stage);
+
+private:
+    LatencyHistogram histograms[STAGES_COUNT];
+};
+
+/* time the enclosing scope and record it in the profiler stage if the profiler is enabled */
+class ScopedStageTimer {
+public:
+    ScopedStageTimer(TickProfiler* profiler, TickProfiler::stage_t stage) :
+        profiler((profiler && profiler->enabled) ? profiler : NULL), stage(stage) {
+        if(this->profiler)
+            start = std::chrono::steady_clock::now();
+    }
+    ~ScopedStageTimer() {
+        if(profiler)
+            profiler->record(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start).count());
+    }
+
+private:
+    TickProfiler* profiler;
+    TickProfiler::stage_t stage;
+    std::chrono::steady_clock::time_point start;
+};
+
+#ifndef NO_TICK_PROFILING
+#define PROFILE_STAGE(profiler, stage) ScopedStageTimer stage_timer_##stage(profiler, TickProfiler::stage)
+#else
+#define PROFILE_STAGE(profiler, stage)
+#endif
+
+#endif // TICKPROFILER_H
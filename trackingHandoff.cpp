@@ -0,0 +1,128 @@
+#ifndef TRACKINGHANDOFF_CPP
+#define TRACKINGHANDOFF_CPP
+
+#include "trackingHandoff.h"
+
+TrackingHandoff::TrackingHandoff(uint32_t capacity, QObject *parent) :
+    QObject(parent), ring(capacity), seen(KILOBOT_MAX_ID, 0), frame(1), frame_robots(0), frame_seen(0), known_robots(0),
+    dropped(0), restarts(0), restarted(0), restart_requests(0), frames(0), robots(0), dropped_frames(0), dropped_robots(0), peak_backlog(0) {
+    clock.start();
+}
+
+void TrackingHandoff::attach(Kilobot* kilobot) {
+    // the slot runs in the thread of the tracking, no event is posted
+    QObject::disconnect(kilobot, SIGNAL(sendUpdateToHardware(Kilobot)), 0, 0);
+    QObject::connect(kilobot, SIGNAL(sendUpdateToHardware(Kilobot)), this, SLOT(track(Kilobot)), Qt::DirectConnection);
+}
+
+void TrackingHandoff::track(Kilobot kilobot) {
+    uint32_t requests = restart_requests.load(std::memory_order_acquire);
+    if(requests != restarts) {
+        // the kbs not published are dropped here, the published ones at the drain
+        ring.discard();
+        seen.assign(seen.size(), 0);
+        frame++;
+        frame_robots = 0;
+        frame_seen = 0;
+        known_robots = 0;
+        dropped = 0;
+        restarts = requests;
+        // before any kb of the new frame is published
+        restarted.store((uint64_t)restarts << 32 | frame, std::memory_order_release);
+    }
+
+    // a kb already tracked in this frame starts the next one
+    kilobot_id id = kilobot.getID();
+    if(id < seen.size()) {
+        if(seen[id] == frame) {
+            endFrame();
+        }
+        seen[id] = frame;
+        frame_seen++;
+    }
+
+    robot_snapshot record = {id, kilobot.getLedColour(), kilobot.getPosition(), kilobot.getVelocity(), frame, clock.nsecsElapsed()};
+    if(dropped > 0 || !ring.push(record)) {
+        // the ring is full, the rest of the frame is dropped (the kbs published already are kept)
+        dropped += ring.stagedCount()+1;
+        ring.discard();
+    }
+    frame_robots++;
+
+    // with as many kbs as the last frame the frame is published, without waiting for the next one
+    // (the kbs appearing later in the frame are published at its end)
+    if(frame_seen == known_robots) {
+        ring.publish();
+    }
+}
+
+void TrackingHandoff::endFrame() {
+    ring.publish();
+    if(frame_robots > 0) {
+        frames.fetch_add(1, std::memory_order_relaxed);
+        robots.fetch_add(frame_robots-dropped, std::memory_order_relaxed);
+        if(dropped > 0) {
+            dropped_frames.fetch_add(1, std::memory_order_relaxed);
+            dropped_robots.fetch_add(dropped, std::memory_order_relaxed);
+        }
+    }
+    known_robots = frame_seen;
+    frame++;
+    frame_robots = 0;
+    frame_seen = 0;
+    dropped = 0;
+}
+
+uint32_t TrackingHandoff::drain(std::vector<robot_snapshot>& records) {
+    records.clear();
+    robot_snapshot record;
+    while(ring.pop(record)) {
+        records.push_back(record);
+    }
+
+    // the records tracked before the last clear() are dropped: all of them until the producer serves
+    // it, then the ones before its first frame (read after the pops, it is as recent as the records)
+    uint64_t served = restarted.load(std::memory_order_acquire);
+    bool pending = (uint32_t)(served >> 32) != restart_requests.load(std::memory_order_relaxed);
+    uint32_t first_frame = (uint32_t)served;
+    uint32_t kept = 0;
+    uint32_t drained_frames = 0;
+    for(const robot_snapshot& r : records) {
+        if(pending || r.frame < first_frame) {
+            continue;
+        }
+        if(kept == 0 || records[kept-1].frame != r.frame) {
+            drained_frames++;
+        }
+        records[kept++] = r;
+    }
+    records.resize(kept);
+    if(drained_frames > peak_backlog) {
+        peak_backlog = drained_frames;
+    }
+    return drained_frames;
+}
+
+void TrackingHandoff::clear() {
+    // served by the producer at the next kb tracked (see track and drain)
+    restart_requests.fetch_add(1, std::memory_order_release);
+    peak_backlog = 0;
+}
+
+TrackingHandoff::counters TrackingHandoff::statistics() const {
+    counters c;
+    c.frames = frames.load(std::memory_order_relaxed);
+    c.robots = robots.load(std::memory_order_relaxed);
+    c.dropped_frames = dropped_frames.load(std::memory_order_relaxed);
+    c.dropped_robots = dropped_robots.load(std::memory_order_relaxed);
+    c.peak_backlog = peak_backlog;
+    return c;
+}
+
+QString TrackingHandoff::report() const {
+    counters c = statistics();
+    return QString("frames %1 kilobots %2 dropped_frames %3 dropped_kilobots %4 peak_backlog_frames %5")
+            .arg(c.frames).arg(c.robots).arg(c.dropped_frames).arg(c.dropped_robots).arg(c.peak_backlog);
+}
+
+#endif // TRACKINGHANDOFF_CPP
@@ -0,0 +1,115 @@
+/**
+ * Handoff of the tracked kilobots from the tracking thread to the experiment.
+ *
+ * ARK sends every tracked kb to the environment with a queued signal: one event posted per kb per
+ * frame, with a copy of the Kilobot object (a QObject with its tracking buffers). These events are
+ * served whenever the event loop gets to them, interleaved with the ticks of the experiment, so
+ * a tick can see part of a frame.
+ *
+ * The handoff is connected directly to the signal of each kb (see attach), so track() runs in the
+ * tracking thread. It copies the id, position, velocity and led of the kb in a lock free ring
+ * (see SpscRing), without posting events. The frames are delimited on the ids: a kb already seen
+ * in the current frame starts the next one. The kbs of a frame are published to the consumer as
+ * soon as they are as many as in the last frame (the ones appearing later are published at the
+ * end of the frame), never mixed with the kbs of another frame. The experiment drains the ring at
+ * the start of run(), so it always receives whole frames, in tracking order.
+ *
+ * When the ring is full the experiment is behind the tracking: the kbs of the frame not published
+ * yet are dropped, and counted. The peak backlog of frames found at a drain measures how far
+ * behind the experiment got.
+ *
+ * clear() only asks for a restart: the producer serves it at the next kb tracked, dropping the
+ * kbs not published and starting a new frame, and tells the first frame after the restart. The
+ * consumer drops at the drain the records of the frames before it, also the ones published
+ * while the restart was asked.
+ */
+
+#ifndef TRACKINGHANDOFF_H
+#define TRACKINGHANDOFF_H
+
+#include <stdint.h>
+#include <vector>
+#include <atomic>
+
+#include <QObject>
+#include <QPointF>
+#include <QString>
+#include <QElapsedTimer>
+
+#include "kilobot.h"
+#include "spscRing.h"
+
+// records in the ring, about 40 frames of 100 kbs
+#define HANDOFF_CAPACITY 4096
+
+class TrackingHandoff : public QObject {
+    Q_OBJECT
+public:
+    /* a tracked kb */
+    struct robot_snapshot {
+        kilobot_id id;
+        lightColour colour;
+        QPointF position;
+        QPointF velocity;
+        uint32_t frame;     /* frame of the tracking, in order */
+        int64_t tracked;    /* clock of the handoff when the kb was tracked (ns) */
+    };
+
+    /* counters since the construction */
+    struct counters {
+        uint64_t frames;            /* frames tracked */
+        uint64_t robots;            /* kbs handed over */
+        uint64_t dropped_frames;    /* frames with kbs dropped because the ring was full */
+        uint64_t dropped_robots;    /* kbs dropped */
+        uint32_t peak_backlog;      /* most frames found at a drain */
+    };
+
+    explicit TrackingHandoff(uint32_t capacity=HANDOFF_CAPACITY, QObject *parent=0);
+
+    /* send the tracking of the kb to the ring instead of to its environment */
+    void attach(Kilobot* kilobot);
+
+    /* consumer: replace records with the kbs of the frames completed since the last drain, return
+     * the frames */
+    uint32_t drain(std::vector<robot_snapshot>& records);
+    /* consumer: drop the frames tracked until now, the next frame starts anew */
+    void clear();
+    /* seconds since the record was tracked */
+    double age(const robot_snapshot& record) const {return (clock.nsecsElapsed()-record.tracked)*1e-9;}
+
+    counters statistics() const;
+    /* the counters in one line */
+    QString report() const;
+
+public slots:
+    /* producer: the kb was tracked, called in the tracking thread */
+    void track(Kilobot kilobot);
+
+private:
+    SpscRing<robot_snapshot> ring;
+    QElapsedTimer clock;
+
+    // producer only
+    std::vector<uint32_t> seen;     /* last frame of each kb id, 0 if never seen */
+    uint32_t frame;                 /* frame being tracked */
+    uint32_t frame_robots;          /* kbs tracked in it */
+    uint32_t frame_seen;            /* kbs tracked in it with an id below KILOBOT_MAX_ID (the ones in seen) */
+    uint32_t known_robots;          /* frame_seen of the last frame */
+    uint32_t dropped;               /* kbs of the frame dropped because the ring was full */
+    uint32_t restarts;              /* restarts served */
+    std::atomic<uint64_t> restarted;        /* restarts served (high 32 bits) and first frame after the last one */
+    std::atomic<uint32_t> restart_requests; /* restarts asked by clear() */
+
+    std::atomic<uint64_t> frames;
+    std::atomic<uint64_t> robots;
+    std::atomic<uint64_t> dropped_frames;
+    std::atomic<uint64_t> dropped_robots;
+
+    // consumer only
+    uint32_t peak_backlog;
+
+    /* producer: publish the rest of the frame being tracked and start the next one */
+    void endFrame();
+};
+
+#endif // TRACKINGHANDOFF_H
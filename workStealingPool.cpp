@@ -0,0 +1,118 @@
+#ifndef WORKSTEALINGPOOL_CPP
+#define WORKSTEALINGPOOL_CPP
+
+#include "workStealingPool.h"
+
+WorkStealingPool::WorkStealingPool(uint32_t workers) : generation(0), stopping(false), remaining(0) {
+    if(workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for(uint32_t w=0; w<workers; w++) {
+        queues.push_back(new queue);
+    }
+    // worker 0 is the thread calling parallelFor
+    for(uint32_t w=1; w<workers; w++) {
+        threads.push_back(std::thread(&WorkStealingPool::workerLoop, this, w));
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(std::thread& t : threads) {
+        t.join();
+    }
+    for(queue* q : queues) {
+        delete q;
+    }
+}
+
+void WorkStealingPool::parallelFor(uint32_t tasks, task_function f) {
+    if(tasks == 0) {
+        return;
+    }
+
+    // set the function before publishing the tasks, the queue mutexes order the accesses
+    current = f;
+    remaining = tasks;
+
+    // contiguous blocks of tasks, neighbouring tasks usually share data
+    uint32_t workers = size();
+    for(uint32_t w=0; w<workers; w++) {
+        std::lock_guard<std::mutex> lock(queues[w]->mutex);
+        for(uint32_t t=(uint64_t)tasks*w/workers; t<(uint64_t)tasks*(w+1)/workers; t++) {
+            queues[w]->tasks.push_back(t);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+    }
+    wake.notify_all();
+
+    // work as worker 0
+    while(runOne(0)) {}
+
+    // wait for the tasks still running on the other workers
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]{return remaining == 0;});
+}
+
+bool WorkStealingPool::runOne(uint32_t worker) {
+    uint32_t task = 0;
+    bool found = false;
+
+    // own tasks from the front
+    {
+        std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+        if(!queues[worker]->tasks.empty()) {
+            task = queues[worker]->tasks.front();
+            queues[worker]->tasks.pop_front();
+            found = true;
+        }
+    }
+
+    // steal from the back of the others
+    for(uint32_t i=1; i<size() && !found; i++) {
+        queue* victim = queues[(worker+i)%size()];
+        std::lock_guard<std::mutex> lock(victim->mutex);
+        if(!victim->tasks.empty()) {
+            task = victim->tasks.back();
+            victim->tasks.pop_back();
+            found = true;
+        }
+    }
+
+    if(!found) {
+        return false;
+    }
+
+    current(task, worker);
+
+    if(--remaining == 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.notify_all();
+    }
+    return true;
+}
+
+void WorkStealingPool::workerLoop(uint32_t worker) {
+    uint64_t seen = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]{return stopping || generation != seen;});
+            if(stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        while(runOne(worker)) {}
+    }
+}
+
+#endif // WORKSTEALINGPOOL_CPP
@@ -0,0 +1,63 @@
+/**
+ * Minimal work stealing thread pool used to step large simulated swarms.
+ *
+ * parallelFor(tasks, f) splits the task indexes in contiguous blocks, one per worker,
+ * every worker consumes its own block from the front and, when done, steals from the
+ * back of the other blocks. The calling thread works as worker 0 and the call returns
+ * when all tasks are completed. f receives the task index and the worker index, the
+ * latter can be used to address per-thread data (e.g. counters reduced after the call).
+ */
+
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+
+class WorkStealingPool {
+public:
+    typedef std::function<void(uint32_t task, uint32_t worker)> task_function;
+
+    /* constructor, workers includes the calling thread (0 means hardware concurrency) */
+    explicit WorkStealingPool(uint32_t workers=0);
+
+    /* destructor, joins the worker threads */
+    ~WorkStealingPool();
+
+    uint32_t size() const {return (uint32_t)queues.size();}
+
+    /* run f for every task in [0, tasks) and wait for completion */
+    void parallelFor(uint32_t tasks, task_function f);
+
+private:
+    struct queue {
+        std::mutex mutex;
+        std::deque<uint32_t> tasks;
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<queue*> queues;
+
+    std::mutex mutex;
+    std::condition_variable wake;   /* signal the workers that a new parallelFor started */
+    std::condition_variable done;   /* signal the caller that all tasks are completed */
+    uint64_t generation;            /* incremented at every parallelFor */
+    bool stopping;
+
+    task_function current;
+    std::atomic<uint32_t> remaining;
+
+    void workerLoop(uint32_t worker);
+
+    /* run one task, own first then stolen, return false if no task is left */
+    bool runOne(uint32_t worker);
+};
+
+#endif // WORKSTEALINGPOOL_H